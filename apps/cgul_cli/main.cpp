@@ -1,13 +1,23 @@
+#include "cgul/core/cell_occupancy.h"
+#include "cgul/core/content_hash.h"
+#include "cgul/core/document_diff.h"
+#include "cgul/core/equality.h"
 #include "cgul/core/frame.h"
+#include "cgul/io/cgul_binary.h"
+#include "cgul/io/cgul_directory.h"
 #include "cgul/io/cgul_document.h"
+#include "cgul/render/compose_batch.h"
 #include "cgul/render/layout_composer.h"
 #include "cgul/validate/validate.h"
 
 #include <algorithm>
 #include <cstdint>
+#include <filesystem>
+#include <iomanip>
 #include <iostream>
 #include <random>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 namespace {
@@ -19,16 +29,30 @@ struct CliOptions {
   uint64_t seed = 0;
   std::string saveCgulPath;
   std::string loadCgulPath;
+  std::string batchDir;
+  unsigned threads = 0;
+  std::string convertInPath;
+  std::string convertOutPath;
+  std::string diffFromPath;
+  std::string diffToPath;
+  std::string validatePath;
+  uint64_t maxIssues = 100;
 };
 
 void PrintUsage(const char* exe) {
   std::cout
       << "Usage: " << exe << " [options]\n"
-      << "  --save-cgul <path>  Save generated sample document\n"
+      << "  --save-cgul <path>  Save generated sample document (gzip if the path ends in .gz)\n"
       << "  --load-cgul <path>  Load, validate, compose and render a .cgul document\n"
       << "  --seed <u64>        Seed used by sample generator (default: 0)\n"
       << "  --hover <x> <y>     Print widget id under hovered cell\n"
-      << "  --dump-json         Dump composed frame as v0 JSON\n";
+      << "  --dump-json         Dump composed frame as v0 JSON\n"
+      << "  --batch-dir <path>  Load and compose every .cgul/.cgulb in a directory, report timings\n"
+      << "  --threads <n>       Worker threads for --batch-dir (default: all cores)\n"
+      << "  --convert <in> <out>  Convert between .cgul and binary .cgulb (by extension)\n"
+      << "  --diff <from> <to>  Print the patch that turns one document into the other\n"
+      << "  --validate <path>   Report every validation error in a document (uses --threads)\n"
+      << "  --max-issues <n>    Limit for --validate (default: 100, 0 = no limit)\n";
 }
 
 bool ParseUInt64(const std::string& text, uint64_t* outValue) {
@@ -146,6 +170,78 @@ bool ParseArgs(int argc, char** argv, CliOptions* outOptions, std::string* outEr
       continue;
     }
 
+    if (arg == "--batch-dir") {
+      if (i + 1 >= argc) {
+        if (outError != nullptr) {
+          *outError = "--batch-dir requires a path";
+        }
+        return false;
+      }
+      options.batchDir = argv[++i];
+      continue;
+    }
+
+    if (arg == "--convert") {
+      if (i + 2 >= argc) {
+        if (outError != nullptr) {
+          *outError = "--convert requires an input and an output path";
+        }
+        return false;
+      }
+      options.convertInPath = argv[i + 1];
+      options.convertOutPath = argv[i + 2];
+      i += 2;
+      continue;
+    }
+
+    if (arg == "--diff") {
+      if (i + 2 >= argc) {
+        if (outError != nullptr) {
+          *outError = "--diff requires two document paths";
+        }
+        return false;
+      }
+      options.diffFromPath = argv[i + 1];
+      options.diffToPath = argv[i + 2];
+      i += 2;
+      continue;
+    }
+
+    if (arg == "--validate") {
+      if (i + 1 >= argc) {
+        if (outError != nullptr) {
+          *outError = "--validate requires a path";
+        }
+        return false;
+      }
+      options.validatePath = argv[++i];
+      continue;
+    }
+
+    if (arg == "--max-issues") {
+      if (i + 1 >= argc || !ParseUInt64(argv[i + 1], &options.maxIssues)) {
+        if (outError != nullptr) {
+          *outError = "--max-issues requires an unsigned integer";
+        }
+        return false;
+      }
+      ++i;
+      continue;
+    }
+
+    if (arg == "--threads") {
+      uint64_t threads = 0;
+      if (i + 1 >= argc || !ParseUInt64(argv[i + 1], &threads) || threads > 1024) {
+        if (outError != nullptr) {
+          *outError = "--threads requires an integer in [0, 1024]";
+        }
+        return false;
+      }
+      options.threads = static_cast<unsigned>(threads);
+      ++i;
+      continue;
+    }
+
     if (arg == "--seed") {
       if (i + 1 >= argc) {
         if (outError != nullptr) {
@@ -178,10 +274,6 @@ bool ParseArgs(int argc, char** argv, CliOptions* outOptions, std::string* outEr
   return true;
 }
 
-bool RectanglesOverlap(const cgul::RectI& a, const cgul::RectI& b) {
-  return a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h && b.y < a.y + a.h;
-}
-
 cgul::RectI GenerateRect(std::mt19937_64& rng, int gridW, int gridH, cgul::WidgetKind kind) {
   int minW = 8;
   int maxW = 24;
@@ -244,6 +336,7 @@ cgul::CgulDocument GenerateSampleDocument(uint64_t seed) {
   doc.widgets.clear();
   doc.widgets.reserve(static_cast<size_t>(widgetCount));
 
+  cgul::CellOccupancy occupancy(doc.gridWCells, doc.gridHCells);
   uint32_t nextId = 1;
   for (int i = 0; i < widgetCount; ++i) {
     cgul::WidgetKind kind = (i == 0) ? cgul::WidgetKind::Window : kinds[kindDist(rng)];
@@ -252,16 +345,7 @@ cgul::CgulDocument GenerateSampleDocument(uint64_t seed) {
     cgul::RectI chosen;
     for (int tries = 0; tries < 256 && !placed; ++tries) {
       const cgul::RectI rect = GenerateRect(rng, doc.gridWCells, doc.gridHCells, kind);
-
-      bool overlap = false;
-      for (const cgul::Widget& existing : doc.widgets) {
-        if (RectanglesOverlap(rect, existing.boundsCells)) {
-          overlap = true;
-          break;
-        }
-      }
-
-      if (!overlap) {
+      if (occupancy.IsFree(rect)) {
         chosen = rect;
         placed = true;
       }
@@ -276,32 +360,13 @@ cgul::CgulDocument GenerateSampleDocument(uint64_t seed) {
       }
       fallbackW = std::max(1, std::min(fallbackW, doc.gridWCells));
       fallbackH = std::max(1, std::min(fallbackH, doc.gridHCells));
-
-      for (int y = 0; y < doc.gridHCells && !placed; ++y) {
-        for (int x = 0; x < doc.gridWCells && !placed; ++x) {
-          cgul::RectI rect{x, y, fallbackW, fallbackH};
-          if (rect.x + rect.w > doc.gridWCells || rect.y + rect.h > doc.gridHCells) {
-            continue;
-          }
-
-          bool overlap = false;
-          for (const cgul::Widget& existing : doc.widgets) {
-            if (RectanglesOverlap(rect, existing.boundsCells)) {
-              overlap = true;
-              break;
-            }
-          }
-          if (!overlap) {
-            chosen = rect;
-            placed = true;
-          }
-        }
-      }
+      placed = occupancy.FindFreeRect(fallbackW, fallbackH, &chosen);
     }
 
     if (!placed) {
       continue;
     }
+    occupancy.Fill(chosen);
 
     cgul::Widget widget;
     widget.id = nextId++;
@@ -352,6 +417,161 @@ bool ValidateOrPrint(const cgul::CgulDocument& doc) {
   return true;
 }
 
+int RunBatch(const CliOptions& options) {
+  cgul::CgulDirectoryOptions loadOptions;
+  loadOptions.threadCount = options.threads;
+  std::vector<cgul::CgulDirectoryEntry> entries;
+  cgul::CgulDirectoryReport loadReport;
+  std::string error;
+  if (!cgul::LoadCgulDirectory(options.batchDir, loadOptions, &entries, &loadReport, &error)) {
+    std::cerr << "Batch error: " << error << "\n";
+    return 1;
+  }
+  for (const cgul::CgulDirectoryEntry& entry : entries) {
+    if (entry.status == cgul::CgulFileStatus::LoadFailed) {
+      std::cerr << "Load error: " << entry.path << ": " << entry.error << "\n";
+    } else if (entry.status == cgul::CgulFileStatus::ValidationFailed) {
+      std::cerr << "Validation error: " << entry.path << ": " << entry.error << "\n";
+    }
+  }
+  std::cout << "Load: " << loadReport.fileCount << " files, " << loadReport.totalBytes
+            << " bytes, threads=" << loadReport.threadCount << ", wall=" << std::fixed
+            << std::setprecision(3) << loadReport.wallMs << "ms ("
+            << std::setprecision(1) << loadReport.megabytesPerSecond << " MB/s, "
+            << loadReport.documentsPerSecond << " docs/s)\n";
+  if (loadReport.failedCount != 0) {
+    return 1;
+  }
+
+  std::vector<std::filesystem::path> paths;
+  std::vector<cgul::CgulDocument> docs;
+  paths.reserve(entries.size());
+  docs.reserve(entries.size());
+  for (cgul::CgulDirectoryEntry& entry : entries) {
+    paths.emplace_back(entry.path);
+    docs.push_back(std::move(entry.doc));
+  }
+
+  std::vector<uint64_t> coveredCells(docs.size(), 0);
+  cgul::ComposeBatchOptions batchOptions;
+  batchOptions.threadCount = options.threads;
+  cgul::ComposeBatchReport report;
+  cgul::ComposeBatch(
+      docs,
+      [&coveredCells](size_t index, const cgul::Frame& frame) {
+        uint64_t covered = 0;
+        for (const cgul::Cell& cell : frame.cells) {
+          covered += cell.widgetId != 0 ? 1u : 0u;
+        }
+        coveredCells[index] = covered;
+      },
+      batchOptions, &report);
+
+  double composeTotalMs = 0.0;
+  for (const cgul::ComposeTiming& timing : report.documents) {
+    composeTotalMs += timing.composeMs;
+    std::cout << paths[timing.documentIndex].filename().string() << " compose=" << std::fixed
+              << std::setprecision(3) << timing.composeMs << "ms worker=" << timing.worker
+              << " coveredCells=" << coveredCells[timing.documentIndex] << "\n";
+  }
+  // Content hashes ignore widget and meta order, so reordered copies count as duplicates.
+  std::unordered_set<uint64_t> distinctHashes;
+  for (const cgul::CgulDocument& doc : docs) {
+    distinctHashes.insert(cgul::HashDocument(doc));
+  }
+  std::cout << "Batch: " << docs.size() << " documents (" << distinctHashes.size()
+            << " distinct), threads=" << report.threadCount
+            << ", compose total=" << std::fixed << std::setprecision(3) << composeTotalMs
+            << "ms, wall=" << report.wallMs << "ms\n";
+  return 0;
+}
+
+bool IsBinaryPath(const std::string& path) {
+  return std::filesystem::path(path).extension() == ".cgulb";
+}
+
+bool LoadAnyCgul(const std::string& path, cgul::CgulDocument* outDoc, std::string* outError) {
+  return IsBinaryPath(path) ? cgul::LoadCgulBinaryFile(path, outDoc, outError)
+                            : cgul::LoadCgulFile(path, outDoc, outError);
+}
+
+int RunConvert(const CliOptions& options) {
+  cgul::CgulDocument doc;
+  std::string error;
+  if (!LoadAnyCgul(options.convertInPath, &doc, &error)) {
+    std::cerr << "Load error: " << error << "\n";
+    return 1;
+  }
+
+  const bool saved = IsBinaryPath(options.convertOutPath)
+                         ? cgul::SaveCgulBinaryFile(options.convertOutPath, doc, &error)
+                         : cgul::SaveCgulFile(options.convertOutPath, doc, &error);
+  if (!saved) {
+    std::cerr << "Save error: " << error << "\n";
+    return 1;
+  }
+
+  // Read the output back so a conversion is only reported once it round-trips exactly.
+  cgul::CgulDocument reloaded;
+  if (!LoadAnyCgul(options.convertOutPath, &reloaded, &error)) {
+    std::cerr << "Reload error: " << error << "\n";
+    return 1;
+  }
+  std::string diff;
+  if (!cgul::Equal(doc, reloaded, &diff)) {
+    std::cerr << "Round-trip mismatch: " << diff << "\n";
+    return 1;
+  }
+
+  std::cout << "Converted " << options.convertInPath << " -> " << options.convertOutPath
+            << " (widgets=" << doc.widgets.size() << ")\n";
+  return 0;
+}
+
+// Exits 0 when the documents are equal, 1 when they differ or cannot be compared.
+int RunDiff(const CliOptions& options) {
+  cgul::CgulDocument from;
+  cgul::CgulDocument to;
+  std::string error;
+  if (!LoadAnyCgul(options.diffFromPath, &from, &error) ||
+      !LoadAnyCgul(options.diffToPath, &to, &error)) {
+    std::cerr << "Load error: " << error << "\n";
+    return 1;
+  }
+
+  cgul::DocumentPatch patch;
+  if (!cgul::DiffDocuments(from, to, &patch, &error)) {
+    std::cerr << "Diff error: " << error << "\n";
+    return 1;
+  }
+  for (const cgul::JournalRecord& record : patch) {
+    std::cout << cgul::DescribeJournalRecord(record) << "\n";
+  }
+  std::cout << "Diff: " << patch.size() << " changes\n";
+  return patch.empty() ? 0 : 1;
+}
+
+int RunValidate(const CliOptions& options) {
+  cgul::CgulDocument doc;
+  std::string error;
+  if (!LoadAnyCgul(options.validatePath, &doc, &error)) {
+    std::cerr << "Load error: " << error << "\n";
+    return 1;
+  }
+
+  cgul::ValidateAllOptions validateOptions;
+  validateOptions.threadCount = options.threads;
+  validateOptions.maxIssues = static_cast<size_t>(options.maxIssues);
+  cgul::ValidationReport report;
+  const bool valid = cgul::ValidateAll(doc, validateOptions, &report);
+  for (const cgul::ValidationIssue& issue : report.issues) {
+    std::cout << cgul::ToString(issue.rule) << ": " << issue.message << "\n";
+  }
+  std::cout << "Validate: " << report.issues.size() << (report.truncated ? "+" : "")
+            << " issues\n";
+  return valid ? 0 : 1;
+}
+
 }  // namespace
 
 int main(int argc, char** argv) {
@@ -365,6 +585,19 @@ int main(int argc, char** argv) {
     return parseError.empty() ? 0 : 1;
   }
 
+  if (!options.batchDir.empty()) {
+    return RunBatch(options);
+  }
+  if (!options.convertInPath.empty()) {
+    return RunConvert(options);
+  }
+  if (!options.diffFromPath.empty()) {
+    return RunDiff(options);
+  }
+  if (!options.validatePath.empty()) {
+    return RunValidate(options);
+  }
+
   cgul::CgulDocument generatedDoc;
   bool generatedReady = false;
 
@@ -1,5 +1,12 @@
+#include "cgul/core/cell_occupancy.h"
+#include "cgul/core/document_diff.h"
+#include "cgul/core/document_history.h"
+#include "cgul/core/document_index.h"
 #include "cgul/core/equality.h"
+#include "cgul/core/placement.h"
+#include "cgul/core/widget_spatial_index.h"
 #include "cgul/io/cgul_document.h"
+#include "cgul/io/cgul_journal.h"
 #include "cgul/render/layout_composer.h"
 #include "cgul/validate/validate.h"
 #include "glyph_grid_renderer.h"
@@ -49,6 +56,7 @@ struct EditState {
   uint32_t widgetId = 0;
   int dragOffsetX = 0;
   int dragOffsetY = 0;
+  cgul::RectI startBounds;
 };
 
 bool ParseU32(const std::string& text, uint32_t* outValue) {
@@ -216,10 +224,6 @@ bool ParseArgs(int argc, char** argv, CliOptions* outOptions, std::string* outEr
   return true;
 }
 
-bool RectanglesOverlap(const cgul::RectI& a, const cgul::RectI& b) {
-  return a.x < (b.x + b.w) && b.x < (a.x + a.w) && a.y < (b.y + b.h) && b.y < (a.y + a.h);
-}
-
 bool ContainsCell(const cgul::RectI& rect, int cellX, int cellY) {
   return cellX >= rect.x && cellY >= rect.y && cellX < (rect.x + rect.w) && cellY < (rect.y + rect.h);
 }
@@ -234,39 +238,6 @@ bool IsResizeHandleCell(const cgul::RectI& rect, int cellX, int cellY) {
   return cellX >= rx - 1 && cellX <= rx && cellY >= ry - 1 && cellY <= ry;
 }
 
-cgul::Widget* FindWidgetById(cgul::CgulDocument* doc, uint32_t id) {
-  if (doc == nullptr) {
-    return nullptr;
-  }
-  for (cgul::Widget& widget : doc->widgets) {
-    if (widget.id == id) {
-      return &widget;
-    }
-  }
-  return nullptr;
-}
-
-const cgul::Widget* FindWidgetById(const cgul::CgulDocument& doc, uint32_t id) {
-  for (const cgul::Widget& widget : doc.widgets) {
-    if (widget.id == id) {
-      return &widget;
-    }
-  }
-  return nullptr;
-}
-
-uint32_t FindTopWidgetAtCell(const cgul::CgulDocument& doc, int cellX, int cellY) {
-  for (auto it = doc.widgets.rbegin(); it != doc.widgets.rend(); ++it) {
-    if (it->kind != cgul::WidgetKind::Window) {
-      continue;
-    }
-    if (ContainsCell(it->boundsCells, cellX, cellY)) {
-      return it->id;
-    }
-  }
-  return 0;
-}
-
 std::optional<cgul::CgulDocument> GenerateDeterministicLayout(uint32_t seed, int desiredWindowCount,
                                                               int gridW, int gridH) {
   std::mt19937_64 rng(seed);
@@ -279,6 +250,7 @@ std::optional<cgul::CgulDocument> GenerateDeterministicLayout(uint32_t seed, int
     doc.gridHCells = gridH;
     doc.seed = seed;
 
+    cgul::CellOccupancy occupancy(gridW, gridH);
     bool allPlaced = true;
     for (int i = 0; i < targetCount; ++i) {
       const uint32_t id = static_cast<uint32_t>(i + 1);
@@ -308,16 +280,7 @@ std::optional<cgul::CgulDocument> GenerateDeterministicLayout(uint32_t seed, int
         std::uniform_int_distribution<int> yDist(0, gridH - h);
 
         const cgul::RectI candidate{xDist(rng), yDist(rng), w, h};
-
-        bool overlap = false;
-        for (const cgul::Widget& existing : doc.widgets) {
-          if (RectanglesOverlap(candidate, existing.boundsCells)) {
-            overlap = true;
-            break;
-          }
-        }
-
-        if (!overlap) {
+        if (occupancy.IsFree(candidate)) {
           placedRect = candidate;
           placed = true;
         }
@@ -327,6 +290,7 @@ std::optional<cgul::CgulDocument> GenerateDeterministicLayout(uint32_t seed, int
         allPlaced = false;
         break;
       }
+      occupancy.Fill(placedRect);
 
       cgul::Widget widget;
       widget.id = id;
@@ -347,61 +311,101 @@ std::optional<cgul::CgulDocument> GenerateDeterministicLayout(uint32_t seed, int
   return std::nullopt;
 }
 
-bool SaveWithRoundTripCheck(const std::string& path, const cgul::CgulDocument& doc) {
+// Writes a fresh base file and starts an empty edit journal next to it. The document is
+// validated first; the base is written straight from it, so there is nothing to re-check.
+bool SaveDocumentFile(const std::string& path, const cgul::CgulDocument& doc,
+                      cgul::CgulJournal* journal) {
   std::string error;
   if (!cgul::Validate(doc, &error)) {
     std::cerr << "Save failed validation: " << error << "\n";
     return false;
   }
 
-  if (!cgul::SaveCgulFile(path, doc, &error)) {
+  if (!journal->Create(path, doc, &error)) {
     std::cerr << "Save failed: " << error << "\n";
     return false;
   }
 
-  cgul::CgulDocument reloaded;
-  if (!cgul::LoadCgulFile(path, &reloaded, &error)) {
-    std::cerr << "Round-trip reload failed: " << error << "\n";
-    return false;
-  }
-
-  if (!cgul::Validate(reloaded, &error)) {
-    std::cerr << "Round-trip validate failed: " << error << "\n";
-    return false;
-  }
-
-  std::string diff;
-  if (!cgul::Equal(doc, reloaded, &diff)) {
-    std::cerr << "Round-trip equality FAIL: " << diff << "\n";
-    return false;
-  }
-
-  std::cout << "Round-trip PASS: " << path << "\n";
+  std::cout << "Saved: " << path << "\n";
   return true;
 }
 
-bool LoadDocumentFile(const std::string& path, cgul::CgulDocument* outDoc) {
+// Loads the base file and replays its edit journal.
+bool LoadDocumentFile(const std::string& path, cgul::CgulDocument* outDoc,
+                      cgul::CgulJournal* journal) {
   if (outDoc == nullptr) {
     return false;
   }
 
   std::string error;
   cgul::CgulDocument loaded;
-  if (!cgul::LoadCgulFile(path, &loaded, &error)) {
+  if (!journal->Open(path, &loaded, &error)) {
     std::cerr << "Load failed: " << error << "\n";
     return false;
   }
 
   if (!cgul::Validate(loaded, &error)) {
+    // The journal now belongs to the rejected file while the old document stays on screen;
+    // later edits must not be appended to it.
+    journal->Close();
     std::cerr << "Load validation failed: " << error << "\n";
     return false;
   }
 
   *outDoc = std::move(loaded);
-  std::cout << "Loaded: " << path << "\n";
+  std::cout << "Loaded: " << path << " (journal " << journal->journalBytes() << " bytes)\n";
   return true;
 }
 
+// Records a finished drag or resize as one journal append instead of rewriting the file.
+void JournalEdit(const EditState& edit, const cgul::DocumentIndex& index, cgul::CgulJournal* journal) {
+  const cgul::Widget* widget = index.Find(edit.widgetId);
+  if (!journal->isOpen() || widget == nullptr) {
+    return;
+  }
+
+  const cgul::RectI& bounds = widget->boundsCells;
+  std::string error;
+  bool ok = true;
+  if (bounds.x != edit.startBounds.x || bounds.y != edit.startBounds.y) {
+    ok = journal->Append(cgul::MakeMoveWidgetRecord(widget->id, bounds.x, bounds.y), &error);
+  }
+  if (ok && (bounds.w != edit.startBounds.w || bounds.h != edit.startBounds.h)) {
+    ok = journal->Append(cgul::MakeResizeWidgetRecord(widget->id, bounds.w, bounds.h), &error);
+  }
+  if (ok) {
+    ok = journal->CompactIfNeeded(*index.document(), &error);
+  }
+  if (!ok) {
+    std::cerr << "Journal write failed: " << error << "\n";
+    journal->Close();
+  }
+}
+
+// Replaces the document with the history's current version (after undo or redo) and
+// journals the difference, so base + journal still equals what is on screen.
+void RestoreFromHistory(const cgul::DocumentHistory& history, cgul::CgulDocument* doc,
+                        cgul::DocumentIndex* index, cgul::CgulJournal* journal) {
+  cgul::CgulDocument restored = history.current().ToDocument();
+  if (journal->isOpen()) {
+    cgul::DocumentPatch patch;
+    std::string error;
+    bool ok = cgul::DiffDocuments(*doc, restored, &patch, &error);
+    for (size_t i = 0; ok && i < patch.size(); ++i) {
+      ok = journal->Append(patch[i], &error);
+    }
+    if (ok) {
+      ok = journal->CompactIfNeeded(restored, &error);
+    }
+    if (!ok) {
+      std::cerr << "Journal write failed: " << error << "\n";
+      journal->Close();
+    }
+  }
+  *doc = std::move(restored);
+  index->Rebuild(nullptr);
+}
+
 bool PixelToCell(const sf::Vector2i& pixel, int gridW, int gridH, int* outCellX, int* outCellY) {
   if (outCellX == nullptr || outCellY == nullptr) {
     return false;
@@ -526,31 +530,61 @@ void DrawPixelDocument(sf::RenderWindow& window, const cgul::CgulDocument& doc,
   }
 }
 
-bool ApplyCandidateIfValid(cgul::CgulDocument* doc, const cgul::CgulDocument& candidate) {
-  if (doc == nullptr) {
+// Applies new bounds to one widget in place and reverts them if the result is invalid, so a
+// drag step costs no document copy.
+// Runs on every mouse move of a drag, so only the edited widget is checked.
+bool ApplyCandidateIfValid(cgul::DocumentIndex* index, cgul::EditValidator* validator,
+                           uint32_t widgetId, const cgul::RectI& candidateBounds) {
+  std::string error;
+  if (!validator->ValidateEdit(widgetId, candidateBounds, &error)) {
     return false;
   }
+  index->SetBounds(widgetId, candidateBounds);
+  return true;
+}
 
+// Drag step: when the candidate overlaps another window, moves to the nearest free position
+// instead, so the window slides along its neighbours rather than stopping.
+bool ApplyDragCandidate(cgul::DocumentIndex* index, cgul::EditValidator* validator,
+                        uint32_t widgetId, const cgul::RectI& candidateBounds) {
+  if (ApplyCandidateIfValid(index, validator, widgetId, candidateBounds)) {
+    return true;
+  }
+  const cgul::Widget* widget = index->Find(widgetId);
+  cgul::RectI nearest;
   std::string error;
-  if (!cgul::Validate(candidate, &error)) {
+  if (widget == nullptr || !cgul::FindNearestFreePlacement(*index->document(), widgetId,
+                                                           candidateBounds, &nearest, &error)) {
     return false;
   }
-
-  *doc = candidate;
-  return true;
+  const cgul::RectI& current = widget->boundsCells;
+  if (nearest.x == current.x && nearest.y == current.y) {
+    return false;
+  }
+  return ApplyCandidateIfValid(index, validator, widgetId, nearest);
 }
 
 int RunApp(const CliOptions& options) {
   cgul::CgulDocument doc;
+  // Id lookups for hit-testing and editing; rebuilt whenever `doc` is replaced wholesale.
+  cgul::DocumentIndex index(&doc);
+  // Drag/resize checks; follows `index`, including its rebuilds.
+  cgul::EditValidator editValidator(&index);
+  // Window hit-testing for clicks and pixel-mode hover; follows `index` like the validator.
+  cgul::WidgetSpatialIndex hitIndex(&index);
 
   uint32_t currentSeed = options.seed;
   int desiredWindowCount = std::max(1, options.windowCount);
   std::string activeSavePath = options.savePath;
   bool glyphMode = options.startGlyphMode;
+  // Open while `doc` equals base + journal; closed when a new layout replaces the document.
+  cgul::CgulJournal journal;
+  // Finished edits and generated layouts; Ctrl+Z / Ctrl+Y step through them.
+  cgul::DocumentHistory history;
 
   if (options.startupLoadPath.has_value()) {
     activeSavePath = *options.startupLoadPath;
-    if (!LoadDocumentFile(*options.startupLoadPath, &doc)) {
+    if (!LoadDocumentFile(*options.startupLoadPath, &doc, &journal)) {
       return 1;
     }
     currentSeed = static_cast<uint32_t>(doc.seed);
@@ -563,10 +597,12 @@ int RunApp(const CliOptions& options) {
     }
     doc = *generated;
   }
+  index.Rebuild(nullptr);
+  history.Reset(cgul::PersistentDocument::FromDocument(doc));
 
   if (options.startupSavePath.has_value()) {
     activeSavePath = *options.startupSavePath;
-    if (!SaveWithRoundTripCheck(*options.startupSavePath, doc)) {
+    if (!SaveDocumentFile(*options.startupSavePath, doc, &journal)) {
       return 1;
     }
   }
@@ -596,6 +632,9 @@ int RunApp(const CliOptions& options) {
 
   bool showGrid = false;
   EditState edit;
+  // Recomposed only when the index revision moves; every edit and Rebuild bumps it.
+  cgul::Frame frame;
+  uint64_t composedRevision = 0;
 
   while (window.isOpen()) {
     while (const std::optional event = window.pollEvent()) {
@@ -607,6 +646,18 @@ int RunApp(const CliOptions& options) {
       if (const auto* keyPressed = event->getIf<sf::Event::KeyPressed>()) {
         const auto scancode = keyPressed->scancode;
 
+        const bool undo = keyPressed->control && !keyPressed->shift &&
+                          scancode == sf::Keyboard::Scancode::Z;
+        const bool redo = keyPressed->control &&
+                          (scancode == sf::Keyboard::Scancode::Y ||
+                           (keyPressed->shift && scancode == sf::Keyboard::Scancode::Z));
+        if (undo || redo) {
+          if (edit.mode == EditMode::None && (undo ? history.Undo() : history.Redo())) {
+            RestoreFromHistory(history, &doc, &index, &journal);
+          }
+          continue;
+        }
+
         if (scancode == sf::Keyboard::Scancode::Escape) {
           window.close();
           continue;
@@ -623,22 +674,25 @@ int RunApp(const CliOptions& options) {
               GenerateDeterministicLayout(currentSeed, desiredWindowCount, doc.gridWCells, doc.gridHCells);
           if (generated.has_value()) {
             doc = *generated;
+            index.Rebuild(nullptr);
+            journal.Close();
+            history.Commit(cgul::PersistentDocument::FromDocument(doc));
             std::cout << "Generated layout with seed " << currentSeed << " windows=" << doc.widgets.size() << "\n";
           }
           continue;
         }
 
         if (scancode == sf::Keyboard::Scancode::S) {
-          if (SaveWithRoundTripCheck(activeSavePath, doc)) {
-            std::cout << "Saved: " << activeSavePath << "\n";
-          }
+          SaveDocumentFile(activeSavePath, doc, &journal);
           continue;
         }
 
         if (scancode == sf::Keyboard::Scancode::L) {
           cgul::CgulDocument loaded;
-          if (LoadDocumentFile(activeSavePath, &loaded)) {
+          if (LoadDocumentFile(activeSavePath, &loaded, &journal)) {
             doc = std::move(loaded);
+            index.Rebuild(nullptr);
+            history.Reset(cgul::PersistentDocument::FromDocument(doc));
           }
           continue;
         }
@@ -655,6 +709,9 @@ int RunApp(const CliOptions& options) {
               GenerateDeterministicLayout(currentSeed, desiredWindowCount, doc.gridWCells, doc.gridHCells);
           if (generated.has_value()) {
             doc = *generated;
+            index.Rebuild(nullptr);
+            journal.Close();
+            history.Commit(cgul::PersistentDocument::FromDocument(doc));
             std::cout << "Window count " << desiredWindowCount << " seed=" << currentSeed << "\n";
           }
           continue;
@@ -667,6 +724,9 @@ int RunApp(const CliOptions& options) {
               GenerateDeterministicLayout(currentSeed, desiredWindowCount, doc.gridWCells, doc.gridHCells);
           if (generated.has_value()) {
             doc = *generated;
+            index.Rebuild(nullptr);
+            journal.Close();
+            history.Commit(cgul::PersistentDocument::FromDocument(doc));
             std::cout << "Window count " << desiredWindowCount << " seed=" << currentSeed << "\n";
           }
           continue;
@@ -687,6 +747,9 @@ int RunApp(const CliOptions& options) {
               GenerateDeterministicLayout(currentSeed, desiredWindowCount, doc.gridWCells, doc.gridHCells);
           if (generated.has_value()) {
             doc = *generated;
+            index.Rebuild(nullptr);
+            journal.Close();
+            history.Commit(cgul::PersistentDocument::FromDocument(doc));
             std::cout << "Generated layout with seed " << currentSeed << " windows=" << doc.widgets.size() << "\n";
           }
           continue;
@@ -698,8 +761,8 @@ int RunApp(const CliOptions& options) {
           continue;
         }
 
-        const uint32_t widgetId = FindTopWidgetAtCell(doc, cellX, cellY);
-        const cgul::Widget* widget = FindWidgetById(doc, widgetId);
+        const uint32_t widgetId = hitIndex.TopWidgetAt(cellX, cellY, cgul::WidgetKind::Window);
+        const cgul::Widget* widget = index.Find(widgetId);
         if (widget == nullptr || widget->kind != cgul::WidgetKind::Window) {
           continue;
         }
@@ -707,12 +770,14 @@ int RunApp(const CliOptions& options) {
         if (IsResizeHandleCell(widget->boundsCells, cellX, cellY)) {
           edit.mode = EditMode::Resize;
           edit.widgetId = widgetId;
+          edit.startBounds = widget->boundsCells;
           continue;
         }
 
         if (IsTitleBarCell(widget->boundsCells, cellX, cellY)) {
           edit.mode = EditMode::Drag;
           edit.widgetId = widgetId;
+          edit.startBounds = widget->boundsCells;
           edit.dragOffsetX = cellX - widget->boundsCells.x;
           edit.dragOffsetY = cellY - widget->boundsCells.y;
           continue;
@@ -720,6 +785,14 @@ int RunApp(const CliOptions& options) {
       }
 
       if (event->is<sf::Event::MouseButtonReleased>()) {
+        if (edit.mode != EditMode::None) {
+          JournalEdit(edit, index, &journal);
+          const size_t position = index.IndexOf(edit.widgetId);
+          if (position != cgul::DocumentIndex::kNotFound &&
+              !cgul::Equal(doc.widgets[position].boundsCells, edit.startBounds)) {
+            history.Commit(history.current().WithWidget(position, doc.widgets[position]));
+          }
+        }
         edit.mode = EditMode::None;
         edit.widgetId = 0;
       }
@@ -735,41 +808,47 @@ int RunApp(const CliOptions& options) {
           continue;
         }
 
-        cgul::CgulDocument candidate = doc;
-        cgul::Widget* candidateWidget = FindWidgetById(&candidate, edit.widgetId);
-        if (candidateWidget == nullptr) {
+        const cgul::Widget* widget = index.Find(edit.widgetId);
+        if (widget == nullptr) {
           continue;
         }
+        cgul::RectI candidate = widget->boundsCells;
 
         if (edit.mode == EditMode::Drag) {
-          const int maxX = candidate.gridWCells - candidateWidget->boundsCells.w;
-          const int maxY = candidate.gridHCells - candidateWidget->boundsCells.h;
-          candidateWidget->boundsCells.x = std::clamp(cellX - edit.dragOffsetX, 0, std::max(0, maxX));
-          candidateWidget->boundsCells.y =
-              std::clamp(cellY - edit.dragOffsetY, 0, std::max(0, maxY));
+          const int maxX = doc.gridWCells - candidate.w;
+          const int maxY = doc.gridHCells - candidate.h;
+          candidate.x = std::clamp(cellX - edit.dragOffsetX, 0, std::max(0, maxX));
+          candidate.y = std::clamp(cellY - edit.dragOffsetY, 0, std::max(0, maxY));
         } else if (edit.mode == EditMode::Resize) {
-          const int x = candidateWidget->boundsCells.x;
-          const int y = candidateWidget->boundsCells.y;
+          const int x = candidate.x;
+          const int y = candidate.y;
           int newW = cellX - x + 1;
           int newH = cellY - y + 1;
 
-          const int maxW = std::max(1, candidate.gridWCells - x);
-          const int maxH = std::max(1, candidate.gridHCells - y);
+          const int maxW = std::max(1, doc.gridWCells - x);
+          const int maxH = std::max(1, doc.gridHCells - y);
           const int minW = std::min(kMinWinWCells, maxW);
           const int minH = std::min(kMinWinHCells, maxH);
 
           newW = std::clamp(newW, minW, maxW);
           newH = std::clamp(newH, minH, maxH);
 
-          candidateWidget->boundsCells.w = newW;
-          candidateWidget->boundsCells.h = newH;
+          candidate.w = newW;
+          candidate.h = newH;
         }
 
-        ApplyCandidateIfValid(&doc, candidate);
+        if (edit.mode == EditMode::Drag) {
+          ApplyDragCandidate(&index, &editValidator, edit.widgetId, candidate);
+        } else {
+          ApplyCandidateIfValid(&index, &editValidator, edit.widgetId, candidate);
+        }
       }
     }
 
-    const cgul::Frame frame = cgul::ComposeLayoutToFrame(doc);
+    if (composedRevision != index.revision()) {
+      frame = cgul::ComposeLayoutToFrame(doc);
+      composedRevision = index.revision();
+    }
 
     const sf::Vector2i mousePixel = sf::Mouse::getPosition(window);
     std::optional<sf::Vector2i> hoveredCell;
@@ -782,7 +861,8 @@ int RunApp(const CliOptions& options) {
     uint32_t hoveredPixelId = 0;
     uint32_t hoveredGlyphId = 0;
     if (hoveredCell.has_value()) {
-      hoveredPixelId = FindTopWidgetAtCell(doc, hoveredCell->x, hoveredCell->y);
+      hoveredPixelId =
+          hitIndex.TopWidgetAt(hoveredCell->x, hoveredCell->y, cgul::WidgetKind::Window);
       hoveredGlyphId = cgul::hit_test_widget(frame, hoveredCell->x, hoveredCell->y);
     }
 
@@ -811,7 +891,7 @@ int RunApp(const CliOptions& options) {
     std::string modeText = glyphMode ? "Mode: GLYPH (F1)" : "Mode: PIXEL (F1)";
     const std::string status = modeText + "  " + hoverText + "  Seed: " + std::to_string(currentSeed) +
                                "  Windows: " + std::to_string(desiredWindowCount) +
-                               "  Save/Load: S/L  Grid: F3";
+                               "  Save/Load: S/L  Grid: F3  Undo/Redo: Ctrl+Z/Y";
     DrawText(window, fontPtr, status, 150.f, 12.f, 14, sf::Color(220, 220, 220));
 
     if (!glyphMode) {
@@ -1,15 +1,15 @@
 #include "app/DemoPersistence.hpp"
 
-#include "cgul/core/equality.h"
 #include "cgul/io/cgul_document.h"
 #include "cgul/validate/validate.h"
 
 #include <SDL.h>
 
 #include <cerrno>
+#include <cstdint>
 #include <cstdlib>
 #include <filesystem>
-#include <sstream>
+#include <limits>
 #include <string>
 
 namespace cgul_demo {
@@ -33,35 +33,29 @@ bool SetError(const std::string& message, std::string* outError) {
     return false;
 }
 
-std::string FloatToString(float value) {
-    std::ostringstream os;
-    os.setf(std::ios::fixed, std::ios::floatfield);
-    os.precision(6);
-    os << value;
-    return os.str();
-}
-
-bool ParseIntString(const std::string& text, int* outValue) {
-    if (!outValue || text.empty()) {
+// State files written before meta was typed hold every value as text ("25", "1.948717", "true").
+// These parse such legacy strings; current files store values typed and never reach them.
+bool ParseLegacyInt(const std::string& text, int64_t* outValue) {
+    if (text.empty()) {
         return false;
     }
     char* end = nullptr;
     errno = 0;
-    const long parsed = std::strtol(text.c_str(), &end, 10);
+    const long long parsed = std::strtoll(text.c_str(), &end, 10);
     if (errno != 0 || end == text.c_str() || *end != '\0') {
         return false;
     }
-    *outValue = static_cast<int>(parsed);
+    *outValue = static_cast<int64_t>(parsed);
     return true;
 }
 
-bool ParseFloatString(const std::string& text, float* outValue) {
-    if (!outValue || text.empty()) {
+bool ParseLegacyFloat(const std::string& text, double* outValue) {
+    if (text.empty()) {
         return false;
     }
     char* end = nullptr;
     errno = 0;
-    const float parsed = std::strtof(text.c_str(), &end);
+    const double parsed = std::strtod(text.c_str(), &end);
     if (errno != 0 || end == text.c_str() || *end != '\0') {
         return false;
     }
@@ -69,10 +63,7 @@ bool ParseFloatString(const std::string& text, float* outValue) {
     return true;
 }
 
-bool ParseBoolString(const std::string& text, bool* outValue) {
-    if (!outValue) {
-        return false;
-    }
+bool ParseLegacyBool(const std::string& text, bool* outValue) {
     if (text == "1" || text == "true" || text == "TRUE") {
         *outValue = true;
         return true;
@@ -84,49 +75,54 @@ bool ParseBoolString(const std::string& text, bool* outValue) {
     return false;
 }
 
+bool MetaError(const cgul::CgulDocument& doc, const std::string& key, const char* type,
+    std::string* outError) {
+    if (doc.meta.count(key) == 0) {
+        return SetError("Missing metadata key: " + key, outError);
+    }
+    return SetError(std::string("Invalid ") + type + " metadata for key: " + key, outError);
+}
+
 bool ReadMetaString(const cgul::CgulDocument& doc, const std::string& key, std::string* outValue,
     std::string* outError) {
     if (!outValue) {
         return SetError("ReadMetaString: outValue is null", outError);
     }
-    const auto it = doc.meta.find(key);
-    if (it == doc.meta.end()) {
-        return SetError("Missing metadata key: " + key, outError);
+    if (!doc.meta.GetString(key, outValue)) {
+        return MetaError(doc, key, "string", outError);
     }
-    *outValue = it->second;
     return true;
 }
 
 bool ReadMetaInt(const cgul::CgulDocument& doc, const std::string& key, int* outValue, std::string* outError) {
-    std::string value;
-    if (!ReadMetaString(doc, key, &value, outError)) {
-        return false;
-    }
-    if (!ParseIntString(value, outValue)) {
-        return SetError("Invalid integer metadata for key: " + key, outError);
-    }
+    int64_t value = 0;
+    std::string legacy;
+    const bool read = doc.meta.GetInt(key, &value) ||
+        (doc.meta.GetString(key, &legacy) && ParseLegacyInt(legacy, &value));
+    if (!read || value < std::numeric_limits<int>::min() || value > std::numeric_limits<int>::max()) {
+        return MetaError(doc, key, "integer", outError);
+    }
+    *outValue = static_cast<int>(value);
     return true;
 }
 
 bool ReadMetaFloat(
     const cgul::CgulDocument& doc, const std::string& key, float* outValue, std::string* outError) {
-    std::string value;
-    if (!ReadMetaString(doc, key, &value, outError)) {
-        return false;
-    }
-    if (!ParseFloatString(value, outValue)) {
-        return SetError("Invalid float metadata for key: " + key, outError);
+    double value = 0.0;
+    std::string legacy;
+    if (!doc.meta.GetFloat(key, &value) &&
+        !(doc.meta.GetString(key, &legacy) && ParseLegacyFloat(legacy, &value))) {
+        return MetaError(doc, key, "float", outError);
     }
+    *outValue = static_cast<float>(value);
     return true;
 }
 
 bool ReadMetaBool(const cgul::CgulDocument& doc, const std::string& key, bool* outValue, std::string* outError) {
-    std::string value;
-    if (!ReadMetaString(doc, key, &value, outError)) {
-        return false;
-    }
-    if (!ParseBoolString(value, outValue)) {
-        return SetError("Invalid boolean metadata for key: " + key, outError);
+    std::string legacy;
+    if (!doc.meta.GetBool(key, outValue) &&
+        !(doc.meta.GetString(key, &legacy) && ParseLegacyBool(legacy, outValue))) {
+        return MetaError(doc, key, "boolean", outError);
     }
     return true;
 }
@@ -136,15 +132,15 @@ cgul::CgulDocument BuildStateDocument(const WorldState& worldState, const tools:
     doc.gridWCells = 1;
     doc.gridHCells = 1;
     doc.seed = 0;
-    doc.meta[kMetaCameraTileX] = FloatToString(worldState.cameraTileX);
-    doc.meta[kMetaCameraTileY] = FloatToString(worldState.cameraTileY);
-    doc.meta[kMetaZoom] = FloatToString(worldState.zoom);
+    doc.meta[kMetaCameraTileX] = cgul::MetaValue::FromFloat(worldState.cameraTileX);
+    doc.meta[kMetaCameraTileY] = cgul::MetaValue::FromFloat(worldState.cameraTileY);
+    doc.meta[kMetaZoom] = cgul::MetaValue::FromFloat(worldState.zoom);
     doc.meta[kMetaInputPath] = tool.GetInputPath();
     doc.meta[kMetaChunkType] = tool.GetChunkType();
-    doc.meta[kMetaChunkWidthTiles] = std::to_string(tool.GetChunkWidthTiles());
-    doc.meta[kMetaChunkHeightTiles] = std::to_string(tool.GetChunkHeightTiles());
-    doc.meta[kMetaTileSizeIndex] = std::to_string(tool.GetTileSizeIndex());
-    doc.meta[kMetaExportNonEmptyOnly] = tool.GetExportNonEmptyOnly() ? "true" : "false";
+    doc.meta[kMetaChunkWidthTiles] = cgul::MetaValue::FromInt(tool.GetChunkWidthTiles());
+    doc.meta[kMetaChunkHeightTiles] = cgul::MetaValue::FromInt(tool.GetChunkHeightTiles());
+    doc.meta[kMetaTileSizeIndex] = cgul::MetaValue::FromInt(tool.GetTileSizeIndex());
+    doc.meta[kMetaExportNonEmptyOnly] = cgul::MetaValue::FromBool(tool.GetExportNonEmptyOnly());
     if (!tool.GetOutputRoot().empty()) {
         doc.meta[kMetaOutputRoot] = tool.GetOutputRoot().string();
     }
@@ -184,25 +180,8 @@ bool SaveStateCgul(const std::filesystem::path& path, const WorldState& worldSta
         return SetError(error, outError);
     }
 
-    cgul::CgulDocument reloaded;
-    if (!cgul::LoadCgulFile(path.string(), &reloaded, &error)) {
-        SDL_Log("State round-trip load failed: %s", error.c_str());
-        return SetError(error, outError);
-    }
-
-    if (!cgul::Validate(reloaded, &error)) {
-        SDL_Log("State round-trip validate failed: %s", error.c_str());
-        return SetError(error, outError);
-    }
-
-    std::string diff;
-    if (!cgul::Equal(doc, reloaded, &diff)) {
-        SDL_Log("State round-trip FAIL: %s", diff.c_str());
-        return SetError(diff, outError);
-    }
-
     SDL_Log(
-        "Round-trip PASS: %s | camera=(%.2f,%.2f) zoom=%.2f chunk=%dx%d tileIdx=%d chunkType=%s input=%s",
+        "Saved state: %s | camera=(%.2f,%.2f) zoom=%.2f chunk=%dx%d tileIdx=%d chunkType=%s input=%s",
         path.string().c_str(), worldState.cameraTileX, worldState.cameraTileY, worldState.zoom,
         tool.GetChunkWidthTiles(), tool.GetChunkHeightTiles(), tool.GetTileSizeIndex(),
         tool.GetChunkType().c_str(), tool.GetInputPath().c_str());
@@ -253,10 +232,7 @@ bool LoadStateCgul(const std::filesystem::path& path, WorldState* worldState, to
         return false;
     }
 
-    const auto outputIt = doc.meta.find(kMetaOutputRoot);
-    if (outputIt != doc.meta.end()) {
-        outputRoot = outputIt->second;
-    }
+    doc.meta.GetString(kMetaOutputRoot, &outputRoot);
 
     tool->SetInputPath(inputPath);
     tool->LoadMapFromInputPath();
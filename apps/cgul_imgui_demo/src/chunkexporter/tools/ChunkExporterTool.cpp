@@ -266,6 +266,9 @@ ChunkExporterTool::ChunkExporterTool(
 }
 
 ChunkExporterTool::~ChunkExporterTool() {
+    if (exportThread_.joinable()) {
+        exportThread_.join();
+    }
     if (previewTexture_) {
         SDL_DestroyTexture(previewTexture_);
         previewTexture_ = nullptr;
@@ -280,6 +283,7 @@ void ChunkExporterTool::Draw() {
 }
 
 void ChunkExporterTool::DrawContent(bool includePreview) {
+    PollExport();
     ImGui::TextUnformatted("Input Map");
     ImGui::InputText("Map JSON", inputPath_.data(), inputPath_.size());
     if (ImGui::Button("Load")) {
@@ -349,8 +353,8 @@ void ChunkExporterTool::DrawContent(bool includePreview) {
 
     if (hasMap_) {
         ImGui::Separator();
-        ImGui::Text("Map Size: %d x %d tiles", map_.width, map_.height);
-        ImGui::Text("Tile Size: %d x %d px", map_.tileWidth, map_.tileHeight);
+        ImGui::Text("Map Size: %d x %d tiles", map_->width, map_->height);
+        ImGui::Text("Tile Size: %d x %d px", map_->tileWidth, map_->tileHeight);
 
         int chunkTypeIndex = chunkType_ == "water" ? 1 : 0;
         if (ImGui::Combo("Chunk Type", &chunkTypeIndex, kChunkTypeLabels, static_cast<int>(kChunkTypeCount))) {
@@ -387,19 +391,19 @@ void ChunkExporterTool::DrawContent(bool includePreview) {
     }
 
     const int selectedTileSize = kTileSizeOptions[tileSizeIndex_];
-    if (hasMap_ && (map_.tileWidth != selectedTileSize || map_.tileHeight != selectedTileSize)) {
-        ImGui::TextColored(ImVec4(1.0f, 0.7f, 0.2f, 1.0f), "Warning: map tile size is %dx%d", map_.tileWidth,
-            map_.tileHeight);
+    if (hasMap_ && (map_->tileWidth != selectedTileSize || map_->tileHeight != selectedTileSize)) {
+        ImGui::TextColored(ImVec4(1.0f, 0.7f, 0.2f, 1.0f), "Warning: map tile size is %dx%d", map_->tileWidth,
+            map_->tileHeight);
     }
 
     ImGui::Checkbox("Export only non-empty chunks", &exportNonEmptyOnly_);
     ImGui::Text("Output Root: %s", outputRoot_.string().c_str());
 
-    bool canExport = hasMap_;
+    bool canExport = hasMap_ && !exportRunning_;
     if (!canExport) {
         ImGui::BeginDisabled();
     }
-    if (ImGui::Button("Export")) {
+    if (ImGui::Button(exportRunning_ ? "Exporting..." : "Export")) {
         ExportChunks();
     }
     if (!canExport) {
@@ -430,7 +434,7 @@ bool ChunkExporterTool::HasMap() const {
 }
 
 const tiled::TiledMap& ChunkExporterTool::GetMap() const {
-    return map_;
+    return *map_;
 }
 
 const std::string& ChunkExporterTool::GetInputPath() const {
@@ -494,6 +498,10 @@ int ChunkExporterTool::GetSelectedTileSizePx() const {
     return GetSelectedTileSize();
 }
 
+bool ChunkExporterTool::IsExporting() const {
+    return exportRunning_;
+}
+
 bool ChunkExporterTool::GetExportNonEmptyOnly() const {
     return exportNonEmptyOnly_;
 }
@@ -587,7 +595,7 @@ void ChunkExporterTool::LoadMapFromPath() {
         return;
     }
 
-    map_ = loaded;
+    PublishMap(std::move(loaded));
     hasMap_ = true;
     statusText_ = "Loaded map: " + inputPath.string();
     chunkType_ = InferChunkType(inputPath);
@@ -605,6 +613,13 @@ void ChunkExporterTool::LoadMapFromPath() {
     }
 }
 
+void ChunkExporterTool::PublishMap(tiled::TiledMap map) {
+    // Unpin first so the replaced version can be freed right away unless an export holds it.
+    map_.Release();
+    mapSnapshot_.Publish(std::move(map));
+    map_ = mapSnapshot_.Read();
+}
+
 void ChunkExporterTool::ResetLoadedMap() {
     loadError_.clear();
     renderError_.clear();
@@ -612,7 +627,7 @@ void ChunkExporterTool::ResetLoadedMap() {
     lastOutputPath_.clear();
     exportProgress_ = 0.0f;
     hasMap_ = false;
-    map_ = tiled::TiledMap{};
+    PublishMap(tiled::TiledMap{});
     previewDirty_ = false;
     if (previewTexture_) {
         SDL_DestroyTexture(previewTexture_);
@@ -697,25 +712,25 @@ void ChunkExporterTool::DrawTilemapRender() {
     const float imageW = max.x - min.x;
     const float imageH = max.y - min.y;
 
-    if (imageW > 0.0f && imageH > 0.0f && map_.width > 0 && map_.height > 0) {
+    if (imageW > 0.0f && imageH > 0.0f && map_->width > 0 && map_->height > 0) {
         if (ImGui::IsItemHovered()) {
             const ImVec2 mousePos = ImGui::GetMousePos();
             const float relX = (mousePos.x - min.x) / imageW;
             const float relY = (mousePos.y - min.y) / imageH;
             if (relX >= 0.0f && relX <= 1.0f && relY >= 0.0f && relY <= 1.0f) {
-                int mapX = static_cast<int>(relX * static_cast<float>(map_.width));
-                int mapY = static_cast<int>(relY * static_cast<float>(map_.height));
-                mapX = std::max(0, std::min(mapX, map_.width - 1));
-                mapY = std::max(0, std::min(mapY, map_.height - 1));
+                int mapX = static_cast<int>(relX * static_cast<float>(map_->width));
+                int mapY = static_cast<int>(relY * static_cast<float>(map_->height));
+                mapX = std::max(0, std::min(mapX, map_->width - 1));
+                mapY = std::max(0, std::min(mapY, map_->height - 1));
                 hoverTileX_ = mapX;
                 hoverTileY_ = mapY;
 
-                for (std::vector<tiled::TiledLayer>::const_reverse_iterator it = map_.layers.rbegin();
-                     it != map_.layers.rend(); ++it) {
+                for (std::vector<tiled::TiledLayer>::const_reverse_iterator it = map_->layers.rbegin();
+                     it != map_->layers.rend(); ++it) {
                     if (!LayerAllowedForChunkType(chunkType_, it->name)) {
                         continue;
                     }
-                    const uint32_t gid = FindGidAt(*it, map_.width, hoverTileX_, hoverTileY_);
+                    const uint32_t gid = FindGidAt(*it, map_->width, hoverTileX_, hoverTileY_);
                     if (gid != 0) {
                         hoverTopLayerName_ = it->name;
                         break;
@@ -729,23 +744,23 @@ void ChunkExporterTool::DrawTilemapRender() {
         const ImU32 blue = IM_COL32(30, 160, 255, 200);
 
         if (chunkWidthTiles_ > 0) {
-            for (int x = 0; x <= map_.width; x += chunkWidthTiles_) {
-                const float px = min.x + imageW * (static_cast<float>(x) / static_cast<float>(map_.width));
+            for (int x = 0; x <= map_->width; x += chunkWidthTiles_) {
+                const float px = min.x + imageW * (static_cast<float>(x) / static_cast<float>(map_->width));
                 drawList->AddLine(ImVec2(px, min.y), ImVec2(px, max.y), magenta);
             }
         }
         if (chunkHeightTiles_ > 0) {
-            for (int y = 0; y <= map_.height; y += chunkHeightTiles_) {
-                const float py = min.y + imageH * (static_cast<float>(y) / static_cast<float>(map_.height));
+            for (int y = 0; y <= map_->height; y += chunkHeightTiles_) {
+                const float py = min.y + imageH * (static_cast<float>(y) / static_cast<float>(map_->height));
                 drawList->AddLine(ImVec2(min.x, py), ImVec2(max.x, py), blue);
             }
         }
 
         if (hoverTileX_ >= 0 && hoverTileY_ >= 0) {
-            const float x0 = min.x + imageW * (static_cast<float>(hoverTileX_) / static_cast<float>(map_.width));
-            const float y0 = min.y + imageH * (static_cast<float>(hoverTileY_) / static_cast<float>(map_.height));
-            const float x1 = min.x + imageW * (static_cast<float>(hoverTileX_ + 1) / static_cast<float>(map_.width));
-            const float y1 = min.y + imageH * (static_cast<float>(hoverTileY_ + 1) / static_cast<float>(map_.height));
+            const float x0 = min.x + imageW * (static_cast<float>(hoverTileX_) / static_cast<float>(map_->width));
+            const float y0 = min.y + imageH * (static_cast<float>(hoverTileY_) / static_cast<float>(map_->height));
+            const float x1 = min.x + imageW * (static_cast<float>(hoverTileX_ + 1) / static_cast<float>(map_->width));
+            const float y1 = min.y + imageH * (static_cast<float>(hoverTileY_ + 1) / static_cast<float>(map_->height));
             drawList->AddRect(ImVec2(x0, y0), ImVec2(x1, y1), IM_COL32(255, 255, 0, 220), 0.0f, 0, 1.5f);
         }
     }
@@ -775,8 +790,8 @@ void ChunkExporterTool::DrawTileInspector() {
     uint32_t treesGid = 0;
     for (size_t i = 0; i < kInspectorLayerCount; ++i) {
         const char* layerName = kInspectorLayers[i];
-        const tiled::TiledLayer* layer = FindLayerByName(map_.layers, layerName);
-        const uint32_t gid = layer ? FindGidAt(*layer, map_.width, hoverTileX_, hoverTileY_) : 0;
+        const tiled::TiledLayer* layer = FindLayerByName(map_->layers, layerName);
+        const uint32_t gid = layer ? FindGidAt(*layer, map_->width, hoverTileX_, hoverTileY_) : 0;
         ImGui::Text("%-14s gid: %u", layerName, gid);
         if (i == kInspectorTreesIndex) {
             treesGid = gid;
@@ -846,14 +861,14 @@ bool ChunkExporterTool::LoadTilesets() {
         renderError_ = "Renderer not available for tileset load.";
         return false;
     }
-    if (map_.tilesets.empty()) {
+    if (map_->tilesets.empty()) {
         renderError_ = "Map has no tilesets.";
         return false;
     }
 
     tilesets_.clear();
 
-    for (const nlohmann::json& tilesetJson : map_.tilesets) {
+    for (const nlohmann::json& tilesetJson : map_->tilesets) {
         if (!tilesetJson.contains("firstgid")) {
             continue;
         }
@@ -861,13 +876,13 @@ bool ChunkExporterTool::LoadTilesets() {
 
         bool isExternal = false;
         nlohmann::json effectiveTilesetDef = tilesetJson;
-        std::filesystem::path imageBasePath = map_.sourcePath.parent_path();
+        std::filesystem::path imageBasePath = map_->sourcePath.parent_path();
         if (tilesetJson.contains("source")) {
             isExternal = true;
             std::string externalReason;
             std::filesystem::path externalSourcePath;
             nlohmann::json externalDef;
-            if (!LoadExternalTilesetDef(map_.sourcePath, tilesetJson, &externalDef, &externalSourcePath,
+            if (!LoadExternalTilesetDef(map_->sourcePath, tilesetJson, &externalDef, &externalSourcePath,
                     &externalReason)) {
 #ifndef NDEBUG
                 SDL_Log("Skipping external tileset '%s': %s",
@@ -1004,8 +1019,8 @@ bool ChunkExporterTool::EnsurePreviewTexture() {
     const int targetSize = 512;
     const int targetWidth = targetSize;
     int targetHeight = targetSize;
-    if (map_.width > 0 && map_.height > 0) {
-        targetHeight = static_cast<int>(targetSize * (static_cast<float>(map_.height) / static_cast<float>(map_.width)));
+    if (map_->width > 0 && map_->height > 0) {
+        targetHeight = static_cast<int>(targetSize * (static_cast<float>(map_->height) / static_cast<float>(map_->width)));
     }
 
     if (previewTexture_ && previewTexWidth_ == targetWidth && previewTexHeight_ == targetHeight) {
@@ -1048,7 +1063,7 @@ bool ChunkExporterTool::RenderTilemapPreview() {
     SDL_SetRenderDrawColor(renderer_, 0, 0, 0, 0);
     SDL_RenderClear(renderer_);
 
-    if (map_.width <= 0 || map_.height <= 0) {
+    if (map_->width <= 0 || map_->height <= 0) {
         SDL_SetRenderTarget(renderer_, previousTarget);
         return false;
     }
@@ -1061,18 +1076,18 @@ bool ChunkExporterTool::RenderTilemapPreview() {
     std::vector<const tiled::TiledLayer*> terrainLayers;
     terrainLayers.reserve(terrainCount);
     for (size_t i = 0; i < terrainCount; ++i) {
-        terrainLayers.push_back(FindLayerByName(map_.layers, terrainOrder[i]));
+        terrainLayers.push_back(FindLayerByName(map_->layers, terrainOrder[i]));
     }
 
     std::vector<const tiled::TiledLayer*> overlayLayers;
     overlayLayers.reserve(overlayCount);
     for (size_t i = 0; i < overlayCount; ++i) {
-        overlayLayers.push_back(FindLayerByName(map_.layers, overlayOrder[i]));
+        overlayLayers.push_back(FindLayerByName(map_->layers, overlayOrder[i]));
     }
 
 #ifndef NDEBUG
     {
-        const tiled::TiledLayer* treesLayer = FindLayerByName(map_.layers, "Trees");
+        const tiled::TiledLayer* treesLayer = FindLayerByName(map_->layers, "Trees");
         if (treesLayer && treesLayer->isTileLayer && treesLayer->visible) {
             size_t countNonZero = 0;
             size_t flaggedCount = 0;
@@ -1124,9 +1139,9 @@ bool ChunkExporterTool::RenderTilemapPreview() {
 #endif
 
     for (int py = 0; py < previewTexHeight_; ++py) {
-        const int mapY = py * map_.height / previewTexHeight_;
+        const int mapY = py * map_->height / previewTexHeight_;
         for (int px = 0; px < previewTexWidth_; ++px) {
-            const int mapX = px * map_.width / previewTexWidth_;
+            const int mapX = px * map_->width / previewTexWidth_;
             SDL_FRect dst = {static_cast<float>(px), static_cast<float>(py), 1.0f, 1.0f};
             bool drewAny = false;
 
@@ -1160,7 +1175,7 @@ bool ChunkExporterTool::RenderTilemapPreview() {
                 if (!layer || !LayerAllowedForChunkType(chunkType_, layer->name)) {
                     continue;
                 }
-                drawGid(FindGidAt(*layer, map_.width, mapX, mapY));
+                drawGid(FindGidAt(*layer, map_->width, mapX, mapY));
             }
 
             for (std::vector<const tiled::TiledLayer*>::const_iterator it = overlayLayers.begin();
@@ -1169,16 +1184,16 @@ bool ChunkExporterTool::RenderTilemapPreview() {
                 if (!layer || !LayerAllowedForChunkType(chunkType_, layer->name)) {
                     continue;
                 }
-                drawGid(FindGidAt(*layer, map_.width, mapX, mapY));
+                drawGid(FindGidAt(*layer, map_->width, mapX, mapY));
             }
 
             if (!drewAny) {
-                for (std::vector<tiled::TiledLayer>::const_reverse_iterator layerIt = map_.layers.rbegin();
-                     layerIt != map_.layers.rend(); ++layerIt) {
+                for (std::vector<tiled::TiledLayer>::const_reverse_iterator layerIt = map_->layers.rbegin();
+                     layerIt != map_->layers.rend(); ++layerIt) {
                     if (!LayerAllowedForChunkType(chunkType_, layerIt->name)) {
                         continue;
                     }
-                    const uint32_t gid = FindGidAt(*layerIt, map_.width, mapX, mapY);
+                    const uint32_t gid = FindGidAt(*layerIt, map_->width, mapX, mapY);
                     if (gid != 0) {
                         drawGid(gid);
                         break;
@@ -1194,52 +1209,86 @@ bool ChunkExporterTool::RenderTilemapPreview() {
 }
 
 bool ChunkExporterTool::ExportChunks() {
-    if (!hasMap_) {
+    if (!hasMap_ || exportRunning_) {
         return false;
     }
 
-    const int tileSizePx = GetSelectedTileSize();
-    const int mapCenterX = map_.width / 2;
-    const int mapCenterY = map_.height / 2;
+    ExportJob job;
+    job.chunkWidthTiles = chunkWidthTiles_;
+    job.chunkHeightTiles = chunkHeightTiles_;
+    job.tileSizePx = GetSelectedTileSize();
+    job.nonEmptyOnly = exportNonEmptyOnly_;
+    const std::string prefix = BuildFilenamePrefix();
+    job.baseName = prefix.empty() ? chunkType_ : prefix;
+    job.outputDir = outputRoot_ / (std::string("gen_") + FormatTimestamp());
+    job.map = mapSnapshot_.Read();
+
+    exportProgress_ = 0.0f;
+    exportFinished_ = false;
+    exportRunning_ = true;
+    statusText_ = "Exporting...";
+    exportThread_ = std::thread([this, job = std::move(job)]() {
+        RunExport(job);
+        exportFinished_.store(true);
+    });
+    return true;
+}
+
+void ChunkExporterTool::PollExport() {
+    if (!exportRunning_ || !exportFinished_.load()) {
+        return;
+    }
+    exportThread_.join();
+    exportRunning_ = false;
+    statusText_ = exportStatus_;
+    if (exportOk_) {
+        lastOutputPath_ = exportOutputPath_;
+    }
+}
+
+// Runs on the export thread; touches only the job, the pinned map and the export result fields.
+void ChunkExporterTool::RunExport(const ExportJob& job) {
+    exportOk_ = false;
+    const tiled::TiledMap& map = *job.map;
+
+    const int tileSizePx = job.tileSizePx;
+    const int mapCenterX = map.width / 2;
+    const int mapCenterY = map.height / 2;
 
-    const std::string folderName = std::string("gen_") + FormatTimestamp();
-    const std::filesystem::path outputDir = outputRoot_ / folderName;
+    const std::filesystem::path outputDir = job.outputDir;
     const std::filesystem::path allDir = outputDir / "chunks";
     const std::filesystem::path nonEmptyDir = outputDir / "chunks_non_empty";
-    const std::filesystem::path outDir = exportNonEmptyOnly_ ? nonEmptyDir : allDir;
+    const std::filesystem::path outDir = job.nonEmptyOnly ? nonEmptyDir : allDir;
 
     std::error_code ec;
     std::filesystem::create_directories(outDir, ec);
 
     if (ec) {
-        statusText_ = "Failed to create output directories: " + ec.message();
-        return false;
+        exportStatus_ = "Failed to create output directories: " + ec.message();
+        return;
     }
 
-    const int chunksX = (map_.width + chunkWidthTiles_ - 1) / chunkWidthTiles_;
-    const int chunksY = (map_.height + chunkHeightTiles_ - 1) / chunkHeightTiles_;
+    const int chunksX = (map.width + job.chunkWidthTiles - 1) / job.chunkWidthTiles;
+    const int chunksY = (map.height + job.chunkHeightTiles - 1) / job.chunkHeightTiles;
     const int totalChunks = chunksX * chunksY;
 
     int nonEmptyCount = 0;
     int writtenCount = 0;
     int chunkIndex = 0;
 
-    exportProgress_ = 0.0f;
-
-    const std::string prefix = BuildFilenamePrefix();
-    for (int tileY = 0; tileY < map_.height; tileY += chunkHeightTiles_) {
-        for (int tileX = 0; tileX < map_.width; tileX += chunkWidthTiles_) {
+    for (int tileY = 0; tileY < map.height; tileY += job.chunkHeightTiles) {
+        for (int tileX = 0; tileX < map.width; tileX += job.chunkWidthTiles) {
             bool nonEmpty = false;
-            nlohmann::json chunk = BuildChunkJson(tileX, tileY, &nonEmpty);
+            nlohmann::json chunk = BuildChunkJson(
+                map, job.chunkWidthTiles, job.chunkHeightTiles, tileX, tileY, &nonEmpty);
 
             const int worldPxX = (tileX - mapCenterX) * tileSizePx;
             const int worldPxY = (tileY - mapCenterY) * tileSizePx;
-            const std::string baseName = prefix.empty() ? chunkType_ : prefix;
-            const std::string filename = baseName + "_chunk_" + std::to_string(tileX) + "_" +
+            const std::string filename = job.baseName + "_chunk_" + std::to_string(tileX) + "_" +
                 std::to_string(tileY) + "_" + std::to_string(worldPxX) + "_" +
                 std::to_string(worldPxY) + ".json";
 
-            if (exportNonEmptyOnly_ && !nonEmpty) {
+            if (job.nonEmptyOnly && !nonEmpty) {
                 ++chunkIndex;
                 exportProgress_ = totalChunks > 0
                     ? static_cast<float>(chunkIndex) / static_cast<float>(totalChunks)
@@ -1249,8 +1298,8 @@ bool ChunkExporterTool::ExportChunks() {
 
             std::string writeError;
             if (!WriteJson(outDir / filename, chunk, &writeError)) {
-                statusText_ = "Write failed: " + writeError;
-                return false;
+                exportStatus_ = "Write failed: " + writeError;
+                return;
             }
 
             if (nonEmpty) {
@@ -1265,46 +1314,47 @@ bool ChunkExporterTool::ExportChunks() {
     }
 
     std::ostringstream status;
-    if (exportNonEmptyOnly_) {
+    if (job.nonEmptyOnly) {
         status << "Export complete. Wrote " << writtenCount
                << " non-empty chunks to " << nonEmptyDir.string();
     } else {
         status << "Export complete. Wrote " << writtenCount
                << " chunks to " << allDir.string() << " (non-empty: " << nonEmptyCount << ")";
     }
-    statusText_ = status.str();
-    lastOutputPath_ = outDir.string();
-    return true;
+    exportStatus_ = status.str();
+    exportOutputPath_ = outDir.string();
+    exportOk_ = true;
 }
 
-nlohmann::json ChunkExporterTool::BuildChunkJson(int tileX, int tileY, bool* nonEmpty) const {
-    nlohmann::json chunk = map_.source;
-    chunk["width"] = chunkWidthTiles_;
-    chunk["height"] = chunkHeightTiles_;
-    chunk["tilewidth"] = map_.tileWidth;
-    chunk["tileheight"] = map_.tileHeight;
+nlohmann::json ChunkExporterTool::BuildChunkJson(const tiled::TiledMap& map, int chunkWidthTiles,
+    int chunkHeightTiles, int tileX, int tileY, bool* nonEmpty) {
+    nlohmann::json chunk = map.source;
+    chunk["width"] = chunkWidthTiles;
+    chunk["height"] = chunkHeightTiles;
+    chunk["tilewidth"] = map.tileWidth;
+    chunk["tileheight"] = map.tileHeight;
     chunk["offsetX"] = tileX;
     chunk["offsetY"] = tileY;
-    chunk["tilesets"] = map_.tilesets;
+    chunk["tilesets"] = map.tilesets;
 
     bool anyNonZero = false;
     nlohmann::json layers = nlohmann::json::array();
 
-    for (const tiled::TiledLayer& layer : map_.layers) {
+    for (const tiled::TiledLayer& layer : map.layers) {
         if (!layer.isTileLayer) {
             continue;
         }
         nlohmann::json outLayer = layer.source;
         std::vector<uint32_t> chunkData;
-        chunkData.reserve(static_cast<size_t>(chunkWidthTiles_ * chunkHeightTiles_));
+        chunkData.reserve(static_cast<size_t>(chunkWidthTiles * chunkHeightTiles));
 
-        for (int y = 0; y < chunkHeightTiles_; ++y) {
+        for (int y = 0; y < chunkHeightTiles; ++y) {
             const int mapY = tileY + y;
-            for (int x = 0; x < chunkWidthTiles_; ++x) {
+            for (int x = 0; x < chunkWidthTiles; ++x) {
                 const int mapX = tileX + x;
                 uint32_t gid = 0;
-                if (mapX >= 0 && mapX < map_.width && mapY >= 0 && mapY < map_.height) {
-                    const size_t index = static_cast<size_t>(mapY * map_.width + mapX);
+                if (mapX >= 0 && mapX < map.width && mapY >= 0 && mapY < map.height) {
+                    const size_t index = static_cast<size_t>(mapY * map.width + mapX);
                     if (index < layer.gids.size()) {
                         gid = StripTiledFlags(layer.gids[index]);
                     }
@@ -1316,8 +1366,8 @@ nlohmann::json ChunkExporterTool::BuildChunkJson(int tileX, int tileY, bool* non
             }
         }
 
-        outLayer["width"] = chunkWidthTiles_;
-        outLayer["height"] = chunkHeightTiles_;
+        outLayer["width"] = chunkWidthTiles;
+        outLayer["height"] = chunkHeightTiles;
         outLayer["data"] = chunkData;
         outLayer.erase("encoding");
         outLayer.erase("compression");
@@ -1334,7 +1384,7 @@ nlohmann::json ChunkExporterTool::BuildChunkJson(int tileX, int tileY, bool* non
 }
 
 bool ChunkExporterTool::WriteJson(
-    const std::filesystem::path& path, const nlohmann::json& doc, std::string* error) const {
+    const std::filesystem::path& path, const nlohmann::json& doc, std::string* error) {
     std::ofstream file(path);
     if (!file.is_open()) {
         if (error) {
@@ -1,11 +1,14 @@
 #pragma once
 
+#include "cgul/core/snapshot.h"
 #include "chunkexporter/tiled/TiledMap.hpp"
 
 #include <array>
+#include <atomic>
 #include <cstdint>
 #include <filesystem>
 #include <string>
+#include <thread>
 #include <vector>
 
 struct SDL_Renderer;
@@ -48,6 +51,7 @@ public:
     int GetSelectedTileSize() const;
     int GetSelectedTileSizePx() const;
     bool GetExportNonEmptyOnly() const;
+    bool IsExporting() const;
 
     void SetInputPath(const std::string& path);
     bool LoadMapFromInputPath();
@@ -71,7 +75,6 @@ private:
     bool browseOpen_ = false;
     std::array<char, kNameBufferSize> filenamePrefix_{};
 
-    tiled::TiledMap map_;
     bool hasMap_ = false;
     std::string loadError_;
     std::string statusText_;
@@ -82,7 +85,33 @@ private:
     int chunkHeightTiles_ = 25;
     int tileSizeIndex_ = 1;  // 0=16, 1=32, 2=128
     bool exportNonEmptyOnly_ = true;
-    float exportProgress_ = 0.0f;
+    std::atomic<float> exportProgress_{0.0f};
+
+    // Export settings captured on the UI thread when an export starts.
+    struct ExportJob {
+        int chunkWidthTiles = 0;
+        int chunkHeightTiles = 0;
+        int tileSizePx = 0;
+        bool nonEmptyOnly = true;
+        std::string baseName;
+        std::filesystem::path outputDir;
+        // Pinned together with the settings, so the export writes the map they were taken from.
+        cgul::Snapshot<tiled::TiledMap>::ReadGuard map;
+    };
+
+    // Sole owner of the loaded map. Exports hold a pinned version, so loading or clearing a
+    // map never waits for an export and the export never sees a half-replaced map.
+    cgul::Snapshot<tiled::TiledMap> mapSnapshot_;
+    // The UI thread's pin of the current version; re-taken after every publish. Declared after
+    // the snapshot so it is released first.
+    cgul::Snapshot<tiled::TiledMap>::ReadGuard map_ = mapSnapshot_.Read();
+    std::thread exportThread_;
+    bool exportRunning_ = false;
+    std::atomic<bool> exportFinished_{false};
+    // Written by the export thread before it sets exportFinished_.
+    bool exportOk_ = false;
+    std::string exportStatus_;
+    std::string exportOutputPath_;
 
     std::string chunkType_ = "island";
     std::filesystem::path outputRoot_;
@@ -112,11 +141,14 @@ private:
     mutable std::string inputPathViewCache_;
 
     void LoadMapFromPath();
+    void PublishMap(tiled::TiledMap map);
     void ResetLoadedMap();
     void RefreshBrowseFiles();
     void DrawTilemapRender();
     void DrawTileInspector();
     bool ExportChunks();
+    void RunExport(const ExportJob& job);
+    void PollExport();
     void ClearTilesets();
     bool LoadTilesets();
     const TilesetTexture* FindTilesetForGid(uint32_t gid) const;
@@ -124,9 +156,10 @@ private:
     bool RenderTilemapPreview();
     std::string BuildFilenamePrefix() const;
 
-    nlohmann::json BuildChunkJson(int tileX, int tileY, bool* nonEmpty) const;
-    bool WriteJson(const std::filesystem::path& path, const nlohmann::json& doc,
-        std::string* error) const;
+    static nlohmann::json BuildChunkJson(const tiled::TiledMap& map, int chunkWidthTiles,
+        int chunkHeightTiles, int tileX, int tileY, bool* nonEmpty);
+    static bool WriteJson(const std::filesystem::path& path, const nlohmann::json& doc,
+        std::string* error);
 
     static std::string InferChunkType(const std::filesystem::path& path);
     static std::string ToLowerCopy(const std::string& value);
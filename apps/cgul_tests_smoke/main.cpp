@@ -1,15 +1,44 @@
+#include "cgul/core/cell_occupancy.h"
+#include "cgul/core/content_hash.h"
+#include "cgul/core/document_diff.h"
+#include "cgul/core/document_history.h"
+#include "cgul/core/document_index.h"
 #include "cgul/core/equality.h"
+#include "cgul/core/interned_document.h"
+#include "cgul/core/persistent_document.h"
+#include "cgul/core/placement.h"
+#include "cgul/core/snapshot.h"
+#include "cgul/core/widget_spatial_index.h"
+#include "cgul/io/cgul_binary.h"
+#include "cgul/io/cgul_directory.h"
 #include "cgul/io/cgul_document.h"
+#include "cgul/io/cgul_journal.h"
+#include "cgul/io/json_dom.h"
+#include "cgul/render/compose_batch.h"
+#include "cgul/render/layout_composer.h"
+#include "cgul/render/widget_painter.h"
 #include "cgul/validate/validate.h"
 
 #include <algorithm>
+#include <atomic>
+#include <csignal>
 #include <chrono>
 #include <cstdint>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <map>
+#include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 
+#if !defined(_WIN32)
+#include <sys/resource.h>
+#include <sys/stat.h>
+#endif
+
 namespace {
 
 namespace fs = std::filesystem;
@@ -18,46 +47,52 @@ void PrintFailure(const std::string& message) {
   std::cerr << message << '\n';
 }
 
-bool HasCgulExtension(const fs::path& path) {
-  return path.extension() == ".cgul";
-}
+// Seeded LCG for the randomized checks, so every run (and every failure) is reproducible.
+class TestRng {
+ public:
+  explicit TestRng(uint32_t seed) : state_(seed) {}
+
+  // 24 random bits.
+  uint32_t Next() {
+    state_ = state_ * 1664525u + 1013904223u;
+    return state_ >> 8;
+  }
+  // A value in [0, bound); bound must be positive.
+  uint32_t Next(size_t bound) { return static_cast<uint32_t>(Next() % bound); }
+
+ private:
+  uint32_t state_;
+};
 
 int RunSmoke() {
   const fs::path examplesDir = fs::path("schemas") / "examples";
 
-  std::error_code ec;
-  if (!fs::exists(examplesDir, ec) || ec) {
-    PrintFailure("FAIL discover " + examplesDir.string() + ": directory does not exist");
+  cgul::CgulDirectoryOptions loadOptions;
+  loadOptions.includeBinary = false;
+  std::vector<cgul::CgulDirectoryEntry> examples;
+  cgul::CgulDirectoryReport loadReport;
+  std::string error;
+  if (!cgul::LoadCgulDirectory(examplesDir.string(), loadOptions, &examples, &loadReport,
+                               &error)) {
+    PrintFailure("FAIL discover " + examplesDir.string() + ": " + error);
     return 1;
   }
-  if (!fs::is_directory(examplesDir, ec) || ec) {
-    PrintFailure("FAIL discover " + examplesDir.string() + ": not a directory");
+  if (examples.empty()) {
+    PrintFailure("FAIL discover " + examplesDir.string() + ": no .cgul files found");
     return 1;
   }
-
-  std::vector<fs::path> exampleFiles;
-  for (fs::directory_iterator it(examplesDir, ec); !ec && it != fs::directory_iterator(); ++it) {
-    if (!it->is_regular_file()) {
-      continue;
+  for (const cgul::CgulDirectoryEntry& entry : examples) {
+    if (entry.status == cgul::CgulFileStatus::LoadFailed) {
+      PrintFailure("FAIL load " + entry.path + ": " + entry.error);
+      return 1;
     }
-    const fs::path candidate = it->path();
-    if (HasCgulExtension(candidate)) {
-      exampleFiles.push_back(candidate);
+    if (entry.status == cgul::CgulFileStatus::ValidationFailed) {
+      PrintFailure("FAIL validate " + entry.path + ": " + entry.error);
+      return 1;
     }
   }
-  if (ec) {
-    PrintFailure("FAIL discover " + examplesDir.string() + ": " + ec.message());
-    return 1;
-  }
-
-  std::sort(exampleFiles.begin(), exampleFiles.end(),
-            [](const fs::path& a, const fs::path& b) { return a.filename().string() < b.filename().string(); });
-
-  if (exampleFiles.empty()) {
-    PrintFailure("FAIL discover " + examplesDir.string() + ": no .cgul files found");
-    return 1;
-  }
 
+  std::error_code ec;
   fs::path tempDir = fs::temp_directory_path(ec);
   if (ec) {
     PrintFailure("FAIL tempdir: " + ec.message());
@@ -66,17 +101,37 @@ int RunSmoke() {
 
   const auto nowTicks = std::chrono::steady_clock::now().time_since_epoch().count();
 
-  for (size_t i = 0; i < exampleFiles.size(); ++i) {
-    const fs::path& sourcePath = exampleFiles[i];
+  for (size_t i = 0; i < examples.size(); ++i) {
+    const fs::path sourcePath = examples[i].path;
+    const cgul::CgulDocument& doc = examples[i].doc;
 
-    cgul::CgulDocument doc;
-    std::string error;
-    if (!cgul::LoadCgulFile(sourcePath.string(), &doc, &error)) {
-      PrintFailure("FAIL load " + sourcePath.string() + ": " + error);
+    std::string text;
+    if (!cgul::SaveCgulToBuffer(doc, &text, &error)) {
+      PrintFailure("FAIL save(buffer) " + sourcePath.string() + ": " + error);
+      return 1;
+    }
+    cgul::CgulDocument fromBuffer;
+    if (!cgul::LoadCgulFromBuffer(text, &fromBuffer, &error)) {
+      PrintFailure("FAIL load(buffer) " + sourcePath.string() + ": " + error);
+      return 1;
+    }
+    std::string bufferDiff;
+    if (!cgul::Equal(doc, fromBuffer, &bufferDiff)) {
+      PrintFailure("FAIL equal(buffer) " + sourcePath.string() + ": " + bufferDiff);
+      return 1;
+    }
+
+    std::string binary;
+    cgul::CgulDocument fromBinary;
+    if (!cgul::SaveCgulBinaryToBuffer(doc, &binary, &error) ||
+        !cgul::LoadCgulBinaryFromBuffer(binary, &fromBinary, &error) ||
+        !cgul::Equal(doc, fromBinary, &bufferDiff)) {
+      PrintFailure("FAIL binary round-trip " + sourcePath.string() + ": " + error + bufferDiff);
       return 1;
     }
-    if (!cgul::Validate(doc, &error)) {
-      PrintFailure("FAIL validate " + sourcePath.string() + ": " + error);
+    if (cgul::LoadCgulBinaryFromBuffer(std::string_view(binary).substr(0, binary.size() - 1),
+                                       &fromBinary, &error)) {
+      PrintFailure("FAIL binary accepted truncated data " + sourcePath.string());
       return 1;
     }
 
@@ -89,6 +144,13 @@ int RunSmoke() {
       PrintFailure("FAIL save " + tempPath.string() + ": " + error);
       return 1;
     }
+    cgul::CgulSaveOptions syncOptions;
+    syncOptions.fsync = true;
+    if (!cgul::SaveCgulFile(tempPath.string(), doc, syncOptions, &error) ||
+        fs::file_size(tempPath, ec) != text.size()) {
+      PrintFailure("FAIL replace " + tempPath.string() + ": " + error);
+      return 1;
+    }
 
     cgul::CgulDocument reloaded;
     if (!cgul::LoadCgulFile(tempPath.string(), &reloaded, &error)) {
@@ -110,12 +172,1781 @@ int RunSmoke() {
     ec.clear();
   }
 
-  std::cout << "PASS cgul_smoke: " << exampleFiles.size() << " files ok\n";
+  std::cout << "PASS cgul_smoke: " << examples.size()
+            << " files ok (load threads=" << loadReport.threadCount << ")\n";
+  return 0;
+}
+
+void PaintGauge(cgul::Frame& frame, const cgul::Widget& widget, void* userData) {
+  const char32_t glyph = *static_cast<const char32_t*>(userData);
+  for (int y = widget.boundsCells.y; y < widget.boundsCells.y + widget.boundsCells.h; ++y) {
+    for (int x = widget.boundsCells.x; x < widget.boundsCells.x + widget.boundsCells.w; ++x) {
+      if (x >= 0 && y >= 0 && x < frame.width && y < frame.height) {
+        frame.at(x, y).glyph = glyph;
+        frame.at(x, y).widgetId = widget.id;
+      }
+    }
+  }
+}
+
+int RunPainterRegistryCheck() {
+  static const char32_t kGaugeGlyph = U'%';
+
+  cgul::WidgetKind gaugeKind = cgul::WidgetKind::Panel;
+  std::string error;
+  if (!cgul::RegisterWidgetKind("gauge", &gaugeKind, &error)) {
+    PrintFailure("FAIL register kind: " + error);
+    return 1;
+  }
+  cgul::WidgetPainter painter;
+  painter.paint = &PaintGauge;
+  painter.userData = const_cast<char32_t*>(&kGaugeGlyph);
+  painter.opaque = true;
+  if (!cgul::RegisterWidgetPainter(gaugeKind, painter, &error)) {
+    PrintFailure("FAIL register painter: " + error);
+    return 1;
+  }
+
+  // Kind names are saved unescaped, so names that would break the JSON are refused.
+  for (const char* badName : {"ga\"uge", "ga\\uge", "ga\nuge"}) {
+    cgul::WidgetKind rejected = cgul::WidgetKind::Panel;
+    if (cgul::RegisterWidgetKind(badName, &rejected, &error)) {
+      PrintFailure(std::string("FAIL register kind accepted: ") + badName);
+      return 1;
+    }
+  }
+
+  cgul::WidgetKind parsed = cgul::WidgetKind::Panel;
+  if (!cgul::ParseWidgetKind("gauge", &parsed) || parsed != gaugeKind ||
+      std::string(cgul::ToString(gaugeKind)) != "gauge") {
+    PrintFailure("FAIL custom kind name round-trip");
+    return 1;
+  }
+
+  cgul::CgulDocument doc;
+  doc.gridWCells = 20;
+  doc.gridHCells = 6;
+  doc.widgets.push_back(cgul::Widget{1, cgul::WidgetKind::Panel, cgul::RectI{2, 1, 4, 3}, "P"});
+  doc.widgets.push_back(cgul::Widget{2, gaugeKind, cgul::RectI{1, 0, 8, 5}, ""});
+  doc.widgets.push_back(cgul::Widget{3, cgul::WidgetKind::Window, cgul::RectI{10, 0, 10, 6}, "W"});
+
+  const cgul::Frame frame = cgul::ComposeLayoutToFrame(doc);
+  if (frame.at(3, 2).glyph != kGaugeGlyph || frame.at(3, 2).widgetId != 2 ||
+      frame.at(10, 0).widgetId != 3 || frame.at(0, 0).widgetId != 0) {
+    PrintFailure("FAIL compose with custom painter");
+    return 1;
+  }
+
+  std::cout << "PASS painter registry\n";
+  return 0;
+}
+
+int RunComposeBatchCheck() {
+  std::vector<cgul::CgulDocument> docs;
+  for (int i = 0; i < 16; ++i) {
+    cgul::CgulDocument doc;
+    doc.gridWCells = 10 + i * 3;
+    doc.gridHCells = 4 + (i % 5);
+    doc.widgets.push_back(
+        cgul::Widget{1, cgul::WidgetKind::Window, cgul::RectI{0, 0, doc.gridWCells, 4}, ""});
+    docs.push_back(std::move(doc));
+  }
+
+  std::vector<std::string> composed(docs.size());
+  cgul::ComposeBatchOptions options;
+  options.threadCount = 4;
+  cgul::ComposeBatchReport report;
+  cgul::ComposeBatch(
+      docs, [&composed](size_t index, const cgul::Frame& frame) {
+        composed[index] = cgul::to_json_v0(frame);
+      },
+      options, &report);
+
+  if (report.documents.size() != docs.size()) {
+    PrintFailure("FAIL compose batch: missing timings");
+    return 1;
+  }
+  for (size_t i = 0; i < docs.size(); ++i) {
+    if (composed[i] != cgul::to_json_v0(cgul::ComposeLayoutToFrame(docs[i]))) {
+      PrintFailure("FAIL compose batch: frame mismatch for document " + std::to_string(i));
+      return 1;
+    }
+  }
+
+  // A throwing callback must surface on the caller instead of terminating a worker thread.
+  std::atomic<size_t> calls{0};
+  bool caught = false;
+  try {
+    cgul::ComposeBatch(
+        docs, [&calls](size_t index, const cgul::Frame&) {
+          ++calls;
+          if (index == 5) {
+            throw std::runtime_error("callback failed");
+          }
+        },
+        options, nullptr);
+  } catch (const std::runtime_error& e) {
+    caught = std::string(e.what()) == "callback failed";
+  }
+  if (!caught || calls.load() > docs.size()) {
+    PrintFailure("FAIL compose batch: callback exception not rethrown");
+    return 1;
+  }
+
+  std::cout << "PASS compose batch\n";
+  return 0;
+}
+
+int RunJsonDomCheck() {
+  const std::string text =
+      R"({"a": [1, -2, true, null], "s": "x\ty", "o": {"k": "v"}, "e": {}})";
+  cgul::JsonDocument dom;
+  std::string error;
+  if (!dom.Parse(text, &error)) {
+    PrintFailure("FAIL json dom: " + error);
+    return 1;
+  }
+
+  const size_t a = dom.Find(0, "a");
+  const size_t s = dom.Find(0, "s");
+  const size_t o = dom.Find(0, "o");
+  if (dom.root().childCount != 4 || a == cgul::JsonDocument::kNoNode ||
+      dom.node(a).childCount != 4 || dom.node(a + 2).intValue != -2 ||
+      dom.node(dom.node(a + 2).end).type != cgul::JsonNodeType::Bool ||
+      dom.node(s).text != "x\ty" || dom.node(dom.Find(o, "k")).text != "v" ||
+      dom.Find(0, "missing") != cgul::JsonDocument::kNoNode) {
+    PrintFailure("FAIL json dom: unexpected tree");
+    return 1;
+  }
+
+  if (!dom.Parse(R"({"f": [1.5, -2e3, 7]})", &error)) {
+    PrintFailure("FAIL json dom: " + error);
+    return 1;
+  }
+  const size_t f = dom.Find(0, "f");
+  if (dom.node(f + 1).type != cgul::JsonNodeType::Float || dom.node(f + 1).floatValue != 1.5 ||
+      dom.node(f + 2).type != cgul::JsonNodeType::Float || dom.node(f + 2).floatValue != -2000.0 ||
+      dom.node(f + 3).type != cgul::JsonNodeType::Integer || dom.node(f + 3).intValue != 7) {
+    PrintFailure("FAIL json dom: unexpected numbers");
+    return 1;
+  }
+
+  if (dom.Parse(R"({"k": 1, "k": 2})", &error) || error.find("duplicate") == std::string::npos) {
+    PrintFailure("FAIL json dom: duplicate key accepted");
+    return 1;
+  }
+
+  std::cout << "PASS json dom\n";
+  return 0;
+}
+
+int RunLoadErrorOrderCheck() {
+  // Several schema errors at once: the reported one follows the fixed check order (root keys,
+  // then widgets by index and their keys), not the order keys appear in the text.
+  const std::pair<const char*, const char*> cases[] = {
+      {R"({"widgets": [{"title": 1}], "seed": -1, "grid": {"h": "x"}, "cgulVersion": "0.1"})",
+       "Missing required key: w"},
+      {R"({"widgets": [{"title": 1}], "seed": -1, "grid": {"h": 2, "w": 3}, "cgulVersion": "0.1"})",
+       "seed must be a non-negative integer"},
+      {R"({"widgets": [{"kind": "x", "bounds": {"h": "1", "x": "2"}, "id": 1}, {}],
+           "meta": {"z": [], "a": {}}, "seed": 0, "grid": {"w": 3, "h": 2}, "cgulVersion": "0.1"})",
+       "Expected 'meta.a' to be a string, number or boolean"},
+      {R"({"widgets": [{"title": 1, "bounds": {"h": "1", "x": "2"}, "kind": "x"}, {}],
+           "seed": 0, "grid": {"w": 3, "h": 2}, "cgulVersion": "0.1"})",
+       "Missing required key: id"},
+      {R"({"widgets": [{"title": 1, "bounds": {"h": "1", "x": "2"}, "kind": "x", "id": 1}],
+           "seed": 0, "grid": {"w": 3, "h": 2}, "cgulVersion": "0.1"})",
+       "Unknown widget kind: x"},
+      {R"({"widgets": [{"title": 1, "bounds": {"h": "1", "x": "2"}, "kind": "panel", "id": 1}],
+           "seed": 0, "grid": {"w": 3, "h": 2}, "cgulVersion": "0.1"})",
+       "Expected 'x' to be an integer"},
+  };
+  cgul::CgulDocument doc;
+  std::string error;
+  for (const auto& entry : cases) {
+    if (cgul::LoadCgulFromBuffer(entry.first, &doc, &error) || error != entry.second) {
+      PrintFailure(std::string("FAIL load error order: expected \"") + entry.second +
+                   "\", got \"" + error + "\"");
+      return 1;
+    }
+  }
+
+  // Unknown keys are skipped without building a tree, but still within the DOM's depth cap.
+  const std::string valid = R"("cgulVersion": "0.1", "grid": {"w": 1, "h": 1}, "seed": 0,
+                               "widgets": [])";
+  const auto nested = [&valid](int depth) {
+    return "{" + valid + ", \"extra\": " + std::string(static_cast<size_t>(depth), '[') +
+           std::string(static_cast<size_t>(depth), ']') + "}";
+  };
+  if (!cgul::LoadCgulFromBuffer(nested(400), &doc, &error)) {
+    PrintFailure("FAIL load nesting: " + error);
+    return 1;
+  }
+  if (cgul::LoadCgulFromBuffer(nested(100000), &doc, &error) ||
+      error.find("nesting too deep") == std::string::npos) {
+    PrintFailure("FAIL load nesting: deep unknown value accepted: " + error);
+    return 1;
+  }
+
+  // Duplicate keys are still caught once an object has too many keys to compare linearly.
+  for (const char* object : {"meta", "extra"}) {
+    std::string text = R"({"cgulVersion": "0.1", "grid": {"w": 1, "h": 1}, "seed": 0,
+                           "widgets": [], ")" + std::string(object) + "\": {";
+    for (int i = 0; i < 100; ++i) {
+      text += "\"k" + std::to_string(i) + "\": \"v\", ";
+    }
+    text += "\"k42\": \"again\"}}";
+    if (cgul::LoadCgulFromBuffer(text, &doc, &error) ||
+        error.find("duplicate object key: k42") == std::string::npos) {
+      PrintFailure(std::string("FAIL load duplicate key in large ") + object + ": " + error);
+      return 1;
+    }
+  }
+
+  std::cout << "PASS load error order\n";
+  return 0;
+}
+
+int RunJournalCheck() {
+  std::error_code ec;
+  const fs::path basePath =
+      fs::temp_directory_path(ec) /
+      ("cgul_journal_" +
+       std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + ".cgul");
+  const std::string journalPath = cgul::CgulJournal::JournalPathFor(basePath.string());
+  auto cleanup = [&]() {
+    fs::remove(basePath, ec);
+    fs::remove(journalPath, ec);
+  };
+
+  cgul::CgulDocument doc;
+  doc.gridWCells = 40;
+  doc.gridHCells = 20;
+  doc.widgets.push_back(cgul::Widget{1, cgul::WidgetKind::Window, cgul::RectI{0, 0, 10, 5}, "A"});
+  doc.widgets.push_back(cgul::Widget{2, cgul::WidgetKind::Panel, cgul::RectI{12, 0, 6, 4}, ""});
+
+  std::string error;
+  cgul::CgulJournal journal;
+  if (!journal.Create(basePath.string(), doc, &error)) {
+    PrintFailure("FAIL journal create: " + error);
+    cleanup();
+    return 1;
+  }
+  const uintmax_t baseSize = fs::file_size(basePath, ec);
+
+  const std::vector<cgul::JournalRecord> edits = {
+      cgul::MakeMoveWidgetRecord(1, 3, 4),
+      cgul::MakeResizeWidgetRecord(2, 8, 3),
+      cgul::MakeAddWidgetRecord(
+          cgul::Widget{3, cgul::WidgetKind::Button, cgul::RectI{20, 10, 6, 3}, "Go"}, 1),
+      cgul::MakeRemoveWidgetRecord(2),
+      cgul::MakeSetMetaRecord("note", "edited"),
+  };
+  for (const cgul::JournalRecord& edit : edits) {
+    if (!cgul::ApplyJournalRecord(&doc, edit, &error) || !journal.Append(edit, &error)) {
+      PrintFailure("FAIL journal append: " + error);
+      cleanup();
+      return 1;
+    }
+  }
+  journal.Close();
+  if (fs::file_size(basePath, ec) != baseSize) {
+    PrintFailure("FAIL journal append rewrote the base file");
+    cleanup();
+    return 1;
+  }
+
+  // A torn trailing record (interrupted append) must be dropped, not fail the load.
+  {
+    std::ofstream torn(journalPath, std::ios::binary | std::ios::app);
+    torn.write("\x40\0\0\0\1\2", 6);
+  }
+
+  cgul::CgulDocument replayed;
+  std::string diff;
+  if (!journal.Open(basePath.string(), &replayed, &error) ||
+      !cgul::Equal(doc, replayed, &diff)) {
+    PrintFailure("FAIL journal replay: " + error + diff);
+    cleanup();
+    return 1;
+  }
+
+  // A damaged record in the middle is corruption: the open must fail and leave the journal
+  // alone rather than truncate the valid records after it.
+  {
+    std::string bytes;
+    {
+      std::ifstream in(journalPath, std::ios::binary);
+      bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    std::string corrupted = bytes;
+    corrupted[16 + 8] = static_cast<char>(corrupted[16 + 8] ^ 0x5a);
+    {
+      std::ofstream out(journalPath, std::ios::binary | std::ios::trunc);
+      out.write(corrupted.data(), static_cast<std::streamsize>(corrupted.size()));
+    }
+    const bool opened = journal.Open(basePath.string(), &replayed, &error);
+    if (opened || error.find("checksum mismatch in record 0") == std::string::npos ||
+        fs::file_size(journalPath, ec) != bytes.size()) {
+      PrintFailure("FAIL journal mid-file corruption: " + error);
+      cleanup();
+      return 1;
+    }
+    {
+      std::ofstream out(journalPath, std::ios::binary | std::ios::trunc);
+      out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    }
+    if (!journal.Open(basePath.string(), &replayed, &error)) {
+      PrintFailure("FAIL journal reopen: " + error);
+      cleanup();
+      return 1;
+    }
+  }
+
+  if (!journal.Compact(doc, &error) || !journal.Open(basePath.string(), &replayed, &error) ||
+      !cgul::Equal(doc, replayed, &diff) || journal.journalBytes() != 16) {
+    PrintFailure("FAIL journal compact: " + error + diff);
+    cleanup();
+    return 1;
+  }
+
+#if !defined(_WIN32)
+  // A write that fails partway (here: past the file size limit) must not leave a torn record
+  // for later appends to land behind.
+  {
+    const auto oldHandler = std::signal(SIGXFSZ, SIG_IGN);
+    rlimit limit{};
+    getrlimit(RLIMIT_FSIZE, &limit);
+    const rlim_t oldLimit = limit.rlim_cur;
+    limit.rlim_cur = static_cast<rlim_t>(journal.journalBytes() + 8);
+    setrlimit(RLIMIT_FSIZE, &limit);
+    const bool appended =
+        journal.Append(cgul::MakeSetVersionRecord(std::string(64, 'v')), &error);
+    limit.rlim_cur = oldLimit;
+    setrlimit(RLIMIT_FSIZE, &limit);
+    std::signal(SIGXFSZ, oldHandler);
+    std::error_code ec;
+    if (appended || !journal.isOpen() || journal.journalBytes() != 16 ||
+        fs::file_size(journalPath, ec) != 16) {
+      PrintFailure("FAIL journal failed append left a partial record");
+      cleanup();
+      return 1;
+    }
+    const cgul::JournalRecord seed = cgul::MakeSetSeedRecord(doc.seed + 1);
+    if (!journal.Append(seed, &error) || !cgul::ApplyJournalRecord(&doc, seed, &error) ||
+        !journal.Open(basePath.string(), &replayed, &error) ||
+        !cgul::Equal(doc, replayed, &diff)) {
+      PrintFailure("FAIL journal append after failed append: " + error + diff);
+      cleanup();
+      return 1;
+    }
+  }
+#endif
+
+  // Compaction interrupted after the new base landed: the old journal must not be replayed
+  // on top of a base that already contains its edits.
+  const cgul::JournalRecord add = cgul::MakeAddWidgetRecord(
+      cgul::Widget{4, cgul::WidgetKind::Label, cgul::RectI{0, 12, 6, 3}, "L"}, 99);
+  if (!journal.Append(add, &error) || !cgul::ApplyJournalRecord(&doc, add, &error) ||
+      !cgul::SaveCgulFile(basePath.string(), doc, &error) ||
+      !journal.Open(basePath.string(), &replayed, &error)) {
+    PrintFailure("FAIL journal stale check: " + error);
+    cleanup();
+    return 1;
+  }
+  journal.Close();
+  if (!cgul::Equal(doc, replayed, &diff)) {
+    PrintFailure("FAIL journal stale check: " + diff);
+    cleanup();
+    return 1;
+  }
+
+  cleanup();
+  std::cout << "PASS journal\n";
+  return 0;
+}
+
+int RunDocumentIndexCheck() {
+  cgul::CgulDocument doc;
+  doc.gridWCells = 100;
+  doc.gridHCells = 100;
+  cgul::DocumentIndex index(&doc);
+
+  // Drive a mix of edits and check every id against a linear scan after each one.
+  TestRng rng(12345);
+  std::string error;
+  for (int step = 0; step < 2000; ++step) {
+    const uint32_t id = rng.Next() % 300 + 1;
+    const bool present = index.Contains(id);
+    switch (rng.Next() % 4) {
+      case 0:
+      case 1: {
+        const cgul::Widget widget{id, cgul::WidgetKind::Panel, cgul::RectI{0, 0, 1, 1}, ""};
+        if (index.Insert(rng.Next() % (doc.widgets.size() + 2), widget, &error) == present) {
+          PrintFailure("FAIL document index insert of id " + std::to_string(id));
+          return 1;
+        }
+        break;
+      }
+      case 2:
+        if (index.Remove(id) != present) {
+          PrintFailure("FAIL document index remove of id " + std::to_string(id));
+          return 1;
+        }
+        break;
+      default:
+        if (index.MoveTo(id, rng.Next() % (doc.widgets.size() + 1)) != present) {
+          PrintFailure("FAIL document index move of id " + std::to_string(id));
+          return 1;
+        }
+        break;
+    }
+
+    for (size_t i = 0; i < doc.widgets.size(); ++i) {
+      if (index.IndexOf(doc.widgets[i].id) != i) {
+        PrintFailure("FAIL document index position of id " + std::to_string(doc.widgets[i].id));
+        return 1;
+      }
+    }
+  }
+
+  doc.widgets.push_back(doc.widgets.front());
+  if (index.Rebuild(&error) || error.find("duplicate widget id") == std::string::npos ||
+      index.Add(cgul::Widget{0, cgul::WidgetKind::Panel, cgul::RectI{0, 0, 1, 1}, ""}, &error)) {
+    PrintFailure("FAIL document index: duplicate or zero id accepted");
+    return 1;
+  }
+
+  std::cout << "PASS document index (" << doc.widgets.size() << " widgets)\n";
   return 0;
 }
 
+int RunStringPoolCheck() {
+  cgul::CgulDocument doc;
+  doc.gridWCells = 80;
+  doc.gridHCells = 40;
+  doc.meta["cgul_imgui_demo.cameraTileX"] = "12";
+  doc.meta["cgul_imgui_demo.cameraTileY"] = "-3";
+  for (uint32_t i = 0; i < 32; ++i) {
+    doc.widgets.push_back(cgul::Widget{i + 1, cgul::WidgetKind::Window,
+                                       cgul::RectI{static_cast<int>(i) * 2, 0, 2, 2},
+                                       i % 2 == 0 ? "Inventory" : "Map"});
+  }
+
+  // Many copies of one layout should add no strings after the first.
+  cgul::StringPool pool;
+  std::vector<cgul::InternedDocument> interned(100);
+  for (cgul::InternedDocument& copy : interned) {
+    cgul::InternDocument(doc, &pool, &copy);
+  }
+  if (pool.size() != 6 || interned[0].widgets[0].title != interned[99].widgets[2].title) {
+    PrintFailure("FAIL string pool: expected 6 shared strings, got " + std::to_string(pool.size()));
+    return 1;
+  }
+
+  cgul::CgulDocument expanded;
+  cgul::ExpandDocument(interned[42], pool, &expanded);
+  std::string diff;
+  if (!cgul::Equal(doc, expanded, &diff) || !cgul::Equal(interned[0], interned[1])) {
+    PrintFailure("FAIL string pool round-trip: " + diff);
+    return 1;
+  }
+
+  std::swap(interned[1].widgets[0], interned[1].widgets[5]);
+  const bool reorderedEqual = cgul::Equal(interned[0], interned[1]);
+  interned[2].widgets[3].title = pool.Intern("Inventory");
+  if (!reorderedEqual || cgul::Equal(interned[0], interned[2])) {
+    PrintFailure("FAIL string pool equality by handle");
+    return 1;
+  }
+
+  std::cout << "PASS string pool\n";
+  return 0;
+}
+
+int RunPatchCheck() {
+  TestRng rng(777);
+  auto sameOrder = [](const cgul::CgulDocument& a, const cgul::CgulDocument& b) {
+    return std::equal(a.widgets.begin(), a.widgets.end(), b.widgets.begin(), b.widgets.end(),
+                      [](const cgul::Widget& x, const cgul::Widget& y) { return x.id == y.id; });
+  };
+
+  cgul::CgulDocument base;
+  base.gridWCells = 200;
+  base.gridHCells = 100;
+  base.meta["owner"] = "smoke";
+  for (uint32_t i = 1; i <= 40; ++i) {
+    base.widgets.push_back(cgul::Widget{i, cgul::WidgetKind::Window,
+                                        cgul::RectI{static_cast<int>(i), 0, 4, 3},
+                                        "W" + std::to_string(i)});
+  }
+
+  // Bringing one widget to the front must cost a single reorder.
+  cgul::CgulDocument target = base;
+  std::rotate(target.widgets.begin() + 5, target.widgets.begin() + 6, target.widgets.end());
+  cgul::DocumentPatch patch;
+  std::string error;
+  if (!cgul::DiffDocuments(base, target, &patch, &error) || patch.size() != 1 ||
+      patch[0].op != cgul::JournalOp::ReorderWidget) {
+    PrintFailure("FAIL patch: bring-to-front produced " + std::to_string(patch.size()) +
+                 " records " + error);
+    return 1;
+  }
+
+  uint32_t nextId = 1000;
+  for (int round = 0; round < 300; ++round) {
+    target = base;
+    const uint32_t edits = 1 + rng.Next(12);
+    for (uint32_t e = 0; e < edits; ++e) {
+      std::vector<cgul::Widget>& widgets = target.widgets;
+      const size_t pick = widgets.empty() ? 0 : rng.Next(widgets.size());
+      switch (rng.Next(9)) {
+        case 0:
+          if (!widgets.empty()) {
+            widgets.erase(widgets.begin() + static_cast<std::ptrdiff_t>(pick));
+          }
+          break;
+        case 1:
+          widgets.insert(widgets.begin() + static_cast<std::ptrdiff_t>(
+                                               rng.Next(widgets.size() + 1)),
+                         cgul::Widget{nextId++, cgul::WidgetKind::Label,
+                                      cgul::RectI{1, 2, 3, 4}, "new"});
+          break;
+        case 2:
+          if (!widgets.empty()) {
+            widgets[pick].boundsCells.x = static_cast<int>(rng.Next(100));
+          }
+          break;
+        case 3:
+          if (!widgets.empty()) {
+            widgets[pick].boundsCells.h = 1 + static_cast<int>(rng.Next(20));
+          }
+          break;
+        case 4:
+          if (!widgets.empty()) {
+            widgets[pick].title = "T" + std::to_string(rng.Next(5));
+            widgets[pick].kind = cgul::WidgetKind::Panel;
+          }
+          break;
+        case 5:
+          if (widgets.size() > 1) {
+            std::swap(widgets[pick], widgets[rng.Next(widgets.size())]);
+          }
+          break;
+        case 6:
+          target.meta["k" + std::to_string(rng.Next(4))] = std::to_string(rng.Next(3));
+          break;
+        case 7:
+          target.meta.erase("owner");
+          target.seed = rng.Next(3);
+          break;
+        default:
+          target.gridWCells = 150 + static_cast<int>(rng.Next(100));
+          break;
+      }
+    }
+
+    std::string bytes;
+    cgul::DocumentPatch decoded;
+    cgul::CgulDocument patched = base;
+    std::string diff;
+    if (!cgul::DiffDocuments(base, target, &patch, &error)) {
+      PrintFailure("FAIL patch round " + std::to_string(round) + ": " + error);
+      return 1;
+    }
+    cgul::EncodeJournalRecords(patch, &bytes);
+    if (!cgul::DecodeJournalRecords(bytes, &decoded, &error) ||
+        !cgul::ApplyPatch(&patched, decoded, &error) || !cgul::Equal(target, patched, &diff) ||
+        !sameOrder(target, patched)) {
+      PrintFailure("FAIL patch round " + std::to_string(round) + ": " + error + diff);
+      return 1;
+    }
+  }
+
+  if (!cgul::DiffDocuments(base, base, &patch, &error) || !patch.empty()) {
+    PrintFailure("FAIL patch: identical documents produced records");
+    return 1;
+  }
+  std::cout << "PASS patch\n";
+  return 0;
+}
+
+int RunContentHashCheck() {
+  cgul::CgulDocument doc;
+  doc.gridWCells = 120;
+  doc.gridHCells = 60;
+  doc.seed = 9;
+  doc.meta["owner"] = "smoke";
+  for (uint32_t i = 1; i <= 30; ++i) {
+    doc.widgets.push_back(cgul::Widget{i, i % 2 == 0 ? cgul::WidgetKind::Panel
+                                                     : cgul::WidgetKind::Label,
+                                       cgul::RectI{static_cast<int>(i), 1, 3, 2},
+                                       "H" + std::to_string(i)});
+  }
+  const uint64_t baseHash = cgul::HashDocument(doc);
+
+  // Draw order is not part of document identity (Equal matches widgets by id).
+  cgul::CgulDocument reordered = doc;
+  std::reverse(reordered.widgets.begin(), reordered.widgets.end());
+  if (cgul::HashDocument(reordered) != baseHash) {
+    PrintFailure("FAIL content hash: depends on widget order");
+    return 1;
+  }
+
+  cgul::DocumentIndex index(&reordered);
+  const cgul::DocumentIndex original(&doc);
+  if (index.ContentHash() != baseHash || !cgul::Equal(index, original, nullptr)) {
+    PrintFailure("FAIL content hash: index disagrees with HashDocument");
+    return 1;
+  }
+
+  // Every edit through the index must change the hash and keep the incremental sum exact.
+  std::string error;
+  uint64_t previous = baseHash;
+  for (int step = 0; step < 6; ++step) {
+    const uint32_t id = static_cast<uint32_t>(step * 5 + 1);
+    switch (step) {
+      case 0:
+        index.SetBounds(id, cgul::RectI{40, 40, 3, 2});
+        break;
+      case 1:
+        index.SetTitle(id, "renamed");
+        break;
+      case 2:
+        index.SetKind(id, cgul::WidgetKind::Window);
+        break;
+      case 3:
+        index.Remove(id);
+        break;
+      case 4:
+        index.Insert(3, cgul::Widget{500, cgul::WidgetKind::Panel, cgul::RectI{0, 0, 1, 1}, ""},
+                     &error);
+        break;
+      default:
+        reordered.meta["extra"] = "1";
+        break;
+    }
+    const uint64_t hash = index.ContentHash();
+    if (hash == previous || hash != cgul::HashDocument(reordered) ||
+        cgul::Equal(index, original, nullptr)) {
+      PrintFailure("FAIL content hash: edit " + std::to_string(step) + " not reflected");
+      return 1;
+    }
+    previous = hash;
+  }
+
+  std::cout << "PASS content hash\n";
+  return 0;
+}
+
+int RunHistoryCheck() {
+  cgul::CgulDocument doc;
+  doc.gridWCells = 1000;
+  doc.gridHCells = 1000;
+  for (uint32_t i = 1; i <= 10000; ++i) {
+    doc.widgets.push_back(cgul::Widget{i, cgul::WidgetKind::Panel,
+                                       cgul::RectI{static_cast<int>(i % 900), 0, 4, 3},
+                                       "P" + std::to_string(i)});
+  }
+  const cgul::CgulDocument original = doc;
+  const cgul::PersistentDocument base = cgul::PersistentDocument::FromDocument(doc);
+
+  // Mirror every persistent edit on a plain document to check the versions stay exact.
+  TestRng rng(4242);
+  cgul::DocumentHistory history(size_t{1} << 30);
+  history.Reset(base);
+  const int kSteps = 2000;
+  uint32_t nextId = 20000;
+  for (int step = 0; step < kSteps; ++step) {
+    const cgul::PersistentDocument& current = history.current();
+    const size_t position = rng.Next(doc.widgets.size());
+    switch (rng.Next(4)) {
+      case 0: {
+        cgul::Widget widget = doc.widgets[position];
+        widget.boundsCells.x = static_cast<int>(rng.Next(900));
+        doc.widgets[position] = widget;
+        history.Commit(current.WithWidget(position, widget));
+        break;
+      }
+      case 1: {
+        const cgul::Widget widget{nextId++, cgul::WidgetKind::Label, cgul::RectI{0, 0, 1, 1}, ""};
+        doc.widgets.insert(doc.widgets.begin() + static_cast<std::ptrdiff_t>(position), widget);
+        history.Commit(current.WithWidgetInserted(position, widget));
+        break;
+      }
+      case 2:
+        doc.widgets.erase(doc.widgets.begin() + static_cast<std::ptrdiff_t>(position));
+        history.Commit(current.WithWidgetRemoved(position));
+        break;
+      default: {
+        const size_t to = rng.Next(doc.widgets.size());
+        const cgul::Widget widget = doc.widgets[position];
+        doc.widgets.erase(doc.widgets.begin() + static_cast<std::ptrdiff_t>(position));
+        doc.widgets.insert(doc.widgets.begin() + static_cast<std::ptrdiff_t>(to), widget);
+        history.Commit(current.WithWidgetMoved(position, to));
+        break;
+      }
+    }
+  }
+
+  std::string diff;
+  if (!cgul::Equal(history.current().ToDocument(), doc, &diff)) {
+    PrintFailure("FAIL history: final version differs: " + diff);
+    return 1;
+  }
+  const size_t perStep = (history.memoryBytes() - base.MemoryBytes()) / kSteps;
+  if (perStep > 16 * 1024) {
+    PrintFailure("FAIL history: " + std::to_string(perStep) + " bytes per step");
+    return 1;
+  }
+  while (history.Undo()) {
+  }
+  if (!cgul::Equal(history.current().ToDocument(), original, &diff)) {
+    PrintFailure("FAIL history: undo did not restore the original: " + diff);
+    return 1;
+  }
+  while (history.Redo()) {
+  }
+  if (!cgul::Equal(history.current().ToDocument(), doc, &diff)) {
+    PrintFailure("FAIL history: redo did not restore the final version: " + diff);
+    return 1;
+  }
+
+  // A tight limit drops the oldest steps but keeps the current version intact.
+  cgul::DocumentHistory capped(base.MemoryBytes() + 64 * 1024);
+  capped.Reset(base);
+  for (int step = 0; step < 500; ++step) {
+    const size_t position = rng.Next(capped.current().widgetCount());
+    cgul::Widget widget = capped.current().widget(position);
+    widget.title = "step" + std::to_string(step);
+    capped.Commit(capped.current().WithWidget(position, widget));
+  }
+  if (capped.memoryBytes() > capped.memoryLimitBytes() || capped.undoCount() == 0 ||
+      capped.undoCount() >= 500 || capped.current().widgetCount() != original.widgets.size()) {
+    PrintFailure("FAIL history: memory limit not enforced");
+    return 1;
+  }
+
+  std::cout << "PASS history (" << perStep << " bytes/step, " << capped.undoCount()
+            << " steps kept under limit)\n";
+  return 0;
+}
+
+int RunSnapshotCheck() {
+  // Each published document and frame is self-consistent; readers racing the writer must
+  // never see a torn or freed version, and versions must not go backwards.
+  auto makeDoc = [](uint32_t version) {
+    cgul::CgulDocument doc;
+    doc.gridWCells = 40;
+    doc.gridHCells = 10;
+    doc.seed = version;
+    for (uint32_t i = 1; i <= version % 8; ++i) {
+      doc.widgets.push_back(cgul::Widget{i, cgul::WidgetKind::Panel,
+                                         cgul::RectI{static_cast<int>(i) * 4, 0, 3, 3},
+                                         "v" + std::to_string(version)});
+    }
+    return doc;
+  };
+  cgul::Snapshot<cgul::CgulDocument> docs(makeDoc(0));
+  cgul::Snapshot<cgul::Frame> frames(cgul::ComposeLayoutToFrame(makeDoc(0)));
+
+  const uint32_t kVersions = 500;
+  std::atomic<bool> writerDone{false};
+  std::atomic<int> failures{0};
+  auto reader = [&]() {
+    uint64_t lastSeed = 0;
+    while (!writerDone.load()) {
+      const auto doc = docs.Read();
+      const uint32_t version = static_cast<uint32_t>(doc->seed);
+      bool ok = version >= lastSeed && doc->widgets.size() == version % 8;
+      for (const cgul::Widget& widget : doc->widgets) {
+        ok = ok && widget.title == "v" + std::to_string(version);
+      }
+      lastSeed = version;
+
+      const auto frame = frames.Read();
+      ok = ok && frame->cells.size() == static_cast<size_t>(frame->width * frame->height);
+      if (!ok) {
+        failures.fetch_add(1);
+      }
+    }
+  };
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 3; ++i) {
+    readers.emplace_back(reader);
+  }
+  for (uint32_t version = 1; version <= kVersions; ++version) {
+    cgul::CgulDocument doc = makeDoc(version);
+    frames.Publish(cgul::ComposeLayoutToFrame(doc));
+    docs.Publish(std::move(doc));
+  }
+  writerDone.store(true);
+  for (std::thread& thread : readers) {
+    thread.join();
+  }
+
+  // A held guard keeps its version alive across publishes; releasing it lets Reclaim free it.
+  auto pinned = docs.Read();
+  docs.Publish(makeDoc(kVersions + 1));
+  const size_t retiredWhilePinned = docs.Reclaim();
+  const bool pinnedIntact = pinned->seed == kVersions;
+  pinned.Release();
+  if (failures.load() != 0 || docs.version() != kVersions + 1 || retiredWhilePinned == 0 ||
+      !pinnedIntact || docs.Reclaim() != 0 || docs.Read()->seed != kVersions + 1) {
+    PrintFailure("FAIL snapshot: " + std::to_string(failures.load()) + " inconsistent reads");
+    return 1;
+  }
+
+  std::cout << "PASS snapshot\n";
+  return 0;
+}
+
+int RunRevisionCheck() {
+  cgul::CgulDocument doc;
+  doc.gridWCells = 100;
+  doc.gridHCells = 100;
+  cgul::DocumentIndex index(&doc);
+
+  // A cache refreshed only from ChangedSince must track the document exactly, including
+  // across change-log compaction under id churn.
+  std::map<uint32_t, cgul::Widget> cache;
+  uint64_t cachedRevision = index.revision();
+  TestRng rng(99);
+  uint32_t nextId = 1;
+  std::string error;
+  cgul::DocumentChanges changes;
+  for (int round = 0; round < 400; ++round) {
+    const uint32_t edits = 1 + rng.Next(20);
+    for (uint32_t e = 0; e < edits; ++e) {
+      const uint32_t size = static_cast<uint32_t>(doc.widgets.size());
+      const uint32_t pick = size == 0 ? 0 : doc.widgets[rng.Next(size)].id;
+      switch (size == 0 ? 0 : rng.Next(4)) {
+        case 0:
+          index.Insert(rng.Next(size + 1),
+                       cgul::Widget{nextId++, cgul::WidgetKind::Panel, cgul::RectI{0, 0, 1, 1},
+                                    ""},
+                       &error);
+          break;
+        case 1:
+          index.Remove(pick);
+          break;
+        case 2:
+          index.SetBounds(pick, cgul::RectI{static_cast<int>(rng.Next(90)), 0, 2, 2});
+          break;
+        default:
+          index.MoveTo(pick, rng.Next(size));
+          break;
+      }
+    }
+
+    if (!index.ChangedSince(cachedRevision, &changes)) {
+      PrintFailure("FAIL revisions: recent revision " + std::to_string(cachedRevision) +
+                   " no longer answerable");
+      return 1;
+    }
+    for (const uint32_t id : changes.removed) {
+      cache.erase(id);
+    }
+    for (const uint32_t id : changes.changed) {
+      cache[id] = *index.Find(id);
+    }
+    cachedRevision = index.revision();
+    if (cache.size() != doc.widgets.size()) {
+      PrintFailure("FAIL revisions: cache holds " + std::to_string(cache.size()) + " widgets, " +
+                   "document " + std::to_string(doc.widgets.size()));
+      return 1;
+    }
+    for (const cgul::Widget& widget : doc.widgets) {
+      const auto cached = cache.find(widget.id);
+      if (cached == cache.end() || !cgul::Equal(cached->second, widget) ||
+          index.WidgetRevision(widget.id) > cachedRevision) {
+        PrintFailure("FAIL revisions: stale cache entry for id " + std::to_string(widget.id));
+        return 1;
+      }
+    }
+  }
+
+  // Header edits are flagged separately; a Rebuild makes older revisions unanswerable.
+  index.SetSeed(5);
+  const bool headerFlagged = index.ChangedSince(cachedRevision, &changes) &&
+                             changes.headerChanged && changes.changed.empty();
+  const uint64_t beforeRebuild = index.revision();
+  index.Rebuild(nullptr);
+  if (!headerFlagged || index.ChangedSince(beforeRebuild, &changes) ||
+      !index.ChangedSince(index.revision(), &changes) || !changes.changed.empty()) {
+    PrintFailure("FAIL revisions: header change or rebuild not reported");
+    return 1;
+  }
+
+  std::cout << "PASS revisions (" << nextId - 1 << " ids churned)\n";
+  return 0;
+}
+
+int RunTypedMetaCheck() {
+  cgul::CgulDocument doc;
+  doc.gridWCells = 10;
+  doc.gridHCells = 10;
+  doc.meta["camera.x"] = cgul::MetaValue::FromFloat(0.1);
+  doc.meta["camera.y"] = cgul::MetaValue::FromFloat(-0.0);
+  doc.meta["camera.zoom"] = cgul::MetaValue::FromFloat(static_cast<float>(1.0 / 3.0));
+  doc.meta["huge"] = cgul::MetaValue::FromFloat(1e300);
+  doc.meta["whole"] = cgul::MetaValue::FromFloat(2.0);
+  doc.meta["chunks"] = cgul::MetaValue::FromInt(INT64_MIN);
+  doc.meta["enabled"] = cgul::MetaValue::FromBool(true);
+  doc.meta["label"] = "12";
+
+  // Text, binary and journal records must all carry the type and the exact bits.
+  std::string text;
+  std::string bytes;
+  std::string error;
+  std::string diff;
+  cgul::CgulDocument fromText;
+  cgul::CgulDocument fromBinary;
+  if (!cgul::SaveCgulToBuffer(doc, &text, &error) ||
+      !cgul::LoadCgulFromBuffer(text, &fromText, &error) ||
+      !cgul::SaveCgulBinaryToBuffer(doc, &bytes, &error) ||
+      !cgul::LoadCgulBinaryFromBuffer(bytes, &fromBinary, &error)) {
+    PrintFailure("FAIL typed meta: " + error);
+    return 1;
+  }
+  if (!cgul::Equal(doc, fromText, &diff) || !cgul::Equal(doc, fromBinary, &diff)) {
+    PrintFailure("FAIL typed meta round-trip: " + diff);
+    return 1;
+  }
+  double zoom = 0.0;
+  int64_t chunks = 0;
+  std::string label;
+  if (text.find("\"whole\": 2.0") == std::string::npos ||
+      !fromText.meta.GetFloat("camera.zoom", &zoom) ||
+      static_cast<float>(zoom) != static_cast<float>(1.0 / 3.0) ||
+      !fromBinary.meta.GetInt("chunks", &chunks) || chunks != INT64_MIN ||
+      fromText.meta.GetInt("label", &chunks) || !fromText.meta.GetString("label", &label)) {
+    PrintFailure("FAIL typed meta: values changed type or value");
+    return 1;
+  }
+
+  cgul::CgulDocument replayed;
+  replayed.gridWCells = 10;
+  replayed.gridHCells = 10;
+  std::vector<cgul::JournalRecord> records;
+  for (const auto& entry : doc.meta) {
+    records.push_back(cgul::MakeSetMetaRecord(entry.first, entry.second));
+  }
+  std::string encoded;
+  cgul::EncodeJournalRecords(records, &encoded);
+  std::vector<cgul::JournalRecord> decoded;
+  if (!cgul::DecodeJournalRecords(encoded, &decoded, &error)) {
+    PrintFailure("FAIL typed meta journal: " + error);
+    return 1;
+  }
+  for (const cgul::JournalRecord& record : decoded) {
+    if (!cgul::ApplyJournalRecord(&replayed, record, &error)) {
+      PrintFailure("FAIL typed meta journal: " + error);
+      return 1;
+    }
+  }
+  if (!cgul::Equal(doc, replayed, &diff)) {
+    PrintFailure("FAIL typed meta journal: " + diff);
+    return 1;
+  }
+
+  // The string "12" and the int 12 are different documents.
+  cgul::CgulDocument retyped = doc;
+  retyped.meta["label"] = cgul::MetaValue::FromInt(12);
+  if (cgul::Equal(doc, retyped, nullptr) ||
+      cgul::HashDocument(doc) == cgul::HashDocument(retyped)) {
+    PrintFailure("FAIL typed meta: type ignored by Equal or HashDocument");
+    return 1;
+  }
+
+  // Fractions are accepted only in meta values, and non-finite floats cannot be saved.
+  cgul::CgulDocument rejected;
+  retyped.meta["huge"] = cgul::MetaValue::FromFloat(1e300 * 1e300);
+  if (cgul::LoadCgulFromBuffer(
+          "{\"cgulVersion\": \"0.1\", \"grid\": {\"w\": 1.5, \"h\": 1}, \"seed\": 0, "
+          "\"widgets\": []}",
+          &rejected, &error) ||
+      cgul::SaveCgulToBuffer(retyped, &text, &error)) {
+    PrintFailure("FAIL typed meta: float accepted outside meta or non-finite float saved");
+    return 1;
+  }
+
+  std::cout << "PASS typed meta (" << doc.meta.size() << " values)\n";
+  return 0;
+}
+
+int RunOverlapCheck() {
+  TestRng rng(4242);
+
+  // The sweep must name the same pair as the pairwise scan it replaced.
+  for (int round = 0; round < 300; ++round) {
+    cgul::CgulDocument doc;
+    doc.gridWCells = 60;
+    doc.gridHCells = 60;
+    const uint32_t count = 2 + rng.Next(40);
+    for (uint32_t id = 1; id <= count; ++id) {
+      const int w = 1 + static_cast<int>(rng.Next(8));
+      const int h = 1 + static_cast<int>(rng.Next(8));
+      doc.widgets.push_back(cgul::Widget{
+          id, rng.Next(4) == 0 ? cgul::WidgetKind::Panel : cgul::WidgetKind::Window,
+          cgul::RectI{static_cast<int>(rng.Next(60 - w + 1)),
+                      static_cast<int>(rng.Next(60 - h + 1)), w, h},
+          ""});
+    }
+    std::string expected;
+    for (size_t i = 0; i < doc.widgets.size() && expected.empty(); ++i) {
+      for (size_t j = i + 1; j < doc.widgets.size() && expected.empty(); ++j) {
+        const cgul::Widget& a = doc.widgets[i];
+        const cgul::Widget& b = doc.widgets[j];
+        const bool hasCells = a.boundsCells.w > 0 && a.boundsCells.h > 0 &&
+                              b.boundsCells.w > 0 && b.boundsCells.h > 0;
+        if (a.kind == cgul::WidgetKind::Window && b.kind == cgul::WidgetKind::Window &&
+            hasCells && a.boundsCells.x < b.boundsCells.x + b.boundsCells.w &&
+            b.boundsCells.x < a.boundsCells.x + a.boundsCells.w &&
+            a.boundsCells.y < b.boundsCells.y + b.boundsCells.h &&
+            b.boundsCells.y < a.boundsCells.y + a.boundsCells.h) {
+          expected = "window overlap is not allowed in v0.1 (ids " + std::to_string(a.id) +
+                     " and " + std::to_string(b.id) + ")";
+        }
+      }
+    }
+    std::string error;
+    cgul::Validate(doc, &error);
+    if (error != expected) {
+      PrintFailure("FAIL overlap round " + std::to_string(round) + ": expected \"" + expected +
+                   "\" got \"" + error + "\"");
+      return 1;
+    }
+  }
+
+  // 50k touching windows: valid, and far too many for a pairwise scan.
+  cgul::CgulDocument large;
+  large.gridWCells = 1000;
+  large.gridHCells = 1000;
+  for (uint32_t i = 0; i < 50000; ++i) {
+    large.widgets.push_back(cgul::Widget{i + 1, cgul::WidgetKind::Window,
+                                         cgul::RectI{static_cast<int>(i % 250) * 4,
+                                                     static_cast<int>(i / 250) * 5, 4, 5},
+                                         ""});
+  }
+  std::swap(large.widgets[17], large.widgets[40000]);
+  const auto start = std::chrono::steady_clock::now();
+  std::string error;
+  const bool valid = cgul::Validate(large, &error);
+  const auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+  large.widgets[49999].boundsCells.y -= 1;
+  if (!valid || cgul::Validate(large, &error) ||
+      error != "window overlap is not allowed in v0.1 (ids 49750 and 50000)") {
+    PrintFailure("FAIL overlap large: " + error);
+    return 1;
+  }
+
+  std::cout << "PASS overlap (50000 windows validated in " << elapsedMs << " ms)\n";
+  return 0;
+}
+
+int RunEditValidatorCheck() {
+  TestRng rng(99);
+
+  cgul::CgulDocument doc;
+  doc.gridWCells = 400;
+  doc.gridHCells = 300;
+  for (uint32_t i = 0; i < 1500; ++i) {
+    doc.widgets.push_back(cgul::Widget{i + 1,
+                                       i % 7 == 0 ? cgul::WidgetKind::Label
+                                                  : cgul::WidgetKind::Window,
+                                       cgul::RectI{static_cast<int>(i % 50) * 8,
+                                                   static_cast<int>(i / 50) * 10, 6, 8},
+                                       ""});
+  }
+  cgul::DocumentIndex index(&doc);
+  cgul::EditValidator validator(&index);
+
+  // Every verdict must match Validate on an edited copy; accepted edits are applied, and other
+  // edits go through the index so the validator has to follow them.
+  uint32_t nextId = 1501;
+  std::string error;
+  for (int step = 0; step < 3000; ++step) {
+    if (step % 50 == 49) {
+      const cgul::Widget added{nextId++, cgul::WidgetKind::Window,
+                               cgul::RectI{static_cast<int>(rng.Next(390)), 295, 3, 3}, ""};
+      index.Insert(rng.Next(doc.widgets.size()), added, &error);
+      index.Remove(doc.widgets[rng.Next(doc.widgets.size())].id);
+      index.MoveTo(doc.widgets[0].id, doc.widgets.size());
+      if (!cgul::Validate(doc, &error)) {
+        index.Remove(added.id);
+      }
+    }
+    const cgul::Widget& widget = doc.widgets[rng.Next(doc.widgets.size())];
+    const uint32_t id = widget.id;
+    const cgul::RectI candidate{widget.boundsCells.x + static_cast<int>(rng.Next(9)) - 4,
+                                widget.boundsCells.y + static_cast<int>(rng.Next(9)) - 4,
+                                1 + static_cast<int>(rng.Next(8)),
+                                1 + static_cast<int>(rng.Next(10))};
+    cgul::CgulDocument edited = doc;
+    edited.widgets[index.IndexOf(id)].boundsCells = candidate;
+    std::string expected;
+    std::string linear;
+    std::string indexed;
+    const bool valid = cgul::Validate(edited, &expected);
+    if (cgul::ValidateEdit(doc, id, candidate, &linear) != valid ||
+        validator.ValidateEdit(id, candidate, &indexed) != valid || linear != expected ||
+        indexed != expected) {
+      PrintFailure("FAIL edit validator step " + std::to_string(step) + ": expected \"" +
+                   expected + "\" linear \"" + linear + "\" indexed \"" + indexed + "\"");
+      return 1;
+    }
+    if (valid) {
+      index.SetBounds(id, candidate);
+    }
+  }
+
+  // Drag feedback on 10k windows: one check per mouse move.
+  cgul::CgulDocument large;
+  large.gridWCells = 1000;
+  large.gridHCells = 500;
+  for (uint32_t i = 0; i < 10000; ++i) {
+    large.widgets.push_back(cgul::Widget{i + 1, cgul::WidgetKind::Window,
+                                         cgul::RectI{static_cast<int>(i % 100) * 10,
+                                                     static_cast<int>(i / 100) * 5, 9, 4},
+                                         ""});
+  }
+  cgul::DocumentIndex largeIndex(&large);
+  cgul::EditValidator largeValidator(&largeIndex);
+  const auto start = std::chrono::steady_clock::now();
+  int accepted = 0;
+  for (int move = 0; move < 10000; ++move) {
+    const cgul::RectI candidate{static_cast<int>(rng.Next(991)),
+                                static_cast<int>(rng.Next(496)), 9, 4};
+    if (largeValidator.ValidateEdit(5050, candidate, &error)) {
+      largeIndex.SetBounds(5050, candidate);
+      ++accepted;
+    }
+  }
+  const auto elapsedUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+  if (accepted == 0 || !cgul::Validate(large, &error)) {
+    PrintFailure("FAIL edit validator drag: " + error);
+    return 1;
+  }
+
+  std::cout << "PASS edit validator (10000 checks on 10000 windows in " << elapsedUs
+            << " us)\n";
+  return 0;
+}
+
+int RunCellOccupancyCheck() {
+  TestRng rng(47);
+
+  // Grids wider than one word, filled and cleared at random, checked against a plain cell array.
+  for (int round = 0; round < 40; ++round) {
+    const int gridW = 1 + static_cast<int>(rng.Next(200));
+    const int gridH = 1 + static_cast<int>(rng.Next(40));
+    cgul::CellOccupancy occupancy(gridW, gridH);
+    std::vector<char> cells(static_cast<size_t>(gridW) * static_cast<size_t>(gridH), 0);
+    auto randomRect = [&]() {
+      return cgul::RectI{static_cast<int>(rng.Next(gridW + 10)) - 5,
+                         static_cast<int>(rng.Next(gridH + 6)) - 3,
+                         static_cast<int>(rng.Next(130)), static_cast<int>(rng.Next(12))};
+    };
+    auto cellAt = [&](int x, int y) -> char& {
+      return cells[static_cast<size_t>(y) * static_cast<size_t>(gridW) + static_cast<size_t>(x)];
+    };
+
+    for (int step = 0; step < 60; ++step) {
+      const cgul::RectI rect = randomRect();
+      const bool fill = rng.Next(3) != 0;
+      if (fill) {
+        occupancy.Fill(rect);
+      } else {
+        occupancy.Clear(rect);
+      }
+      for (int y = std::max(0, rect.y); y < std::min(gridH, rect.y + rect.h); ++y) {
+        for (int x = std::max(0, rect.x); x < std::min(gridW, rect.x + rect.w); ++x) {
+          cellAt(x, y) = fill ? 1 : 0;
+        }
+      }
+
+      const cgul::RectI query = randomRect();
+      size_t expectedCount = 0;
+      std::vector<cgul::RectI> expectedRuns;
+      for (int y = std::max(0, query.y); y < std::min(gridH, query.y + query.h); ++y) {
+        for (int x = std::max(0, query.x); x < std::min(gridW, query.x + query.w); ++x) {
+          if (cellAt(x, y) == 0) {
+            continue;
+          }
+          ++expectedCount;
+          if (!expectedRuns.empty() && expectedRuns.back().y == y &&
+              expectedRuns.back().x + expectedRuns.back().w == x) {
+            ++expectedRuns.back().w;
+          } else {
+            expectedRuns.push_back(cgul::RectI{x, y, 1, 1});
+          }
+        }
+      }
+      const bool inside = query.w > 0 && query.h > 0 && query.x >= 0 && query.y >= 0 &&
+                          query.x + query.w <= gridW && query.y + query.h <= gridH;
+      std::vector<cgul::RectI> runs;
+      occupancy.CollectOccupied(query, &runs);
+      bool runsMatch = runs.size() == expectedRuns.size();
+      for (size_t i = 0; runsMatch && i < runs.size(); ++i) {
+        runsMatch = cgul::Equal(runs[i], expectedRuns[i]);
+      }
+      if (occupancy.CountOccupied(query) != expectedCount || !runsMatch ||
+          occupancy.IsFree(query) != (inside && expectedCount == 0)) {
+        PrintFailure("FAIL cell occupancy query round " + std::to_string(round) + " step " +
+                     std::to_string(step));
+        return 1;
+      }
+
+      const int w = 1 + static_cast<int>(rng.Next(70));
+      const int h = 1 + static_cast<int>(rng.Next(6));
+      const int row = static_cast<int>(rng.Next(gridH));
+      const int minX = static_cast<int>(rng.Next(gridW));
+      int expectedSpan = -1;
+      for (int x = minX; expectedSpan < 0 && x + w <= gridW; ++x) {
+        bool free = true;
+        for (int dx = 0; free && dx < w; ++dx) {
+          free = cellAt(x + dx, row) == 0;
+        }
+        expectedSpan = free ? x : -1;
+      }
+      bool expectedFound = false;
+      cgul::RectI expectedRect;
+      for (int y = 0; !expectedFound && y + h <= gridH; ++y) {
+        for (int x = 0; !expectedFound && x + w <= gridW; ++x) {
+          expectedRect = cgul::RectI{x, y, w, h};
+          expectedFound = true;
+          for (int dy = 0; expectedFound && dy < h; ++dy) {
+            for (int dx = 0; expectedFound && dx < w; ++dx) {
+              expectedFound = cellAt(x + dx, y + dy) == 0;
+            }
+          }
+        }
+      }
+      int expectedLast = std::min(minX + w, gridW - 1);
+      while (expectedLast >= 0 && cellAt(expectedLast, row) != 0) {
+        --expectedLast;
+      }
+      cgul::RectI found;
+      const bool foundAny = occupancy.FindFreeRect(w, h, &found);
+      if (occupancy.FindFreeSpan(row, minX, w) != expectedSpan || foundAny != expectedFound ||
+          occupancy.FindLastFreeCell(row, minX + w) != expectedLast ||
+          (foundAny && !cgul::Equal(found, expectedRect))) {
+        PrintFailure("FAIL cell occupancy search round " + std::to_string(round) + " step " +
+                     std::to_string(step));
+        return 1;
+      }
+    }
+
+    size_t total = 0;
+    for (const char cell : cells) {
+      total += static_cast<size_t>(cell);
+    }
+    if (occupancy.occupiedCount() != total) {
+      PrintFailure("FAIL cell occupancy total round " + std::to_string(round));
+      return 1;
+    }
+  }
+
+  cgul::CgulDocument doc;
+  doc.gridWCells = 30;
+  doc.gridHCells = 10;
+  doc.widgets.push_back(cgul::Widget{1, cgul::WidgetKind::Window, cgul::RectI{0, 0, 10, 5}, ""});
+  doc.widgets.push_back(cgul::Widget{2, cgul::WidgetKind::Label, cgul::RectI{1, 1, 4, 1}, ""});
+  doc.widgets.push_back(cgul::Widget{3, cgul::WidgetKind::Panel, cgul::RectI{25, 8, 10, 5}, ""});
+  const cgul::CellOccupancy windows =
+      cgul::CellOccupancy::ForDocument(doc, cgul::OccupancyLayer::Windows);
+  const cgul::CellOccupancy all =
+      cgul::CellOccupancy::ForDocument(doc, cgul::OccupancyLayer::AllWidgets);
+  if (windows.occupiedCount() != 50 || all.occupiedCount() != 60) {
+    PrintFailure("FAIL cell occupancy layers");
+    return 1;
+  }
+
+  std::cout << "PASS cell occupancy\n";
+  return 0;
+}
+
+int RunValidateAllCheck() {
+  TestRng rng(2024);
+
+  // Random broken documents against a brute-force list in the documented order.
+  for (int round = 0; round < 60; ++round) {
+    cgul::CgulDocument doc;
+    doc.cgulVersion = round % 9 == 0 ? "0.2" : "0.1";
+    doc.gridWCells = round % 13 == 0 ? 0 : 40 + static_cast<int>(rng.Next(200));
+    doc.gridHCells = 30 + static_cast<int>(rng.Next(100));
+    const uint32_t count = 1 + rng.Next(400);
+    for (uint32_t i = 0; i < count; ++i) {
+      const uint32_t id = rng.Next(50) == 0 ? 0 : (rng.Next(30) == 0 ? 1 + rng.Next(i + 1) : i + 1);
+      doc.widgets.push_back(
+          cgul::Widget{id, rng.Next(3) == 0 ? cgul::WidgetKind::Label : cgul::WidgetKind::Window,
+                       cgul::RectI{static_cast<int>(rng.Next(260)) - 10,
+                                   static_cast<int>(rng.Next(140)) - 5,
+                                   static_cast<int>(rng.Next(20)),
+                                   static_cast<int>(rng.Next(12))},
+                       ""});
+    }
+
+    std::vector<cgul::ValidationIssue> expected;
+    const size_t none = cgul::ValidationIssue::kNoWidget;
+    if (doc.cgulVersion != "0.1") {
+      expected.push_back({cgul::ValidationRule::Version, none, 0, none, 0, ""});
+    }
+    const bool gridValid = doc.gridWCells > 0 && doc.gridHCells > 0;
+    if (!gridValid) {
+      expected.push_back({cgul::ValidationRule::Grid, none, 0, none, 0, ""});
+    }
+    for (size_t i = 0; i < doc.widgets.size(); ++i) {
+      const cgul::Widget& widget = doc.widgets[i];
+      size_t first = 0;
+      while (doc.widgets[first].id != widget.id) {
+        ++first;
+      }
+      if (widget.id == 0) {
+        expected.push_back({cgul::ValidationRule::WidgetId, i, 0, none, 0, ""});
+      } else if (first != i) {
+        expected.push_back({cgul::ValidationRule::DuplicateId, i, widget.id, first, widget.id, ""});
+      }
+      const cgul::RectI& b = widget.boundsCells;
+      if (gridValid && (b.w <= 0 || b.h <= 0 || b.x < 0 || b.y < 0 ||
+                        b.x + b.w > doc.gridWCells || b.y + b.h > doc.gridHCells)) {
+        expected.push_back({cgul::ValidationRule::Bounds, i, widget.id, none, 0, ""});
+      }
+    }
+    for (size_t i = 0; i < doc.widgets.size(); ++i) {
+      for (size_t j = i + 1; j < doc.widgets.size(); ++j) {
+        const cgul::Widget& a = doc.widgets[i];
+        const cgul::Widget& b = doc.widgets[j];
+        const bool hasCells = a.boundsCells.w > 0 && a.boundsCells.h > 0 &&
+                              b.boundsCells.w > 0 && b.boundsCells.h > 0;
+        if (a.kind == cgul::WidgetKind::Window && b.kind == cgul::WidgetKind::Window &&
+            hasCells && a.boundsCells.x < b.boundsCells.x + b.boundsCells.w &&
+            b.boundsCells.x < a.boundsCells.x + a.boundsCells.w &&
+            a.boundsCells.y < b.boundsCells.y + b.boundsCells.h &&
+            b.boundsCells.y < a.boundsCells.y + a.boundsCells.h) {
+          expected.push_back({cgul::ValidationRule::WindowOverlap, i, a.id, j, b.id, ""});
+        }
+      }
+    }
+
+    std::string error;
+    const bool valid = cgul::Validate(doc, &error);
+    for (const unsigned threads : {1u, 4u}) {
+      cgul::ValidateAllOptions options;
+      options.threadCount = threads;
+      options.maxIssues = 0;
+      cgul::ValidationReport report;
+      bool matches = cgul::ValidateAll(doc, options, &report) == valid &&
+                     report.issues.size() == expected.size() && !report.truncated &&
+                     (valid || report.issues[0].message == error);
+      for (size_t i = 0; matches && i < expected.size(); ++i) {
+        const cgul::ValidationIssue& got = report.issues[i];
+        matches = got.rule == expected[i].rule && got.widgetIndex == expected[i].widgetIndex &&
+                  got.widgetId == expected[i].widgetId &&
+                  got.otherIndex == expected[i].otherIndex &&
+                  got.otherId == expected[i].otherId && !got.message.empty();
+      }
+      if (!matches) {
+        PrintFailure("FAIL validate all round " + std::to_string(round) + " threads " +
+                     std::to_string(threads) + ": " + std::to_string(report.issues.size()) +
+                     " issues, expected " + std::to_string(expected.size()));
+        return 1;
+      }
+
+      options.maxIssues = 7;
+      cgul::ValidationReport capped;
+      cgul::ValidateAll(doc, options, &capped);
+      matches = capped.truncated == (expected.size() > 7) &&
+                capped.issues.size() == std::min<size_t>(7, expected.size());
+      for (size_t i = 0; matches && i < capped.issues.size(); ++i) {
+        matches = capped.issues[i].message == report.issues[i].message;
+      }
+      if (!matches) {
+        PrintFailure("FAIL validate all cap round " + std::to_string(round));
+        return 1;
+      }
+    }
+  }
+
+  // An imported layout with a few hundred scattered faults among 200k widgets.
+  cgul::CgulDocument large;
+  large.gridWCells = 4000;
+  large.gridHCells = 2500;
+  for (uint32_t i = 0; i < 200000; ++i) {
+    large.widgets.push_back(cgul::Widget{i + 1, cgul::WidgetKind::Window,
+                                         cgul::RectI{static_cast<int>(i % 500) * 8,
+                                                     static_cast<int>(i / 500) * 6, 7, 5},
+                                         ""});
+  }
+  for (int fault = 0; fault < 300; ++fault) {
+    cgul::Widget& widget = large.widgets[rng.Next(200000)];
+    widget.boundsCells.x += static_cast<int>(rng.Next(5));
+    widget.boundsCells.y += static_cast<int>(rng.Next(4));
+  }
+  cgul::ValidateAllOptions largeOptions;
+  largeOptions.maxIssues = 0;
+  cgul::ValidationReport largeReport;
+  const auto start = std::chrono::steady_clock::now();
+  cgul::ValidateAll(large, largeOptions, &largeReport);
+  const auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+  std::string error;
+  cgul::Validate(large, &error);
+  if (largeReport.issues.empty() || largeReport.issues[0].message != error) {
+    PrintFailure("FAIL validate all large: " + error);
+    return 1;
+  }
+
+  std::cout << "PASS validate all (" << largeReport.issues.size() << " issues in 200000 widgets, "
+            << elapsedMs << " ms, threads=" << largeReport.threadCount << ")\n";
+  return 0;
+}
+
+int RunPlacementCheck() {
+  TestRng rng(4049);
+
+  // Random valid layouts; the answer must be a valid placement at the brute-force distance.
+  std::string error;
+  for (int round = 0; round < 200; ++round) {
+    cgul::CgulDocument doc;
+    doc.gridWCells = 20 + static_cast<int>(rng.Next(120));
+    doc.gridHCells = 10 + static_cast<int>(rng.Next(40));
+    cgul::CellOccupancy placed(doc.gridWCells, doc.gridHCells);
+    for (uint32_t attempt = 0; attempt < 60; ++attempt) {
+      const cgul::RectI rect{static_cast<int>(rng.Next(doc.gridWCells)),
+                             static_cast<int>(rng.Next(doc.gridHCells)),
+                             1 + static_cast<int>(rng.Next(16)), 1 + static_cast<int>(rng.Next(8))};
+      if (placed.IsFree(rect)) {
+        placed.Fill(rect);
+        doc.widgets.push_back(cgul::Widget{static_cast<uint32_t>(doc.widgets.size() + 1),
+                                           cgul::WidgetKind::Window, rect, ""});
+      }
+    }
+    const cgul::Widget& moving = doc.widgets[rng.Next(doc.widgets.size())];
+    // Desired origins may lie outside the grid, as a drag past the edge produces.
+    const int desiredX = static_cast<int>(rng.Next(doc.gridWCells + 40)) - 20;
+    const int desiredY = static_cast<int>(rng.Next(doc.gridHCells + 20)) - 10;
+    const cgul::RectI desired{desiredX, desiredY, moving.boundsCells.w, moving.boundsCells.h};
+
+    int64_t expected = INT64_MAX;
+    for (int y = 0; y + desired.h <= doc.gridHCells; ++y) {
+      for (int x = 0; x + desired.w <= doc.gridWCells; ++x) {
+        if (cgul::ValidateEdit(doc, moving.id, cgul::RectI{x, y, desired.w, desired.h}, &error)) {
+          const int64_t dx = x - desired.x;
+          const int64_t dy = y - desired.y;
+          expected = std::min(expected, dx * dx + dy * dy);
+        }
+      }
+    }
+    cgul::RectI result;
+    if (!cgul::FindNearestFreePlacement(doc, moving.id, desired, &result, &error) ||
+        result.w != desired.w || result.h != desired.h ||
+        !cgul::ValidateEdit(doc, moving.id, result, &error) ||
+        (static_cast<int64_t>(result.x) - desired.x) * (result.x - desired.x) +
+                (static_cast<int64_t>(result.y) - desired.y) * (result.y - desired.y) !=
+            expected) {
+      PrintFailure("FAIL placement round " + std::to_string(round) + ": " + error);
+      return 1;
+    }
+  }
+
+  // Drag steps among 10k windows: on a packed grid the only free spot is the window's own
+  // slot, usually far away, so the search widens to the whole grid; with free space between
+  // the columns it stays near the pointer.
+  cgul::RectI result;
+  long long elapsedUs[2] = {0, 0};
+  for (int spacing = 1; spacing <= 2; ++spacing) {
+    cgul::CgulDocument large;
+    large.gridWCells = 1000 * spacing;
+    large.gridHCells = 500;
+    for (uint32_t i = 0; i < 10000; ++i) {
+      large.widgets.push_back(cgul::Widget{i + 1, cgul::WidgetKind::Window,
+                                           cgul::RectI{static_cast<int>(i % 100) * 10 * spacing,
+                                                       static_cast<int>(i / 100) * 5, 9, 4},
+                                           ""});
+    }
+    const auto start = std::chrono::steady_clock::now();
+    int moved = 0;
+    for (int step = 0; step < 100; ++step) {
+      const cgul::RectI desired{static_cast<int>(rng.Next(large.gridWCells - 9)),
+                                static_cast<int>(rng.Next(496)), 9, 4};
+      if (!cgul::FindNearestFreePlacement(large, 5050, desired, &result, &error)) {
+        PrintFailure("FAIL placement large: " + error);
+        return 1;
+      }
+      moved += result.x != desired.x || result.y != desired.y ? 1 : 0;
+    }
+    elapsedUs[spacing - 1] = std::chrono::duration_cast<std::chrono::microseconds>(
+                                 std::chrono::steady_clock::now() - start)
+                                 .count();
+    if (cgul::FindNearestFreePlacement(large, 99999, result, &result, &error) || moved == 0) {
+      PrintFailure("FAIL placement unknown id");
+      return 1;
+    }
+  }
+
+  std::cout << "PASS placement (100 solves on 10000 windows: packed " << elapsedUs[0]
+            << " us, spaced " << elapsedUs[1] << " us)\n";
+  return 0;
+}
+
+int RunSpatialIndexCheck() {
+  TestRng rng(5050);
+  const cgul::WidgetKind kinds[] = {cgul::WidgetKind::Window, cgul::WidgetKind::Panel,
+                                    cgul::WidgetKind::Label, cgul::WidgetKind::Button};
+  auto randomRect = [&rng]() {
+    return cgul::RectI{static_cast<int>(rng.Next(90)) - 5, static_cast<int>(rng.Next(50)) - 5,
+                       static_cast<int>(rng.Next(20)), static_cast<int>(rng.Next(10))};
+  };
+
+  // Overlapping widgets edited through the index; every query is checked against a scan of the
+  // document, and hit-tests inside the grid against the composed frame.
+  cgul::CgulDocument doc;
+  doc.gridWCells = 80;
+  doc.gridHCells = 40;
+  cgul::DocumentIndex index(&doc);
+  cgul::WidgetSpatialIndex spatial(&index);
+  std::string error;
+  uint32_t nextId = 1;
+  for (int step = 0; step < 4000; ++step) {
+    const uint32_t action = doc.widgets.empty() ? 0 : rng.Next(10);
+    const uint32_t anyId =
+        doc.widgets.empty() ? 0 : doc.widgets[rng.Next(doc.widgets.size())].id;
+    if (action <= 2) {
+      const cgul::Widget widget{nextId++, kinds[rng.Next(4)], randomRect(), ""};
+      index.Insert(rng.Next(doc.widgets.size() + 1), widget, &error);
+    } else if (action == 3) {
+      index.Remove(anyId);
+    } else if (action == 4) {
+      index.MoveTo(anyId, rng.Next(doc.widgets.size()));
+    } else if (action == 5) {
+      index.SetKind(anyId, kinds[rng.Next(4)]);
+    } else if (action == 6 && step % 500 == 6) {
+      doc.widgets[0].boundsCells = randomRect();
+      index.Rebuild(&error);
+    } else {
+      index.SetBounds(anyId, randomRect());
+    }
+
+    for (int query = 0; query < 8; ++query) {
+      const int x = static_cast<int>(rng.Next(90)) - 5;
+      const int y = static_cast<int>(rng.Next(50)) - 5;
+      uint32_t expectedTop = 0;
+      uint32_t expectedWindow = 0;
+      for (const cgul::Widget& widget : doc.widgets) {
+        const cgul::RectI& b = widget.boundsCells;
+        if (x >= b.x && y >= b.y && x < b.x + b.w && y < b.y + b.h) {
+          expectedTop = widget.id;
+          expectedWindow = widget.kind == cgul::WidgetKind::Window ? widget.id : expectedWindow;
+        }
+      }
+      if (spatial.TopWidgetAt(x, y) != expectedTop ||
+          spatial.TopWidgetAt(x, y, cgul::WidgetKind::Window) != expectedWindow) {
+        PrintFailure("FAIL spatial index hit at step " + std::to_string(step));
+        return 1;
+      }
+    }
+
+    const cgul::RectI area = randomRect();
+    std::vector<uint32_t> expectedIds;
+    for (const cgul::Widget& widget : doc.widgets) {
+      const cgul::RectI& b = widget.boundsCells;
+      if (b.w > 0 && b.h > 0 && area.w > 0 && area.h > 0 && b.x < area.x + area.w &&
+          area.x < b.x + b.w && b.y < area.y + area.h && area.y < b.y + b.h) {
+        expectedIds.push_back(widget.id);
+      }
+    }
+    std::vector<uint32_t> ids;
+    spatial.WidgetsInRect(area, &ids);
+    if (ids != expectedIds) {
+      PrintFailure("FAIL spatial index rect at step " + std::to_string(step));
+      return 1;
+    }
+
+    if (step % 200 == 0) {
+      const cgul::Frame frame = cgul::ComposeLayoutToFrame(doc);
+      for (int y = 0; y < doc.gridHCells; ++y) {
+        for (int x = 0; x < doc.gridWCells; ++x) {
+          if (spatial.TopWidgetAt(x, y) != cgul::hit_test_widget(frame, x, y)) {
+            PrintFailure("FAIL spatial index vs frame at (" + std::to_string(x) + "," +
+                         std::to_string(y) + ")");
+            return 1;
+          }
+        }
+      }
+    }
+  }
+
+  // Hover over a 100k-widget document that was never composed.
+  cgul::CgulDocument large;
+  large.gridWCells = 4000;
+  large.gridHCells = 2500;
+  for (uint32_t i = 0; i < 100000; ++i) {
+    large.widgets.push_back(cgul::Widget{i + 1, kinds[i % 4],
+                                         cgul::RectI{static_cast<int>(rng.Next(3990)),
+                                                     static_cast<int>(rng.Next(2490)), 10, 6},
+                                         ""});
+  }
+  cgul::DocumentIndex largeIndex(&large);
+  cgul::WidgetSpatialIndex largeSpatial(&largeIndex);
+  largeSpatial.TopWidgetAt(0, 0);
+  const auto start = std::chrono::steady_clock::now();
+  uint64_t hits = 0;
+  for (int query = 0; query < 100000; ++query) {
+    hits += largeSpatial.TopWidgetAt(static_cast<int>(rng.Next(4000)),
+                                     static_cast<int>(rng.Next(2500))) != 0
+                ? 1
+                : 0;
+  }
+  const auto elapsedUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+  if (hits == 0) {
+    PrintFailure("FAIL spatial index large: no hits");
+    return 1;
+  }
+
+  std::cout << "PASS spatial index (100000 hit-tests on 100000 widgets in " << elapsedUs
+            << " us)\n";
+  return 0;
+}
+
+int RunGzipCheck() {
+  std::error_code ec;
+  const fs::path path =
+      fs::temp_directory_path(ec) /
+      ("cgul_gzip_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) +
+       ".cgul.gz");
+
+  cgul::CgulDocument doc;
+  doc.gridWCells = 80;
+  doc.gridHCells = 40;
+  doc.meta["name"] = "gzip";
+  for (uint32_t i = 0; i < 64; ++i) {
+    doc.widgets.push_back(cgul::Widget{i + 1, cgul::WidgetKind::Panel,
+                                       cgul::RectI{static_cast<int>(i % 8) * 10,
+                                                   static_cast<int>(i / 8) * 5, 8, 4},
+                                       "Panel"});
+  }
+
+  std::string error;
+  if (!cgul::IsCgulGzipSupported()) {
+    if (cgul::SaveCgulFile(path.string(), doc, &error)) {
+      PrintFailure("FAIL gzip: save succeeded without zlib");
+      fs::remove(path, ec);
+      return 1;
+    }
+    std::cout << "PASS gzip (zlib unavailable, save rejected)\n";
+    return 0;
+  }
+
+  if (!cgul::SaveCgulFile(path.string(), doc, &error)) {
+    PrintFailure("FAIL gzip save: " + error);
+    return 1;
+  }
+
+  std::string text;
+  cgul::SaveCgulToBuffer(doc, &text, &error);
+  std::string compressed;
+  {
+    std::ifstream in(path, std::ios::binary);
+    compressed.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  }
+  if (compressed.size() < 2 || static_cast<unsigned char>(compressed[0]) != 0x1f ||
+      compressed.size() >= text.size()) {
+    PrintFailure("FAIL gzip: output is not gzip-compressed");
+    fs::remove(path, ec);
+    return 1;
+  }
+
+  cgul::CgulDocument loaded;
+  std::string diff;
+  if (!cgul::LoadCgulFile(path.string(), &loaded, &error) || !cgul::Equal(doc, loaded, &diff)) {
+    PrintFailure("FAIL gzip round-trip: " + error + diff);
+    fs::remove(path, ec);
+    return 1;
+  }
+
+  const size_t compressedSize = compressed.size();
+  compressed.resize(compressedSize / 2);
+  if (cgul::LoadCgulFromBuffer(compressed, &loaded, &error)) {
+    PrintFailure("FAIL gzip: truncated input was accepted");
+    fs::remove(path, ec);
+    return 1;
+  }
+
+  fs::remove(path, ec);
+  std::cout << "PASS gzip (" << text.size() << " -> " << compressedSize << " bytes)\n";
+  return 0;
+}
+
+int RunPipeLoadCheck() {
+#if defined(_WIN32)
+  std::cout << "PASS pipe load (skipped on Windows)\n";
+  return 0;
+#else
+  // FIFOs, /dev/stdin and process substitution cannot be mapped; they must still load.
+  std::error_code ec;
+  const fs::path path =
+      fs::temp_directory_path(ec) /
+      ("cgul_fifo_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+  if (::mkfifo(path.c_str(), 0600) != 0) {
+    PrintFailure("FAIL pipe load: mkfifo " + path.string());
+    return 1;
+  }
+
+  cgul::CgulDocument doc;
+  doc.gridWCells = 300;
+  doc.gridHCells = 200;
+  for (uint32_t i = 0; i < 2000; ++i) {
+    doc.widgets.push_back(cgul::Widget{i + 1, cgul::WidgetKind::Label,
+                                       cgul::RectI{static_cast<int>(i % 100) * 3,
+                                                   static_cast<int>(i / 100) * 2, 3, 2},
+                                       "L" + std::to_string(i)});
+  }
+  std::string text;
+  std::string error;
+  cgul::SaveCgulToBuffer(doc, &text, &error);
+  // Larger than one read chunk, so the buffered path has to loop.
+  std::thread writer([&path, &text]() {
+    std::ofstream out(path, std::ios::binary);
+    out.write(text.data(), static_cast<std::streamsize>(text.size()));
+  });
+
+  cgul::CgulDocument loaded;
+  std::string diff;
+  const bool ok = cgul::LoadCgulFile(path.string(), &loaded, &error);
+  if (!ok) {
+    std::ifstream drain(path, std::ios::binary);  // unblocks the writer if the load never opened
+  }
+  writer.join();
+  fs::remove(path, ec);
+  if (!ok || !cgul::Equal(doc, loaded, &diff)) {
+    PrintFailure("FAIL pipe load: " + error + diff);
+    return 1;
+  }
+  std::cout << "PASS pipe load (" << text.size() << " bytes)\n";
+  return 0;
+#endif
+}
+
 }  // namespace
 
 int main() {
-  return RunSmoke();
+  if (RunSmoke() != 0 || RunPainterRegistryCheck() != 0 || RunJsonDomCheck() != 0 ||
+      RunLoadErrorOrderCheck() != 0 || RunJournalCheck() != 0 || RunGzipCheck() != 0 ||
+      RunPipeLoadCheck() != 0 || RunDocumentIndexCheck() != 0 || RunStringPoolCheck() != 0 ||
+      RunPatchCheck() != 0 || RunContentHashCheck() != 0 || RunHistoryCheck() != 0 ||
+      RunSnapshotCheck() != 0 || RunRevisionCheck() != 0 || RunTypedMetaCheck() != 0 ||
+      RunOverlapCheck() != 0 || RunEditValidatorCheck() != 0 || RunCellOccupancyCheck() != 0 ||
+      RunValidateAllCheck() != 0 || RunPlacementCheck() != 0 || RunSpatialIndexCheck() != 0) {
+    return 1;
+  }
+  return RunComposeBatchCheck();
 }
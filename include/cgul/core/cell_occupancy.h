@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "cgul/io/cgul_document.h"
+
+namespace cgul {
+
+// Which widgets a CellOccupancy built from a document marks.
+enum class OccupancyLayer {
+  Windows,
+  AllWidgets,
+};
+
+// One bit per grid cell, rows packed into 64-bit words. Rect queries touch h rows of
+// ceil(w / 64) words each, so "is this free?" costs O(h * w / 64) instead of a test against
+// every placed rectangle. Meant for generators and placement searches; memory is
+// gridW * gridH / 8 bytes.
+class CellOccupancy {
+ public:
+  CellOccupancy() = default;
+  CellOccupancy(int gridWCells, int gridHCells);
+
+  // Marks the cells of every widget in the layer; bounds are clipped to the grid.
+  static CellOccupancy ForDocument(const CgulDocument& doc, OccupancyLayer layer);
+
+  // Resizes to the grid with every cell free.
+  void Reset(int gridWCells, int gridHCells);
+  int width() const { return width_; }
+  int height() const { return height_; }
+
+  // Mark or free the cells of rect, clipped to the grid.
+  void Fill(const RectI& rect);
+  void Clear(const RectI& rect);
+
+  // True if rect lies inside the grid and none of its cells are occupied.
+  bool IsFree(const RectI& rect) const;
+  // Occupied cells inside rect (clipped to the grid).
+  size_t CountOccupied(const RectI& rect) const;
+  size_t occupiedCount() const;
+  // Appends the occupied cells inside rect as horizontal runs (h == 1), row by row.
+  void CollectOccupied(const RectI& rect, std::vector<RectI>* outRuns) const;
+
+  // First x >= minX where cells [x, x + w) of row are all free, or -1.
+  int FindFreeSpan(int row, int minX, int w) const;
+  // Last x <= maxX whose cell in row is free, or -1.
+  int FindLastFreeCell(int row, int maxX) const;
+  // First free w x h rect scanning rows top to bottom, then left to right; false if none.
+  bool FindFreeRect(int w, int h, RectI* outRect) const;
+
+ private:
+  // Half-open cell range [x0, x1) x [y0, y1).
+  struct CellSpan {
+    int x0 = 0;
+    int y0 = 0;
+    int x1 = 0;
+    int y1 = 0;
+  };
+
+  // Clips rect to the grid; false when nothing is left.
+  bool Clip(const RectI& rect, CellSpan* outSpan) const;
+  const uint64_t* Row(int y) const { return bits_.data() + static_cast<size_t>(y) * words_; }
+  uint64_t* Row(int y) { return bits_.data() + static_cast<size_t>(y) * words_; }
+  // First x >= minX of a run of w zero bits in a row of words, or -1.
+  int FindZeroRun(const uint64_t* row, int minX, int w) const;
+
+  int width_ = 0;
+  int height_ = 0;
+  size_t words_ = 0;  // per row
+  std::vector<uint64_t> bits_;
+};
+
+}  // namespace cgul
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+
+#include "cgul/io/cgul_document.h"
+
+namespace cgul {
+
+// Deterministic 64-bit content hashes, stable across runs, platforms and custom-kind
+// registration order (kinds are hashed by name). Documents that are Equal hash the same: the
+// root ignores widget order and meta order. Different hashes prove documents differ; equal
+// hashes make equality overwhelmingly likely but not certain.
+uint64_t HashWidget(const Widget& widget);
+uint64_t HashDocument(const CgulDocument& doc);
+
+// Finishes a document hash from the sum (mod 2^64) of HashWidget over its widgets, for callers
+// that keep that sum up to date incrementally, as DocumentIndex does.
+uint64_t HashDocumentFromWidgetSum(const CgulDocument& doc, uint64_t widgetHashSum);
+
+}  // namespace cgul
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "cgul/core/document_index.h"
+#include "cgul/io/cgul_document.h"
+#include "cgul/io/cgul_journal.h"
+
+namespace cgul {
+
+// An ordered list of edits; the record types and wire framing are the journal's
+// (EncodeJournalRecords/DecodeJournalRecords), so a patch can be appended to a journal or sent
+// to another editor as-is.
+using DocumentPatch = std::vector<JournalRecord>;
+
+// Computes every change that turns `from` into `to`, matching widgets by id with a hash join.
+// Order of the records: version, grid and seed; meta changes by key; widget removals; then,
+// in `to` order, each kept widget's kind/move/resize/retitle changes and the additions. Draw
+// order is restored by reordering only the kept widgets outside one longest run that is
+// already in target order, so a bring-to-front costs one record. Fails if either document
+// has a zero or duplicate widget id.
+bool DiffDocuments(const CgulDocument& from, const CgulDocument& to, DocumentPatch* outPatch,
+                   std::string* outError);
+
+// Replays a patch in order. Stops at the first record that does not apply (for example one
+// that targets a missing widget); `doc` then holds the records before it.
+bool ApplyPatch(CgulDocument* doc, const DocumentPatch& patch, std::string* outError);
+
+}  // namespace cgul
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+
+#include "cgul/core/persistent_document.h"
+
+namespace cgul {
+
+// Undo/redo over PersistentDocument versions, bounded by memory instead of step count.
+// Each version is charged only for the storage it does not share with the version before
+// it, so small edits to a large layout cost a chunk and a chunk list each. When the total
+// exceeds the limit the oldest undo steps are dropped; the current version is always kept.
+class DocumentHistory {
+ public:
+  static constexpr size_t kDefaultMemoryLimit = 8 * 1024 * 1024;
+
+  explicit DocumentHistory(size_t memoryLimitBytes = kDefaultMemoryLimit);
+
+  // Starts over from doc with no undo or redo steps.
+  void Reset(const PersistentDocument& doc);
+  // Makes doc the current version; discards redo steps.
+  void Commit(const PersistentDocument& doc);
+
+  const PersistentDocument& current() const { return versions_[cursor_].doc; }
+
+  bool CanUndo() const { return cursor_ > 0; }
+  bool CanRedo() const { return cursor_ + 1 < versions_.size(); }
+  bool Undo();
+  bool Redo();
+
+  size_t undoCount() const { return cursor_; }
+  size_t redoCount() const { return versions_.size() - cursor_ - 1; }
+  size_t memoryBytes() const { return memoryBytes_; }
+  size_t memoryLimitBytes() const { return memoryLimitBytes_; }
+
+ private:
+  struct Version {
+    PersistentDocument doc;
+    // Bytes not shared with the previous version (the whole version for the oldest one).
+    size_t bytes = 0;
+  };
+
+  void Trim();
+
+  std::deque<Version> versions_;
+  size_t cursor_ = 0;
+  size_t memoryBytes_ = 0;
+  size_t memoryLimitBytes_ = kDefaultMemoryLimit;
+};
+
+}  // namespace cgul
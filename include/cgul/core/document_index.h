@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "cgul/io/cgul_document.h"
+
+namespace cgul {
+
+// Open-addressing hash map from widget id to a position in CgulDocument::widgets. Id 0 marks
+// empty slots, so it cannot be stored (Validate rejects it as well).
+class WidgetIdMap {
+ public:
+  static constexpr size_t kNotFound = static_cast<size_t>(-1);
+
+  void Clear();
+  void Reserve(size_t count);
+  size_t size() const { return size_; }
+
+  // Returns false, leaving the map unchanged, if id is 0 or already present.
+  bool Insert(uint32_t id, size_t position);
+  // Updates the position of an id that is already present.
+  void Update(uint32_t id, size_t position);
+  bool Erase(uint32_t id);
+
+  size_t Find(uint32_t id) const {
+    if (size_ == 0 || id == 0) {
+      return kNotFound;
+    }
+    for (size_t slot = SlotFor(id);; slot = (slot + 1) & mask_) {
+      const Slot& entry = slots_[slot];
+      if (entry.id == id) {
+        return entry.position;
+      }
+      if (entry.id == 0) {
+        return kNotFound;
+      }
+    }
+  }
+
+ private:
+  struct Slot {
+    uint32_t id = 0;
+    uint32_t position = 0;
+  };
+
+  size_t SlotFor(uint32_t id) const {
+    return static_cast<size_t>((uint64_t{id} * 0x9E3779B97F4A7C15ull) >> shift_);
+  }
+  void Rehash(size_t capacity);
+
+  std::vector<Slot> slots_;
+  size_t mask_ = 0;
+  unsigned shift_ = 64;
+  size_t size_ = 0;
+};
+
+// What changed in a document after a given revision (see DocumentIndex::ChangedSince).
+struct DocumentChanges {
+  // Ids added, edited or moved in draw order, sorted ascending.
+  std::vector<uint32_t> changed;
+  // Ids removed and not re-added, sorted ascending.
+  std::vector<uint32_t> removed;
+  // Grid, seed, version or meta changed.
+  bool headerChanged = false;
+};
+
+// Keeps an id -> position index over a document's widgets. Edits made through the mutation
+// API keep the index (and the cached content hash) valid; after editing doc.widgets directly
+// (or replacing the document), call Rebuild. Lookups are O(1); Insert/Remove/MoveTo also shift
+// the widgets between the old and new positions, as the vector does. Widget pointers are
+// invalidated by Add, Insert and Remove, like any pointer into the vector.
+//
+// Every mutation also bumps revision(), so caches keyed on a revision know when to refresh
+// and ChangedSince tells them what to refresh.
+class DocumentIndex {
+ public:
+  static constexpr size_t kNotFound = WidgetIdMap::kNotFound;
+
+  DocumentIndex() = default;
+  // Indexes doc; duplicate or zero ids leave the later widget unindexed (see Rebuild).
+  explicit DocumentIndex(CgulDocument* doc);
+
+  // Points the index at doc and rebuilds it.
+  bool Reset(CgulDocument* doc, std::string* outError);
+  // Re-indexes every widget. Fails on a zero or duplicate id; the index then covers the first
+  // occurrence of each id. Counts as a change to everything.
+  bool Rebuild(std::string* outError);
+
+  CgulDocument* document() const { return doc_; }
+
+  bool Contains(uint32_t id) const { return ids_.Find(id) != kNotFound; }
+  size_t IndexOf(uint32_t id) const { return ids_.Find(id); }
+  const Widget* Find(uint32_t id) const;
+
+  // Appends (or, for Insert, places at position, clamped to the end) a widget with a new id.
+  bool Add(const Widget& widget, std::string* outError);
+  bool Insert(size_t position, const Widget& widget, std::string* outError);
+  bool Remove(uint32_t id);
+  // Moves a widget to a new position in draw order (the end is the top).
+  bool MoveTo(uint32_t id, size_t position);
+  // Field edits; each returns false if id is not indexed.
+  bool SetBounds(uint32_t id, const RectI& boundsCells);
+  bool SetTitle(uint32_t id, const std::string& title);
+  bool SetKind(uint32_t id, WidgetKind kind);
+
+  // Document header edits.
+  void SetGrid(int gridWCells, int gridHCells);
+  void SetSeed(uint64_t seed);
+  void SetVersion(const std::string& cgulVersion);
+  void SetMeta(const std::string& key, const MetaValue& value);
+  bool EraseMeta(const std::string& key);
+
+  // HashDocument of the indexed document. Widget hashes are summed once and then updated per
+  // edit, so after the first call only the grid/meta root is recomputed.
+  uint64_t ContentHash() const;
+
+  // Increases with every mutation made through the index.
+  uint64_t revision() const { return revision_; }
+  // Revision of the widget's last change (added, edited or moved), or 0 if it is not indexed.
+  uint64_t WidgetRevision(uint32_t id) const;
+  uint64_t headerRevision() const { return headerRevision_; }
+  // Fills outChanges with everything changed after `revision` (a value of revision() saved
+  // earlier). Returns false, leaving outChanges empty, when that revision is older than the
+  // retained change history (e.g. before a Rebuild); the caller should then refresh fully.
+  bool ChangedSince(uint64_t revision, DocumentChanges* outChanges) const;
+
+ private:
+  struct Change {
+    uint64_t revision = 0;
+    uint32_t id = 0;
+  };
+
+  void Reindex(size_t first, size_t last);
+  void ForgetWidgetHash(const Widget& widget);
+  void RememberWidgetHash(const Widget& widget);
+  // Bumps the revision and records that the widget at position (or, for removals, id) changed.
+  void RecordChange(size_t position);
+  void RecordRemoval(uint32_t id);
+  void CompactChanges();
+
+  CgulDocument* doc_ = nullptr;
+  WidgetIdMap ids_;
+  mutable uint64_t widgetHashSum_ = 0;
+  mutable bool widgetHashValid_ = false;
+
+  uint64_t revision_ = 0;
+  uint64_t headerRevision_ = 0;
+  // Queries for revisions before this cannot be answered from changes_.
+  uint64_t changesFloor_ = 0;
+  // Parallel to doc_->widgets.
+  std::vector<uint64_t> widgetRevisions_;
+  // Ordered by revision.
+  std::vector<Change> changes_;
+};
+
+}  // namespace cgul
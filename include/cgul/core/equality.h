@@ -6,8 +6,13 @@
 
 namespace cgul {
 
+class DocumentIndex;
+
 bool Equal(const RectI& a, const RectI& b);
 bool Equal(const Widget& a, const Widget& b);
 bool Equal(const CgulDocument& a, const CgulDocument& b, std::string* outDiff);
+// Same result as Equal on the indexed documents. When no diff text is wanted, differing
+// cached content hashes settle inequality without walking the widgets.
+bool Equal(const DocumentIndex& a, const DocumentIndex& b, std::string* outDiff);
 
 }  // namespace cgul
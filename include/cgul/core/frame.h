@@ -34,6 +34,8 @@ struct Frame {
   const Cell& at(int x, int y) const;
 
   void clear(char32_t glyph = U' ');
+  // Changes dimensions without releasing cell storage; cell contents are unspecified.
+  void resize(int w, int h);
 };
 
 void draw_box(Frame& f, int x0, int y0, int x1, int y1, uint32_t widgetId);
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cgul/core/string_pool.h"
+#include "cgul/io/cgul_document.h"
+
+namespace cgul {
+
+struct InternedWidget {
+  uint32_t id = 0;
+  WidgetKind kind = WidgetKind::Panel;
+  RectI boundsCells;
+  StringHandle title;
+};
+
+// Compact form of CgulDocument for holding many documents at once: titles and meta keys are
+// handles into a shared StringPool, so strings that repeat across documents are stored once.
+// Meta values stay per-document. Meta entries are sorted by key text, as in CgulDocument.
+struct InternedDocument {
+  StringHandle cgulVersion;
+  int gridWCells = 0;
+  int gridHCells = 0;
+  uint64_t seed = 0;
+  std::vector<InternedWidget> widgets;
+  std::vector<std::pair<StringHandle, MetaValue>> meta;
+};
+
+void InternDocument(const CgulDocument& doc, StringPool* pool, InternedDocument* outDoc);
+void ExpandDocument(const InternedDocument& doc, const StringPool& pool, CgulDocument* outDoc);
+
+// Same result as Equal on the expanded documents (widgets matched by id, order ignored), but
+// strings compare by handle. Both documents must come from the same pool.
+bool Equal(const InternedDocument& a, const InternedDocument& b);
+
+}  // namespace cgul
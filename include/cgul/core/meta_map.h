@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace cgul {
+
+enum class MetaType : uint8_t {
+  String = 0,
+  Int = 1,
+  Bool = 2,
+  Float = 3,
+};
+
+const char* ToString(MetaType type);
+
+// One document meta value. Strings convert implicitly so `doc.meta["k"] = "v"` keeps working;
+// typed values are stored natively and round-trip exactly through .cgul, .cgulb and journals.
+class MetaValue {
+ public:
+  MetaValue() = default;
+  MetaValue(std::string text) : text_(std::move(text)) {}
+  MetaValue(const char* text) : text_(text) {}
+
+  static MetaValue FromInt(int64_t value);
+  static MetaValue FromBool(bool value);
+  // Non-finite values fit .cgulb and journals but not .cgul text, which refuses to save them.
+  static MetaValue FromFloat(double value);
+  // Rebuilds a non-string value from scalarBits().
+  static MetaValue FromScalarBits(MetaType type, uint64_t bits);
+
+  MetaType type() const { return type_; }
+  bool isString() const { return type_ == MetaType::String; }
+
+  // Each accessor returns a default (empty, 0, false, 0.0) for values of another type.
+  const std::string& text() const { return text_; }
+  int64_t intValue() const;
+  bool boolValue() const;
+  double floatValue() const;
+
+  // Raw payload of a non-string value: two's complement, 0/1 or the IEEE-754 bit pattern.
+  uint64_t scalarBits() const { return bits_; }
+
+  // Floats compare by bit pattern, so a value always equals its own round trip.
+  friend bool operator==(const MetaValue& a, const MetaValue& b) {
+    return a.type_ == b.type_ && a.bits_ == b.bits_ && a.text_ == b.text_;
+  }
+  friend bool operator!=(const MetaValue& a, const MetaValue& b) { return !(a == b); }
+
+ private:
+  MetaType type_ = MetaType::String;
+  uint64_t bits_ = 0;
+  std::string text_;
+};
+
+// For messages: a string in double quotes (not escaped); other values as written in .cgul,
+// with floats in the shortest form that reads back to the same double, always with a '.' or an
+// exponent so they read back as floats.
+std::string ToString(const MetaValue& value);
+
+// Document meta: entries sorted by key in a flat vector. Meta is small and read far more often
+// than written, so lookups are a binary search over contiguous memory and iteration order
+// matches the former std::map.
+class MetaMap {
+ public:
+  using value_type = std::pair<std::string, MetaValue>;
+  using const_iterator = std::vector<value_type>::const_iterator;
+
+  bool empty() const { return entries_.empty(); }
+  size_t size() const { return entries_.size(); }
+  void clear() { entries_.clear(); }
+  void reserve(size_t count) { entries_.reserve(count); }
+
+  const_iterator begin() const { return entries_.begin(); }
+  const_iterator end() const { return entries_.end(); }
+
+  const_iterator find(std::string_view key) const;
+  size_t count(std::string_view key) const { return find(key) != end() ? 1 : 0; }
+  // Inserts an empty string value when the key is missing.
+  MetaValue& operator[](std::string_view key);
+  void Set(std::string_view key, MetaValue value) { (*this)[key] = std::move(value); }
+  size_t erase(std::string_view key);
+
+  // Replaces the contents; entries may arrive in any order but keys must be unique.
+  void Assign(std::vector<value_type> entries);
+
+  // Typed reads. Each returns false, leaving *out untouched, when the key is missing or holds
+  // another type; GetFloat also accepts integers.
+  const MetaValue* Find(std::string_view key) const;
+  bool GetString(std::string_view key, std::string* out) const;
+  bool GetInt(std::string_view key, int64_t* out) const;
+  bool GetBool(std::string_view key, bool* out) const;
+  bool GetFloat(std::string_view key, double* out) const;
+
+  friend bool operator==(const MetaMap& a, const MetaMap& b) { return a.entries_ == b.entries_; }
+  friend bool operator!=(const MetaMap& a, const MetaMap& b) { return !(a == b); }
+
+ private:
+  std::vector<value_type>::iterator LowerBound(std::string_view key);
+
+  std::vector<value_type> entries_;
+};
+
+}  // namespace cgul
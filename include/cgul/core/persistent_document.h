@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cgul/io/cgul_document.h"
+
+namespace cgul {
+
+// Immutable document version. Widgets live in chunks of up to kChunkWidgets, shared between
+// versions: an edit copies the chunk it touches plus the small chunk list and shares
+// everything else, so keeping many versions of a large layout costs little more than one.
+// Copying a PersistentDocument is cheap and copies share all storage.
+class PersistentDocument {
+ public:
+  static constexpr size_t kChunkWidgets = 64;
+  static constexpr size_t kNotFound = static_cast<size_t>(-1);
+
+  PersistentDocument();
+  static PersistentDocument FromDocument(const CgulDocument& doc);
+  CgulDocument ToDocument() const;
+
+  const std::string& cgulVersion() const { return header_->cgulVersion; }
+  int gridWCells() const { return header_->gridWCells; }
+  int gridHCells() const { return header_->gridHCells; }
+  uint64_t seed() const { return header_->seed; }
+  const MetaMap& meta() const { return header_->meta; }
+
+  size_t widgetCount() const { return chunks_.empty() ? 0 : chunks_.back().end; }
+  const Widget& widget(size_t position) const;
+  // Position of the widget with this id, or kNotFound. Linear in the widget count.
+  size_t PositionOf(uint32_t id) const;
+
+  // Each edit returns a new version and leaves this one unchanged. Positions are draw order;
+  // insert positions past the end append. Invalid positions return an unchanged copy.
+  PersistentDocument WithWidget(size_t position, const Widget& widget) const;
+  PersistentDocument WithWidgetInserted(size_t position, const Widget& widget) const;
+  PersistentDocument WithWidgetRemoved(size_t position) const;
+  PersistentDocument WithWidgetMoved(size_t from, size_t to) const;
+  PersistentDocument WithGrid(int gridWCells, int gridHCells) const;
+  PersistentDocument WithSeed(uint64_t seed) const;
+  PersistentDocument WithMeta(const std::string& key, const MetaValue& value) const;
+  PersistentDocument WithoutMeta(const std::string& key) const;
+
+  // Approximate heap bytes of this version, and the part of it not shared with base.
+  size_t MemoryBytes() const;
+  size_t BytesNotSharedWith(const PersistentDocument& base) const;
+
+ private:
+  struct Header {
+    std::string cgulVersion = "0.1";
+    int gridWCells = 0;
+    int gridHCells = 0;
+    uint64_t seed = 0;
+    MetaMap meta;
+  };
+  using Chunk = std::vector<Widget>;
+  struct ChunkRef {
+    std::shared_ptr<const Chunk> widgets;
+    // Widget count up to and including this chunk.
+    size_t end = 0;
+  };
+
+  static size_t ChunkBytes(const Chunk& chunk);
+  static size_t HeaderBytes(const Header& header);
+
+  size_t ChunkFor(size_t position) const;
+  Header* MutableHeader();
+
+  std::shared_ptr<const Header> header_;
+  std::vector<ChunkRef> chunks_;
+};
+
+}  // namespace cgul
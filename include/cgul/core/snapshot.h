@@ -0,0 +1,159 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace cgul {
+
+// Publishes immutable versions of a value (a CgulDocument, a Frame, ...) from writer threads to
+// reader threads, RCU style. Readers pin the current version with Read() and never wait for
+// writers; writers never wait for readers. A replaced version is retired and freed by a later
+// Publish or Reclaim once every reader that might still see it has released its guard
+// (epoch-based reclamation). Writers are serialized among themselves.
+//
+// Each live ReadGuard occupies one of kMaxReaders slots; Read yields until a slot frees up if
+// all are taken. Keep guards short-lived unless holding an old version alive is intended, as
+// a long export does.
+template <typename T>
+class Snapshot {
+ public:
+  static constexpr size_t kMaxReaders = 64;
+
+  class ReadGuard {
+   public:
+    ReadGuard() = default;
+    ReadGuard(ReadGuard&& other) noexcept : value_(other.value_), epoch_(other.epoch_) {
+      other.value_ = nullptr;
+      other.epoch_ = nullptr;
+    }
+    ReadGuard& operator=(ReadGuard&& other) noexcept {
+      if (this != &other) {
+        Release();
+        value_ = other.value_;
+        epoch_ = other.epoch_;
+        other.value_ = nullptr;
+        other.epoch_ = nullptr;
+      }
+      return *this;
+    }
+    ReadGuard(const ReadGuard&) = delete;
+    ReadGuard& operator=(const ReadGuard&) = delete;
+    ~ReadGuard() { Release(); }
+
+    const T& operator*() const { return *value_; }
+    const T* operator->() const { return value_; }
+    const T* get() const { return value_; }
+
+    // Unpins the version early; the guard is empty afterwards.
+    void Release() {
+      if (epoch_ != nullptr) {
+        epoch_->store(0);
+        epoch_ = nullptr;
+      }
+      value_ = nullptr;
+    }
+
+   private:
+    friend class Snapshot;
+    ReadGuard(const T* value, std::atomic<uint64_t>* epoch) : value_(value), epoch_(epoch) {}
+
+    const T* value_ = nullptr;
+    std::atomic<uint64_t>* epoch_ = nullptr;
+  };
+
+  Snapshot() : Snapshot(T{}) {}
+  explicit Snapshot(T initial) : current_(new T(std::move(initial))) {}
+  // No ReadGuard may outlive the snapshot.
+  ~Snapshot() {
+    delete current_.load();
+    for (const Retired& retired : retired_) {
+      delete retired.value;
+    }
+  }
+
+  Snapshot(const Snapshot&) = delete;
+  Snapshot& operator=(const Snapshot&) = delete;
+
+  ReadGuard Read() const {
+    const size_t start = std::hash<std::thread::id>()(std::this_thread::get_id());
+    for (size_t attempt = 0;; ++attempt) {
+      Slot& slot = slots_[(start + attempt) % kMaxReaders];
+      // Announce the epoch before loading the pointer: a version retired at or after this
+      // epoch stays alive until the slot is cleared.
+      uint64_t expected = 0;
+      if (slot.epoch.compare_exchange_strong(expected, epoch_.load())) {
+        return ReadGuard(current_.load(), &slot.epoch);
+      }
+      if (attempt % kMaxReaders == kMaxReaders - 1) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  void Publish(T value) { Publish(std::make_unique<const T>(std::move(value))); }
+  void Publish(std::unique_ptr<const T> value) {
+    std::lock_guard<std::mutex> lock(writerMutex_);
+    const T* previous = current_.exchange(value.release());
+    retired_.push_back(Retired{previous, epoch_.fetch_add(1)});
+    ReclaimLocked();
+  }
+
+  // Frees retired versions no reader can still hold and returns how many remain retired.
+  size_t Reclaim() {
+    std::lock_guard<std::mutex> lock(writerMutex_);
+    return ReclaimLocked();
+  }
+
+  // Number of versions published since construction.
+  uint64_t version() const { return epoch_.load() - 1; }
+
+ private:
+  // One cache line per reader slot so readers on different cores do not contend.
+  struct alignas(64) Slot {
+    std::atomic<uint64_t> epoch{0};  // 0 = free
+  };
+  struct Retired {
+    const T* value = nullptr;
+    uint64_t epoch = 0;  // epoch during which it was replaced
+  };
+
+  size_t ReclaimLocked() {
+    uint64_t oldestReader = UINT64_MAX;
+    for (const Slot& slot : slots_) {
+      const uint64_t epoch = slot.epoch.load();
+      if (epoch != 0) {
+        oldestReader = std::min(oldestReader, epoch);
+      }
+    }
+    // A reader that announced a later epoch than the one a version was retired in loaded the
+    // pointer after the swap, so it cannot hold that version.
+    const auto reclaimable = [oldestReader](const Retired& retired) {
+      return retired.epoch < oldestReader;
+    };
+    for (const Retired& retired : retired_) {
+      if (reclaimable(retired)) {
+        delete retired.value;
+      }
+    }
+    retired_.erase(std::remove_if(retired_.begin(), retired_.end(), reclaimable),
+                   retired_.end());
+    return retired_.size();
+  }
+
+  std::atomic<const T*> current_;
+  std::atomic<uint64_t> epoch_{1};
+  mutable std::array<Slot, kMaxReaders> slots_;
+  std::mutex writerMutex_;
+  std::vector<Retired> retired_;
+};
+
+}  // namespace cgul
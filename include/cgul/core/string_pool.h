@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace cgul {
+
+// Handle to a string interned in a StringPool. Within one pool, equal handles mean equal
+// strings and vice versa. The default handle is the empty string.
+struct StringHandle {
+  uint32_t value = 0;
+
+  friend bool operator==(StringHandle a, StringHandle b) { return a.value == b.value; }
+  friend bool operator!=(StringHandle a, StringHandle b) { return a.value != b.value; }
+};
+
+// Append-only set of strings with stable storage: views returned by View stay valid for the
+// pool's lifetime. Like RegisterWidgetKind, the pool is not synchronized; intern from one
+// thread (or under the caller's lock) and share the pool read-only afterwards.
+class StringPool {
+ public:
+  StringPool();
+  StringPool(const StringPool&) = delete;
+  StringPool& operator=(const StringPool&) = delete;
+
+  StringHandle Intern(std::string_view text);
+  // Looks up text without adding it.
+  bool Find(std::string_view text, StringHandle* outHandle) const;
+  std::string_view View(StringHandle handle) const { return strings_[handle.value]; }
+
+  // Distinct strings, including the empty string.
+  size_t size() const { return strings_.size(); }
+  // Characters held in the pool's storage blocks.
+  size_t bytes() const { return bytes_; }
+
+ private:
+  const char* Store(std::string_view text);
+
+  std::vector<std::string_view> strings_;
+  std::unordered_map<std::string_view, uint32_t> handles_;
+  std::vector<std::unique_ptr<char[]>> blocks_;
+  // Free space at the end of the current shared block.
+  char* cursor_ = nullptr;
+  size_t remaining_ = 0;
+  size_t bytes_ = 0;
+};
+
+}  // namespace cgul
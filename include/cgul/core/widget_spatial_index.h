@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "cgul/core/document_index.h"
+#include "cgul/io/cgul_document.h"
+
+namespace cgul {
+
+// R-tree over the widget bounds of a document edited through a DocumentIndex, for hit-testing
+// and rect queries straight from the document, before (or without) composing a frame.
+//
+// The tree is bulk-loaded with Sort-Tile-Recursive packing, 16 entries per node. Edits reported
+// by DocumentIndex::ChangedSince are applied incrementally: a removed or edited widget's tree
+// entry is tombstoned, and its new bounds go to a small unsorted overflow list that queries scan
+// as well. The tree is repacked once the overflow or the tombstones grow past a fraction of the
+// widget count, when the change history is gone, or when most widgets changed at once.
+//
+// Draw order is read from the DocumentIndex at query time, so reordering never invalidates the
+// tree; a point query costs O(log n) plus the widgets stacked at that cell.
+class WidgetSpatialIndex {
+ public:
+  WidgetSpatialIndex() = default;
+  // The index must outlive the spatial index.
+  explicit WidgetSpatialIndex(const DocumentIndex* index);
+
+  void Reset(const DocumentIndex* index);
+
+  // Id of the topmost widget (last in draw order) whose bounds contain the cell, or 0. Matches
+  // hit_test_widget on the composed frame for cells inside the grid. The kind overload only
+  // considers widgets of that kind.
+  uint32_t TopWidgetAt(int cellX, int cellY);
+  uint32_t TopWidgetAt(int cellX, int cellY, WidgetKind kind);
+  // Replaces outIds with every widget whose bounds overlap rect, in draw order.
+  void WidgetsInRect(const RectI& rect, std::vector<uint32_t>* outIds);
+
+ private:
+  // Half-open box [x0, x1) x [y0, y1).
+  struct Box {
+    int64_t x0 = 0;
+    int64_t y0 = 0;
+    int64_t x1 = 0;
+    int64_t y1 = 0;
+  };
+
+  struct Entry {
+    Box box;
+    uint32_t id = 0;  // 0 once tombstoned
+    WidgetKind kind = WidgetKind::Window;
+  };
+
+  // Children are nodes_[first, first + count) or, for a leaf, entries_[first, first + count).
+  struct Node {
+    Box box;
+    uint32_t first = 0;
+    uint32_t count = 0;
+    bool leaf = false;
+  };
+
+  static Box BoxOf(const RectI& rect);
+  static bool Overlaps(const Box& a, const Box& b) {
+    return a.x0 < b.x1 && b.x0 < a.x1 && a.y0 < b.y1 && b.y0 < a.y1;
+  }
+
+  void Refresh();
+  void Rebuild();
+  void AddPending(const Widget& widget);
+  void RemoveEntry(uint32_t id);
+  // Calls visit(entry) for every live entry whose box overlaps query.
+  template <typename Visit>
+  void ForEachOverlapping(const Box& query, Visit&& visit);
+  // kind may be null for any kind.
+  uint32_t TopAt(int cellX, int cellY, const WidgetKind* kind);
+
+  const DocumentIndex* index_ = nullptr;
+  bool built_ = false;
+  uint64_t revision_ = 0;
+  // Tree entries in leaf order, followed by the overflow list.
+  std::vector<Entry> entries_;
+  size_t treeEntries_ = 0;
+  size_t tombstones_ = 0;
+  // Bottom level first; the root is the last node.
+  std::vector<Node> nodes_;
+  // Id -> position in entries_.
+  WidgetIdMap slots_;
+  std::vector<uint32_t> stack_;  // traversal scratch
+};
+
+}  // namespace cgul
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "cgul/io/cgul_document.h"
+
+namespace cgul {
+
+// Binary companion to .cgul for fast startup loads (layout in docs/format_cgulb.md). Text
+// .cgul stays the interchange format; .cgulb files are derived from it and round-trip
+// exactly. Widget kinds are stored by name, so custom kinds must be registered before load.
+bool SaveCgulBinaryToBuffer(const CgulDocument& doc, std::string* outBytes, std::string* outError);
+bool LoadCgulBinaryFromBuffer(std::string_view bytes, CgulDocument* outDoc, std::string* outError);
+
+bool SaveCgulBinaryFile(const std::string& path, const CgulDocument& doc, std::string* outError);
+bool SaveCgulBinaryFile(const std::string& path, const CgulDocument& doc,
+                        const CgulSaveOptions& options, std::string* outError);
+bool LoadCgulBinaryFile(const std::string& path, CgulDocument* outDoc, std::string* outError);
+
+struct CgulBinaryWidget {
+  uint32_t id = 0;
+  WidgetKind kind = WidgetKind::Panel;
+  RectI boundsCells;
+  std::string_view title;
+};
+
+struct CgulBinaryMeta {
+  std::string_view key;
+  MetaType type = MetaType::String;
+  std::string_view text;    // String values
+  uint64_t scalarBits = 0;  // other types; see MetaValue::scalarBits
+};
+
+// Zero-copy access to a .cgulb document. Open/Attach validate every offset and kind once;
+// accessors then read records in place without allocating. Views into strings stay valid
+// until the view is closed or reopened (and, for Attach, while the caller's buffer lives).
+class CgulBinaryView {
+ public:
+  CgulBinaryView();
+  ~CgulBinaryView();
+  CgulBinaryView(CgulBinaryView&& other) noexcept;
+  CgulBinaryView& operator=(CgulBinaryView&& other) noexcept;
+
+  // Maps the file read-only.
+  bool Open(const std::string& path, std::string* outError);
+  bool Attach(std::string_view bytes, std::string* outError);
+  void Close();
+
+  std::string_view cgulVersion() const { return cgulVersion_; }
+  int gridWCells() const { return gridWCells_; }
+  int gridHCells() const { return gridHCells_; }
+  uint64_t seed() const { return seed_; }
+
+  size_t widgetCount() const { return widgetCount_; }
+  CgulBinaryWidget widget(size_t index) const;
+
+  size_t metaCount() const { return metaCount_; }
+  CgulBinaryMeta meta(size_t index) const;
+
+  // Copies the document out; the only step that allocates per widget.
+  void ToDocument(CgulDocument* outDoc) const;
+
+ private:
+  struct Mapping;
+
+  std::string_view StringAt(const char* ref) const;
+
+  std::unique_ptr<Mapping> mapping_;
+  std::string_view bytes_;
+  std::string_view strings_;
+  std::string_view cgulVersion_;
+  int gridWCells_ = 0;
+  int gridHCells_ = 0;
+  uint64_t seed_ = 0;
+  const char* widgets_ = nullptr;
+  size_t widgetCount_ = 0;
+  const char* meta_ = nullptr;
+  size_t metaCount_ = 0;
+  size_t metaRecordSize_ = 0;
+  std::vector<WidgetKind> kinds_;
+};
+
+}  // namespace cgul
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "cgul/io/cgul_document.h"
+
+namespace cgul {
+
+struct CgulDirectoryOptions {
+  unsigned threadCount = 0;  // 0 = hardware concurrency
+  bool recursive = false;
+  // Run Validate on every document that loads.
+  bool validate = true;
+  // Also pick up binary .cgulb files; .cgul and .cgul.gz are always included.
+  bool includeBinary = true;
+  // Release each document once it is loaded and validated, keeping only its status. Use this
+  // to check corpora that do not fit in memory.
+  bool keepDocuments = true;
+};
+
+enum class CgulFileStatus {
+  Ok,
+  LoadFailed,
+  ValidationFailed,
+};
+
+struct CgulDirectoryEntry {
+  std::string path;
+  uint64_t fileBytes = 0;  // 0 if the size could not be read
+  CgulFileStatus status = CgulFileStatus::Ok;
+  std::string error;
+  double loadMs = 0.0;  // load plus validation
+  CgulDocument doc;
+};
+
+struct CgulDirectoryReport {
+  unsigned threadCount = 0;
+  size_t fileCount = 0;
+  size_t failedCount = 0;
+  uint64_t totalBytes = 0;  // on disk, so compressed size for .cgul.gz
+  double wallMs = 0.0;
+  double megabytesPerSecond = 0.0;
+  double documentsPerSecond = 0.0;
+};
+
+// Finds every .cgul/.cgul.gz (and optionally .cgulb) file under `path`, then loads and
+// validates them on a worker pool. Entries come back sorted by path whatever the thread count,
+// with per-file failures recorded in the entry rather than aborting the run. Returns false
+// only if the directory cannot be listed. outReport may be null.
+bool LoadCgulDirectory(const std::string& path, const CgulDirectoryOptions& options,
+                       std::vector<CgulDirectoryEntry>* outEntries, CgulDirectoryReport* outReport,
+                       std::string* outError);
+
+}  // namespace cgul
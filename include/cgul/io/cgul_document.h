@@ -1,10 +1,12 @@
 #pragma once
 
 #include <cstdint>
-#include <map>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "cgul/core/meta_map.h"
+
 namespace cgul {
 
 struct RectI {
@@ -14,13 +16,16 @@ struct RectI {
   int h = 0;
 };
 
-enum class WidgetKind {
+enum class WidgetKind : uint16_t {
   Window,
   Panel,
   Label,
   Button,
 };
 
+// Kinds at or above this value are registered at runtime through RegisterWidgetKind.
+constexpr uint16_t kFirstCustomWidgetKind = 0x100;
+
 struct Widget {
   uint32_t id = 0;
   WidgetKind kind = WidgetKind::Panel;
@@ -34,13 +39,50 @@ struct CgulDocument {
   int gridHCells = 0;
   uint64_t seed = 0;
   std::vector<Widget> widgets;
-  std::map<std::string, std::string> meta;
+  MetaMap meta;
 };
 
 const char* ToString(WidgetKind kind);
 bool ParseWidgetKind(const std::string& text, WidgetKind* outKind);
+bool IsBuiltinWidgetKind(WidgetKind kind);
+
+// Registers a custom widget kind name so documents can load and save it. Names may not
+// contain quotes, backslashes or control characters. Registering an existing custom name
+// returns the kind assigned earlier. Registration is not synchronized
+// with lookups: register custom kinds at startup, before documents are loaded or composed
+// on other threads.
+bool RegisterWidgetKind(const std::string& name, WidgetKind* outKind, std::string* outError);
+
+enum class CgulCompression {
+  // Gzip when the path ends in ".gz", plain text otherwise.
+  Auto,
+  None,
+  Gzip,
+};
 
+struct CgulSaveOptions {
+  // Write to a temporary file in the same directory and rename it over the destination, so
+  // a crash or a concurrent reader never sees a partially written document.
+  bool atomicReplace = true;
+  // Flush the file (and the rename) to stable storage before returning.
+  bool fsync = false;
+  CgulCompression compression = CgulCompression::Auto;
+};
+
+// Whether this build can read and write gzip-compressed .cgul (CGUL_WITH_ZLIB).
+bool IsCgulGzipSupported();
+
+// Uses the default CgulSaveOptions: atomic replace without fsync.
 bool SaveCgulFile(const std::string& path, const CgulDocument& doc, std::string* outError);
+bool SaveCgulFile(const std::string& path, const CgulDocument& doc,
+                  const CgulSaveOptions& options, std::string* outError);
+// Reads the file through a read-only memory mapping and parses it in place. Gzip input is
+// recognized by its magic bytes, whatever the extension, and inflated before parsing.
 bool LoadCgulFile(const std::string& path, CgulDocument* outDoc, std::string* outError);
 
+// In-memory variants; the text is byte-identical to what an uncompressed SaveCgulFile writes.
+// LoadCgulFromBuffer also accepts gzip data.
+bool SaveCgulToBuffer(const CgulDocument& doc, std::string* outText, std::string* outError);
+bool LoadCgulFromBuffer(std::string_view text, CgulDocument* outDoc, std::string* outError);
+
 }  // namespace cgul
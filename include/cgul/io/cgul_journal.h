@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "cgul/core/document_index.h"
+#include "cgul/io/cgul_document.h"
+
+namespace cgul {
+
+enum class JournalOp : uint8_t {
+  AddWidget = 1,
+  RemoveWidget = 2,
+  MoveWidget = 3,
+  ResizeWidget = 4,
+  SetMeta = 5,
+  EraseMeta = 6,
+  RetitleWidget = 7,
+  SetWidgetKind = 8,
+  ReorderWidget = 9,
+  SetGrid = 10,
+  SetSeed = 11,
+  SetVersion = 12,
+};
+
+struct JournalRecord {
+  JournalOp op = JournalOp::MoveWidget;
+  // AddWidget: the full widget. Other widget ops use the id plus the fields they change
+  // (x/y for MoveWidget, w/h for ResizeWidget, title, kind).
+  Widget widget;
+  // AddWidget: insert position in doc.widgets; values past the end append.
+  // ReorderWidget: id of the widget to place it directly after, or 0 for the front.
+  uint32_t index = 0;
+  // SetMeta/EraseMeta key and SetMeta value; SetVersion stores the version in `value`.
+  std::string key;
+  MetaValue metaValue;
+  std::string value;
+  int gridWCells = 0;
+  int gridHCells = 0;
+  uint64_t seed = 0;
+};
+
+JournalRecord MakeAddWidgetRecord(const Widget& widget, uint32_t index);
+JournalRecord MakeRemoveWidgetRecord(uint32_t id);
+JournalRecord MakeMoveWidgetRecord(uint32_t id, int x, int y);
+JournalRecord MakeResizeWidgetRecord(uint32_t id, int w, int h);
+JournalRecord MakeSetMetaRecord(const std::string& key, const MetaValue& value);
+JournalRecord MakeEraseMetaRecord(const std::string& key);
+JournalRecord MakeRetitleWidgetRecord(uint32_t id, const std::string& title);
+JournalRecord MakeSetWidgetKindRecord(uint32_t id, WidgetKind kind);
+JournalRecord MakeReorderWidgetRecord(uint32_t id, uint32_t afterId);
+JournalRecord MakeSetGridRecord(int gridWCells, int gridHCells);
+JournalRecord MakeSetSeedRecord(uint64_t seed);
+JournalRecord MakeSetVersionRecord(const std::string& cgulVersion);
+
+// One-line human-readable form, e.g. "move widget 7 to 3,4".
+std::string DescribeJournalRecord(const JournalRecord& record);
+
+// Record framing shared by journal files and patches sent elsewhere: each record is a u32
+// payload length, a u32 checksum and the payload. Decoding rejects any damaged record.
+void EncodeJournalRecords(const std::vector<JournalRecord>& records, std::string* outBytes);
+bool DecodeJournalRecords(std::string_view bytes, std::vector<JournalRecord>* outRecords,
+                          std::string* outError);
+
+// Applies one edit exactly as journal replay does. Fails if the target widget id is missing or
+// an added widget's id is already taken. The DocumentIndex overload keeps the index current
+// and avoids re-indexing the document per record.
+bool ApplyJournalRecord(CgulDocument* doc, const JournalRecord& record, std::string* outError);
+bool ApplyJournalRecord(DocumentIndex* index, const JournalRecord& record,
+                        std::string* outError);
+
+struct CgulJournalOptions {
+  // Compact once the journal exceeds both this size and compactRatio * base file size.
+  uint64_t compactMinBytes = 64 * 1024;
+  double compactRatio = 0.5;
+  // fsync each appended record and each compaction.
+  bool fsync = false;
+};
+
+// Append-only edit log stored next to a .cgul base file (`<base>.journal`). Loading replays
+// the journal over the base; compaction writes a fresh base and empties the journal. The
+// journal header carries a hash of the base it applies to, so a journal left behind by an
+// interrupted compaction is recognized as stale and ignored rather than applied twice. A torn
+// final record from an interrupted append is dropped on open; a damaged record followed by
+// more data fails the open instead.
+class CgulJournal {
+ public:
+  CgulJournal() = default;
+  explicit CgulJournal(const CgulJournalOptions& options) : options_(options) {}
+  ~CgulJournal();
+
+  CgulJournal(const CgulJournal&) = delete;
+  CgulJournal& operator=(const CgulJournal&) = delete;
+
+  static std::string JournalPathFor(const std::string& basePath);
+
+  // Loads the base file and replays its journal into outDoc.
+  bool Open(const std::string& basePath, CgulDocument* outDoc, std::string* outError);
+  // Writes doc as a new base at basePath with an empty journal and keeps it open.
+  bool Create(const std::string& basePath, const CgulDocument& doc, std::string* outError);
+  void Close();
+  bool isOpen() const { return file_ != nullptr; }
+
+  // A failed append truncates the journal back to its last complete record and stays open; if
+  // the truncation fails too the journal is closed and further appends fail.
+  bool Append(const JournalRecord& record, std::string* outError);
+  // Rewrites the base from doc (which must include every appended edit).
+  bool Compact(const CgulDocument& doc, std::string* outError);
+  bool CompactIfNeeded(const CgulDocument& doc, std::string* outError);
+  bool NeedsCompaction() const;
+
+  const std::string& basePath() const { return basePath_; }
+  uint64_t journalBytes() const { return journalBytes_; }
+  uint64_t baseBytes() const { return baseBytes_; }
+
+ private:
+  bool OpenForAppend(std::string* outError);
+
+  CgulJournalOptions options_;
+  std::string basePath_;
+  std::FILE* file_ = nullptr;
+  uint64_t journalBytes_ = 0;
+  uint64_t baseBytes_ = 0;
+};
+
+}  // namespace cgul
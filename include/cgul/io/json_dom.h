@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cgul {
+
+enum class JsonNodeType : uint8_t {
+  Null,
+  Bool,
+  Integer,
+  // A number with a fraction or exponent.
+  Float,
+  String,
+  Object,
+  Array,
+};
+
+// One value in a JsonDocument. Nodes are stored in document order, so the first child of
+// a container is the next node and each later sibling starts at the previous one's `end`.
+struct JsonNode {
+  JsonNodeType type = JsonNodeType::Null;
+  bool boolValue = false;
+  uint32_t childCount = 0;
+  // One past the last node of this value's subtree.
+  uint32_t end = 0;
+  int64_t intValue = 0;
+  double floatValue = 0.0;
+  // Member name when the parent is an object.
+  std::string_view key;
+  // String value.
+  std::string_view text;
+};
+
+// Flat DOM over a JSON buffer using the same grammar as the .cgul reader (numbers with a
+// fraction or exponent become Float nodes, any other number an Integer; duplicate keys
+// rejected). Keys and strings view the input where possible and an internal
+// arena otherwise, so the input must outlive the document. Parsing allocates a fixed
+// number of buffers regardless of input size, and reusing a document reuses them.
+class JsonDocument {
+ public:
+  static constexpr size_t kNoNode = static_cast<size_t>(-1);
+
+  bool Parse(std::string_view text, std::string* outError);
+  void Clear();
+
+  bool empty() const { return nodes_.empty(); }
+  size_t size() const { return nodes_.size(); }
+  const JsonNode& node(size_t index) const { return nodes_[index]; }
+  const JsonNode& root() const { return nodes_.front(); }
+
+  // Returns the index of the member named `key` in the object at `objectIndex`, or kNoNode.
+  size_t Find(size_t objectIndex, std::string_view key) const;
+
+ private:
+  std::vector<JsonNode> nodes_;
+  std::string arena_;
+  std::vector<std::string_view> keyScratch_;
+};
+
+}  // namespace cgul
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include "cgul/core/frame.h"
+#include "cgul/io/cgul_document.h"
+
+namespace cgul {
+
+struct ComposeBatchOptions {
+  unsigned threadCount = 0;  // 0 = hardware concurrency
+};
+
+struct ComposeTiming {
+  size_t documentIndex = 0;
+  unsigned worker = 0;
+  double composeMs = 0.0;
+  double callbackMs = 0.0;
+};
+
+struct ComposeBatchReport {
+  unsigned threadCount = 0;
+  double wallMs = 0.0;
+  std::vector<ComposeTiming> documents;  // indexed by document
+};
+
+// Receives each composed frame. Called concurrently from worker threads; the frame is
+// recycled for the worker's next document once the callback returns. If a callback throws, the
+// remaining documents are skipped and ComposeBatch rethrows the first exception once all
+// workers have stopped; outReport is left untouched.
+using ComposeBatchCallback = std::function<void(size_t documentIndex, const Frame& frame)>;
+
+// Composes every document on a worker pool. Each worker reuses one frame that grows to the
+// largest grid it has seen, so steady-state composition does not reallocate cells.
+void ComposeBatch(const CgulDocument* docs, size_t count, const ComposeBatchCallback& callback,
+                  const ComposeBatchOptions& options, ComposeBatchReport* outReport);
+void ComposeBatch(const std::vector<CgulDocument>& docs, const ComposeBatchCallback& callback,
+                  const ComposeBatchOptions& options, ComposeBatchReport* outReport);
+
+}  // namespace cgul
@@ -7,4 +7,7 @@ namespace cgul {
 
 Frame ComposeLayoutToFrame(const CgulDocument& doc);
 
+// Composes into an existing frame, reusing its cell storage when it is large enough.
+void ComposeLayoutIntoFrame(const CgulDocument& doc, Frame* outFrame);
+
 }  // namespace cgul
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+
+#include "cgul/core/frame.h"
+#include "cgul/io/cgul_document.h"
+
+namespace cgul {
+
+// Draws one widget into the frame. Painters must clip to the frame and must not write
+// outside the widget bounds.
+using WidgetPaintFn = void (*)(Frame& frame, const Widget& widget, void* userData);
+
+struct WidgetPainter {
+  WidgetPaintFn paint = nullptr;
+  void* userData = nullptr;
+  // Writes every in-frame cell of the widget bounds, so the composer may skip any widget
+  // that a later opaque widget fully covers.
+  bool opaque = false;
+};
+
+// Built-in kinds are dispatched statically; only custom kinds go through the registered
+// function table. Custom kinds without a painter fall back to the panel painter.
+bool RegisterWidgetPainter(WidgetKind kind, const WidgetPainter& painter, std::string* outError);
+WidgetPainter GetWidgetPainter(WidgetKind kind);
+
+void PaintWidget(Frame& frame, const Widget& widget);
+
+}  // namespace cgul
@@ -1,11 +1,110 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
+#include "cgul/core/document_index.h"
 #include "cgul/io/cgul_document.h"
 
 namespace cgul {
 
 bool Validate(const CgulDocument& doc, std::string* outError);
 
+enum class ValidationRule {
+  Version,
+  Grid,
+  WidgetId,
+  DuplicateId,
+  Bounds,
+  WindowOverlap,
+};
+
+const char* ToString(ValidationRule rule);
+
+struct ValidationIssue {
+  static constexpr size_t kNoWidget = SIZE_MAX;
+
+  ValidationRule rule = ValidationRule::Version;
+  // Document index and id of the widget, or kNoWidget for version and grid issues. For a
+  // duplicate id the other widget is the first one with that id; for an overlap it is the
+  // later window in document order.
+  size_t widgetIndex = kNoWidget;
+  uint32_t widgetId = 0;
+  size_t otherIndex = kNoWidget;
+  uint32_t otherId = 0;
+  // Same text Validate uses for this violation.
+  std::string message;
+};
+
+struct ValidateAllOptions {
+  unsigned threadCount = 0;  // 0 = hardware concurrency
+  size_t maxIssues = 1000;   // 0 = no limit
+};
+
+struct ValidationReport {
+  unsigned threadCount = 0;
+  std::vector<ValidationIssue> issues;
+  // More than maxIssues violations exist; issues holds the first maxIssues of them.
+  bool truncated = false;
+};
+
+// Checks every rule Validate checks and reports every violation instead of the first. Widget
+// rules run on partitions of the widget list and window overlaps on partitions of the windows,
+// in parallel. Issues are ordered as Validate meets them, whatever the thread count: version,
+// grid, then per widget in document order, then overlapping pairs by (earlier, later) window,
+// so issues[0].message is Validate's error. Bounds are not checked against an invalid grid, and
+// windows with no cells (non-positive size) overlap nothing.
+// Returns true when the document is valid; outReport may be null.
+bool ValidateAll(const CgulDocument& doc, const ValidateAllOptions& options,
+                 ValidationReport* outReport);
+
+// Checks moving or resizing one widget of an otherwise valid document to newBounds: the bounds
+// rules and, for a window, overlap with the other windows. Gives the same verdict and message
+// as Validate on the edited document, without copying it. O(n); EditValidator answers the same
+// question from a spatial index.
+bool ValidateEdit(const CgulDocument& doc, uint32_t widgetId, const RectI& newBounds,
+                  std::string* outError);
+
+// ValidateEdit for repeated checks against a document edited through a DocumentIndex, e.g. on
+// every mouse move of a drag. Windows are bucketed in a uniform grid, so a check only visits
+// windows near the new bounds; the buckets follow edits through DocumentIndex::ChangedSince
+// and are rebuilt when that history is gone or the grid changes.
+class EditValidator {
+ public:
+  EditValidator() = default;
+  // The index must outlive the validator.
+  explicit EditValidator(const DocumentIndex* index);
+
+  void Reset(const DocumentIndex* index);
+  bool ValidateEdit(uint32_t widgetId, const RectI& newBounds, std::string* outError);
+
+ private:
+  struct Bucketed {
+    uint32_t id = 0;
+    RectI bounds;
+  };
+
+  void Refresh();
+  void Rebuild();
+  void AddWindow(uint32_t id, const RectI& bounds);
+  void RemoveWindow(uint32_t id);
+  template <typename Visit>
+  void ForEachBucket(const RectI& bounds, Visit&& visit);
+
+  const DocumentIndex* index_ = nullptr;
+  bool built_ = false;
+  uint64_t revision_ = 0;
+  int gridWCells_ = 0;
+  int gridHCells_ = 0;
+  int64_t bucketCells_ = 1;
+  int bucketsX_ = 0;
+  int bucketsY_ = 0;
+  std::vector<std::vector<Bucketed>> buckets_;
+  // Bounds each window was bucketed with.
+  std::unordered_map<uint32_t, RectI> windows_;
+};
+
 }  // namespace cgul
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+
+namespace cgul {
+namespace detail {
+
+// Little-endian field access for the binary formats. Byte-wise loads and stores keep the
+// encoding independent of host byte order and alignment; compilers fold them into plain
+// moves on little-endian targets.
+inline void StoreU16(char* at, uint16_t value) {
+  at[0] = static_cast<char>(value & 0xFFu);
+  at[1] = static_cast<char>(value >> 8);
+}
+
+inline void StoreU32(char* at, uint32_t value) {
+  for (int i = 0; i < 4; ++i) {
+    at[i] = static_cast<char>((value >> (8 * i)) & 0xFFu);
+  }
+}
+
+inline void StoreU64(char* at, uint64_t value) {
+  for (int i = 0; i < 8; ++i) {
+    at[i] = static_cast<char>((value >> (8 * i)) & 0xFFu);
+  }
+}
+
+inline uint16_t LoadU16(const char* at) {
+  const unsigned char* bytes = reinterpret_cast<const unsigned char*>(at);
+  return static_cast<uint16_t>(bytes[0] | (bytes[1] << 8));
+}
+
+inline uint32_t LoadU32(const char* at) {
+  const unsigned char* bytes = reinterpret_cast<const unsigned char*>(at);
+  return static_cast<uint32_t>(bytes[0]) | (static_cast<uint32_t>(bytes[1]) << 8) |
+         (static_cast<uint32_t>(bytes[2]) << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+inline uint64_t LoadU64(const char* at) {
+  return static_cast<uint64_t>(LoadU32(at)) | (static_cast<uint64_t>(LoadU32(at + 4)) << 32);
+}
+
+inline int32_t LoadI32(const char* at) {
+  return static_cast<int32_t>(LoadU32(at));
+}
+
+}  // namespace detail
+}  // namespace cgul
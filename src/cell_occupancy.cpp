@@ -0,0 +1,252 @@
+#include "cgul/core/cell_occupancy.h"
+
+#include <algorithm>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace cgul {
+
+namespace {
+
+constexpr uint64_t kAllOnes = ~uint64_t{0};
+
+int PopCount64(uint64_t value) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  return static_cast<int>(__popcnt64(value));
+#else
+  return __builtin_popcountll(value);
+#endif
+}
+
+int CountTrailingZeros64(uint64_t value) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  unsigned long index = 0;
+  _BitScanForward64(&index, value);
+  return static_cast<int>(index);
+#else
+  return __builtin_ctzll(value);
+#endif
+}
+
+int CountLeadingZeros64(uint64_t value) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  unsigned long index = 0;
+  _BitScanReverse64(&index, value);
+  return 63 - static_cast<int>(index);
+#else
+  return __builtin_clzll(value);
+#endif
+}
+
+// Bits [lo, hi) of one word, 0 <= lo < hi <= 64.
+uint64_t BitRange(int lo, int hi) {
+  const uint64_t upper = hi == 64 ? kAllOnes : (uint64_t{1} << hi) - 1;
+  return upper & (kAllOnes << lo);
+}
+
+// Calls visit(wordIndex, mask) for each word covering cells [x0, x1) of a row.
+template <typename Visit>
+void ForEachWord(int x0, int x1, Visit&& visit) {
+  const int first = x0 >> 6;
+  const int last = (x1 - 1) >> 6;
+  for (int word = first; word <= last; ++word) {
+    const int lo = word == first ? (x0 & 63) : 0;
+    const int hi = word == last ? ((x1 - 1) & 63) + 1 : 64;
+    visit(static_cast<size_t>(word), BitRange(lo, hi));
+  }
+}
+
+// First bit at or after `from` that is set (or, with invert, clear), or `limit`.
+int NextBit(const uint64_t* row, int from, int limit, bool invert) {
+  if (from >= limit) {
+    return limit;
+  }
+  const int words = (limit + 63) >> 6;
+  int word = from >> 6;
+  uint64_t bits = (invert ? ~row[word] : row[word]) & (kAllOnes << (from & 63));
+  while (bits == 0) {
+    if (++word >= words) {
+      return limit;
+    }
+    bits = invert ? ~row[word] : row[word];
+  }
+  return std::min(limit, word * 64 + CountTrailingZeros64(bits));
+}
+
+// Last bit at or before `from` that is set (or, with invert, clear), or -1.
+int PrevBit(const uint64_t* row, int from, bool invert) {
+  if (from < 0) {
+    return -1;
+  }
+  int word = from >> 6;
+  uint64_t bits = (invert ? ~row[word] : row[word]) & (kAllOnes >> (63 - (from & 63)));
+  while (bits == 0) {
+    if (--word < 0) {
+      return -1;
+    }
+    bits = invert ? ~row[word] : row[word];
+  }
+  return word * 64 + 63 - CountLeadingZeros64(bits);
+}
+
+}  // namespace
+
+CellOccupancy::CellOccupancy(int gridWCells, int gridHCells) { Reset(gridWCells, gridHCells); }
+
+CellOccupancy CellOccupancy::ForDocument(const CgulDocument& doc, OccupancyLayer layer) {
+  CellOccupancy occupancy(doc.gridWCells, doc.gridHCells);
+  for (const Widget& widget : doc.widgets) {
+    if (layer == OccupancyLayer::AllWidgets || widget.kind == WidgetKind::Window) {
+      occupancy.Fill(widget.boundsCells);
+    }
+  }
+  return occupancy;
+}
+
+void CellOccupancy::Reset(int gridWCells, int gridHCells) {
+  width_ = std::max(0, gridWCells);
+  height_ = std::max(0, gridHCells);
+  words_ = (static_cast<size_t>(width_) + 63) / 64;
+  bits_.assign(words_ * static_cast<size_t>(height_), 0);
+}
+
+bool CellOccupancy::Clip(const RectI& rect, CellSpan* outSpan) const {
+  outSpan->x0 = static_cast<int>(std::clamp<int64_t>(rect.x, 0, width_));
+  outSpan->y0 = static_cast<int>(std::clamp<int64_t>(rect.y, 0, height_));
+  outSpan->x1 =
+      static_cast<int>(std::clamp<int64_t>(static_cast<int64_t>(rect.x) + rect.w, 0, width_));
+  outSpan->y1 =
+      static_cast<int>(std::clamp<int64_t>(static_cast<int64_t>(rect.y) + rect.h, 0, height_));
+  return outSpan->x0 < outSpan->x1 && outSpan->y0 < outSpan->y1;
+}
+
+void CellOccupancy::Fill(const RectI& rect) {
+  CellSpan span;
+  if (!Clip(rect, &span)) {
+    return;
+  }
+  for (int y = span.y0; y < span.y1; ++y) {
+    uint64_t* row = Row(y);
+    ForEachWord(span.x0, span.x1, [row](size_t word, uint64_t mask) { row[word] |= mask; });
+  }
+}
+
+void CellOccupancy::Clear(const RectI& rect) {
+  CellSpan span;
+  if (!Clip(rect, &span)) {
+    return;
+  }
+  for (int y = span.y0; y < span.y1; ++y) {
+    uint64_t* row = Row(y);
+    ForEachWord(span.x0, span.x1, [row](size_t word, uint64_t mask) { row[word] &= ~mask; });
+  }
+}
+
+bool CellOccupancy::IsFree(const RectI& rect) const {
+  if (rect.w <= 0 || rect.h <= 0 || rect.x < 0 || rect.y < 0 ||
+      static_cast<int64_t>(rect.x) + rect.w > width_ ||
+      static_cast<int64_t>(rect.y) + rect.h > height_) {
+    return false;
+  }
+  const int x1 = rect.x + rect.w;
+  for (int y = rect.y; y < rect.y + rect.h; ++y) {
+    const uint64_t* row = Row(y);
+    uint64_t hits = 0;
+    ForEachWord(rect.x, x1,
+                [row, &hits](size_t word, uint64_t mask) { hits |= row[word] & mask; });
+    if (hits != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+size_t CellOccupancy::CountOccupied(const RectI& rect) const {
+  CellSpan span;
+  if (!Clip(rect, &span)) {
+    return 0;
+  }
+  size_t count = 0;
+  for (int y = span.y0; y < span.y1; ++y) {
+    const uint64_t* row = Row(y);
+    ForEachWord(span.x0, span.x1, [row, &count](size_t word, uint64_t mask) {
+      count += static_cast<size_t>(PopCount64(row[word] & mask));
+    });
+  }
+  return count;
+}
+
+size_t CellOccupancy::occupiedCount() const {
+  size_t count = 0;
+  for (const uint64_t word : bits_) {
+    count += static_cast<size_t>(PopCount64(word));
+  }
+  return count;
+}
+
+void CellOccupancy::CollectOccupied(const RectI& rect, std::vector<RectI>* outRuns) const {
+  CellSpan span;
+  if (!Clip(rect, &span)) {
+    return;
+  }
+  for (int y = span.y0; y < span.y1; ++y) {
+    const uint64_t* row = Row(y);
+    for (int x = NextBit(row, span.x0, span.x1, false); x < span.x1;) {
+      const int end = NextBit(row, x, span.x1, true);
+      outRuns->push_back(RectI{x, y, end - x, 1});
+      x = NextBit(row, end, span.x1, false);
+    }
+  }
+}
+
+int CellOccupancy::FindZeroRun(const uint64_t* row, int minX, int w) const {
+  for (int x = NextBit(row, std::max(0, minX), width_, true); x + w <= width_;) {
+    const int end = NextBit(row, x, std::min(width_, x + w), false);
+    if (end - x >= w) {
+      return x;
+    }
+    x = NextBit(row, end, width_, true);
+  }
+  return -1;
+}
+
+int CellOccupancy::FindFreeSpan(int row, int minX, int w) const {
+  if (row < 0 || row >= height_ || w <= 0 || w > width_) {
+    return -1;
+  }
+  return FindZeroRun(Row(row), minX, w);
+}
+
+int CellOccupancy::FindLastFreeCell(int row, int maxX) const {
+  if (row < 0 || row >= height_) {
+    return -1;
+  }
+  return PrevBit(Row(row), std::min(maxX, width_ - 1), true);
+}
+
+bool CellOccupancy::FindFreeRect(int w, int h, RectI* outRect) const {
+  if (w <= 0 || h <= 0 || w > width_ || h > height_) {
+    return false;
+  }
+  // OR of the h rows starting at y: a zero bit is a column free in all of them.
+  std::vector<uint64_t> merged(words_);
+  for (int y = 0; y + h <= height_; ++y) {
+    std::copy(Row(y), Row(y) + words_, merged.begin());
+    for (int dy = 1; dy < h; ++dy) {
+      const uint64_t* row = Row(y + dy);
+      for (size_t word = 0; word < words_; ++word) {
+        merged[word] |= row[word];
+      }
+    }
+    const int x = FindZeroRun(merged.data(), 0, w);
+    if (x >= 0) {
+      *outRect = RectI{x, y, w, h};
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace cgul
@@ -0,0 +1,476 @@
+#include "cgul/io/cgul_binary.h"
+
+#include "byte_order.h"
+#include "file_writer.h"
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cgul {
+
+namespace {
+
+constexpr char kMagic[8] = {'C', 'G', 'U', 'L', 'B', 'I', 'N', '\0'};
+// Version 2 adds typed meta records; documents whose meta is all strings are still written as
+// version 1 so older readers keep loading them.
+constexpr uint32_t kFormatVersion = 2;
+constexpr uint32_t kStringMetaFormatVersion = 1;
+
+constexpr size_t kHeaderSize = 80;
+constexpr size_t kWidgetRecordSize = 32;
+constexpr size_t kKindRecordSize = 8;
+constexpr size_t kStringMetaRecordSize = 16;
+constexpr size_t kMetaRecordSize = 24;
+
+// Header field offsets.
+constexpr size_t kOffFormatVersion = 8;
+constexpr size_t kOffHeaderSize = 12;
+constexpr size_t kOffGridW = 16;
+constexpr size_t kOffGridH = 20;
+constexpr size_t kOffSeed = 24;
+constexpr size_t kOffVersionString = 32;
+constexpr size_t kOffWidgetCount = 40;
+constexpr size_t kOffWidgetsOffset = 44;
+constexpr size_t kOffKindCount = 48;
+constexpr size_t kOffKindsOffset = 52;
+constexpr size_t kOffMetaCount = 56;
+constexpr size_t kOffMetaOffset = 60;
+constexpr size_t kOffStringsOffset = 64;
+constexpr size_t kOffStringsSize = 68;
+constexpr size_t kOffFileSize = 72;
+
+using detail::LoadI32;
+using detail::LoadU16;
+using detail::LoadU32;
+using detail::LoadU64;
+using detail::StoreU16;
+using detail::StoreU32;
+using detail::StoreU64;
+
+bool Fail(const std::string& message, std::string* outError) {
+  if (outError != nullptr) {
+    *outError = message;
+  }
+  return false;
+}
+
+bool Invalid(const std::string& reason, std::string* outError) {
+  return Fail("Invalid .cgulb data: " + reason, outError);
+}
+
+// Appends strings to the end of the output buffer, which holds the string table, and returns
+// (offset, length) references relative to the start of the table.
+class StringTableWriter {
+ public:
+  StringTableWriter(std::string* bytes, size_t tableOffset)
+      : bytes_(*bytes), tableOffset_(tableOffset) {}
+
+  std::pair<uint32_t, uint32_t> Add(std::string_view text) {
+    const uint32_t offset = static_cast<uint32_t>(bytes_.size() - tableOffset_);
+    bytes_.append(text.data(), text.size());
+    return {offset, static_cast<uint32_t>(text.size())};
+  }
+
+ private:
+  std::string& bytes_;
+  size_t tableOffset_;
+};
+
+bool CheckSection(std::string_view bytes, uint64_t offset, uint64_t count, uint64_t recordSize,
+                  const char* name, std::string* outError) {
+  if (offset < kHeaderSize || offset > bytes.size() ||
+      count > (bytes.size() - offset) / recordSize) {
+    return Invalid(std::string(name) + " section out of bounds", outError);
+  }
+  return true;
+}
+
+bool CheckStringRef(std::string_view strings, const char* ref, std::string* outError) {
+  const uint32_t offset = LoadU32(ref);
+  const uint32_t length = LoadU32(ref + 4);
+  if (offset > strings.size() || length > strings.size() - offset) {
+    return Invalid("string reference out of bounds", outError);
+  }
+  return true;
+}
+
+}  // namespace
+
+bool SaveCgulBinaryToBuffer(const CgulDocument& doc, std::string* outBytes, std::string* outError) {
+  if (outError != nullptr) {
+    outError->clear();
+  }
+  if (outBytes == nullptr) {
+    return Fail("outBytes must not be null", outError);
+  }
+
+  // Kind table in first-use order; documents use a handful of kinds.
+  std::vector<WidgetKind> kinds;
+  std::vector<uint16_t> kindIndices(doc.widgets.size());
+  uint64_t stringsSize = doc.cgulVersion.size();
+  for (size_t i = 0; i < doc.widgets.size(); ++i) {
+    const WidgetKind kind = doc.widgets[i].kind;
+    size_t index = 0;
+    while (index < kinds.size() && kinds[index] != kind) {
+      ++index;
+    }
+    if (index == kinds.size()) {
+      kinds.push_back(kind);
+      stringsSize += std::strlen(ToString(kind));
+    }
+    kindIndices[i] = static_cast<uint16_t>(index);
+    stringsSize += doc.widgets[i].title.size();
+  }
+  bool typedMeta = false;
+  for (const auto& entry : doc.meta) {
+    stringsSize += entry.first.size() + entry.second.text().size();
+    typedMeta = typedMeta || !entry.second.isString();
+  }
+  const size_t metaRecordSize = typedMeta ? kMetaRecordSize : kStringMetaRecordSize;
+
+  const uint64_t widgetsOffset = kHeaderSize;
+  const uint64_t kindsOffset = widgetsOffset + doc.widgets.size() * kWidgetRecordSize;
+  const uint64_t metaOffset = kindsOffset + kinds.size() * kKindRecordSize;
+  const uint64_t stringsOffset = metaOffset + doc.meta.size() * metaRecordSize;
+  const uint64_t fileSize = stringsOffset + stringsSize;
+  if (fileSize > std::numeric_limits<uint32_t>::max() ||
+      kinds.size() > std::numeric_limits<uint16_t>::max()) {
+    return Fail("Document too large for .cgulb", outError);
+  }
+
+  // Fixed-size sections first, zero-filled; the string table is appended behind them.
+  std::string& bytes = *outBytes;
+  bytes.clear();
+  bytes.reserve(static_cast<size_t>(fileSize));
+  bytes.resize(static_cast<size_t>(stringsOffset), '\0');
+  StringTableWriter table(&bytes, static_cast<size_t>(stringsOffset));
+
+  const auto version = table.Add(doc.cgulVersion);
+  char* header = bytes.data();
+  std::memcpy(header, kMagic, sizeof(kMagic));
+  StoreU32(header + kOffFormatVersion, typedMeta ? kFormatVersion : kStringMetaFormatVersion);
+  StoreU32(header + kOffHeaderSize, kHeaderSize);
+  StoreU32(header + kOffGridW, static_cast<uint32_t>(doc.gridWCells));
+  StoreU32(header + kOffGridH, static_cast<uint32_t>(doc.gridHCells));
+  StoreU64(header + kOffSeed, doc.seed);
+  StoreU32(header + kOffVersionString, version.first);
+  StoreU32(header + kOffVersionString + 4, version.second);
+  StoreU32(header + kOffWidgetCount, static_cast<uint32_t>(doc.widgets.size()));
+  StoreU32(header + kOffWidgetsOffset, static_cast<uint32_t>(widgetsOffset));
+  StoreU32(header + kOffKindCount, static_cast<uint32_t>(kinds.size()));
+  StoreU32(header + kOffKindsOffset, static_cast<uint32_t>(kindsOffset));
+  StoreU32(header + kOffMetaCount, static_cast<uint32_t>(doc.meta.size()));
+  StoreU32(header + kOffMetaOffset, static_cast<uint32_t>(metaOffset));
+  StoreU32(header + kOffStringsOffset, static_cast<uint32_t>(stringsOffset));
+  StoreU32(header + kOffStringsSize, static_cast<uint32_t>(stringsSize));
+  StoreU64(header + kOffFileSize, fileSize);
+
+  for (size_t i = 0; i < kinds.size(); ++i) {
+    const auto name = table.Add(ToString(kinds[i]));
+    char* record = bytes.data() + kindsOffset + i * kKindRecordSize;
+    StoreU32(record, name.first);
+    StoreU32(record + 4, name.second);
+  }
+
+  size_t metaIndex = 0;
+  for (const auto& entry : doc.meta) {
+    const MetaValue& value = entry.second;
+    const auto key = table.Add(entry.first);
+    char* record = bytes.data() + metaOffset + metaIndex++ * metaRecordSize;
+    StoreU32(record, key.first);
+    StoreU32(record + 4, key.second);
+    char* valueField = record + 8;
+    if (typedMeta) {
+      StoreU32(record + 8, static_cast<uint32_t>(value.type()));
+      valueField = record + 16;
+    }
+    if (value.isString()) {
+      const auto text = table.Add(value.text());
+      StoreU32(valueField, text.first);
+      StoreU32(valueField + 4, text.second);
+    } else {
+      StoreU64(valueField, value.scalarBits());
+    }
+  }
+
+  for (size_t i = 0; i < doc.widgets.size(); ++i) {
+    const Widget& widget = doc.widgets[i];
+    const auto title = table.Add(widget.title);
+    char* record = bytes.data() + widgetsOffset + i * kWidgetRecordSize;
+    StoreU32(record, widget.id);
+    StoreU16(record + 4, kindIndices[i]);
+    StoreU32(record + 8, static_cast<uint32_t>(widget.boundsCells.x));
+    StoreU32(record + 12, static_cast<uint32_t>(widget.boundsCells.y));
+    StoreU32(record + 16, static_cast<uint32_t>(widget.boundsCells.w));
+    StoreU32(record + 20, static_cast<uint32_t>(widget.boundsCells.h));
+    StoreU32(record + 24, title.first);
+    StoreU32(record + 28, title.second);
+  }
+
+  return true;
+}
+
+bool LoadCgulBinaryFromBuffer(std::string_view bytes, CgulDocument* outDoc, std::string* outError) {
+  if (outError != nullptr) {
+    outError->clear();
+  }
+  if (outDoc == nullptr) {
+    return Fail("outDoc must not be null", outError);
+  }
+
+  CgulBinaryView view;
+  if (!view.Attach(bytes, outError)) {
+    return false;
+  }
+  view.ToDocument(outDoc);
+  return true;
+}
+
+bool SaveCgulBinaryFile(const std::string& path, const CgulDocument& doc, std::string* outError) {
+  return SaveCgulBinaryFile(path, doc, CgulSaveOptions{}, outError);
+}
+
+bool SaveCgulBinaryFile(const std::string& path, const CgulDocument& doc,
+                        const CgulSaveOptions& options, std::string* outError) {
+  std::string bytes;
+  if (!SaveCgulBinaryToBuffer(doc, &bytes, outError)) {
+    return false;
+  }
+
+  detail::FileWriteOptions writeOptions;
+  writeOptions.atomicReplace = options.atomicReplace;
+  writeOptions.syncToDisk = options.fsync;
+  return detail::WriteFileContents(path, bytes, writeOptions, outError);
+}
+
+bool LoadCgulBinaryFile(const std::string& path, CgulDocument* outDoc, std::string* outError) {
+  if (outError != nullptr) {
+    outError->clear();
+  }
+  if (outDoc == nullptr) {
+    return Fail("outDoc must not be null", outError);
+  }
+
+  CgulBinaryView view;
+  if (!view.Open(path, outError)) {
+    return false;
+  }
+  view.ToDocument(outDoc);
+  return true;
+}
+
+struct CgulBinaryView::Mapping {
+  detail::MappedFile file;
+};
+
+CgulBinaryView::CgulBinaryView() = default;
+CgulBinaryView::~CgulBinaryView() = default;
+CgulBinaryView::CgulBinaryView(CgulBinaryView&& other) noexcept = default;
+CgulBinaryView& CgulBinaryView::operator=(CgulBinaryView&& other) noexcept = default;
+
+bool CgulBinaryView::Open(const std::string& path, std::string* outError) {
+  if (outError != nullptr) {
+    outError->clear();
+  }
+  Close();
+
+  auto mapping = std::make_unique<Mapping>();
+  if (!mapping->file.Open(path, outError) || !Attach(mapping->file.view(), outError)) {
+    return false;
+  }
+  mapping_ = std::move(mapping);
+  return true;
+}
+
+bool CgulBinaryView::Attach(std::string_view bytes, std::string* outError) {
+  if (outError != nullptr) {
+    outError->clear();
+  }
+  Close();
+
+  if (bytes.size() < kHeaderSize || std::memcmp(bytes.data(), kMagic, sizeof(kMagic)) != 0) {
+    return Invalid("missing .cgulb header", outError);
+  }
+  const char* header = bytes.data();
+  const uint32_t formatVersion = LoadU32(header + kOffFormatVersion);
+  if (formatVersion != kFormatVersion && formatVersion != kStringMetaFormatVersion) {
+    return Invalid("unsupported format version " + std::to_string(formatVersion), outError);
+  }
+  const size_t metaRecordSize =
+      formatVersion == kStringMetaFormatVersion ? kStringMetaRecordSize : kMetaRecordSize;
+  if (LoadU32(header + kOffHeaderSize) != kHeaderSize) {
+    return Invalid("unexpected header size", outError);
+  }
+  if (LoadU64(header + kOffFileSize) != bytes.size()) {
+    return Invalid("file size does not match header (truncated?)", outError);
+  }
+
+  const uint32_t widgetCount = LoadU32(header + kOffWidgetCount);
+  const uint32_t widgetsOffset = LoadU32(header + kOffWidgetsOffset);
+  const uint32_t kindCount = LoadU32(header + kOffKindCount);
+  const uint32_t kindsOffset = LoadU32(header + kOffKindsOffset);
+  const uint32_t metaCount = LoadU32(header + kOffMetaCount);
+  const uint32_t metaOffset = LoadU32(header + kOffMetaOffset);
+  const uint32_t stringsOffset = LoadU32(header + kOffStringsOffset);
+  const uint32_t stringsSize = LoadU32(header + kOffStringsSize);
+  if (!CheckSection(bytes, widgetsOffset, widgetCount, kWidgetRecordSize, "widgets", outError) ||
+      !CheckSection(bytes, kindsOffset, kindCount, kKindRecordSize, "kinds", outError) ||
+      !CheckSection(bytes, metaOffset, metaCount, metaRecordSize, "meta", outError) ||
+      !CheckSection(bytes, stringsOffset, stringsSize, 1, "strings", outError)) {
+    return false;
+  }
+  const std::string_view strings = bytes.substr(stringsOffset, stringsSize);
+
+  if (!CheckStringRef(strings, header + kOffVersionString, outError)) {
+    return false;
+  }
+
+  std::vector<WidgetKind> kinds(kindCount);
+  std::string name;
+  for (uint32_t i = 0; i < kindCount; ++i) {
+    const char* record = bytes.data() + kindsOffset + static_cast<size_t>(i) * kKindRecordSize;
+    if (!CheckStringRef(strings, record, outError)) {
+      return false;
+    }
+    name.assign(strings.substr(LoadU32(record), LoadU32(record + 4)));
+    if (!ParseWidgetKind(name, &kinds[i])) {
+      return Fail("Unknown widget kind: " + name, outError);
+    }
+  }
+
+  std::vector<std::string_view> keys;
+  keys.reserve(metaCount);
+  for (uint32_t i = 0; i < metaCount; ++i) {
+    const char* record = bytes.data() + metaOffset + static_cast<size_t>(i) * metaRecordSize;
+    if (!CheckStringRef(strings, record, outError)) {
+      return false;
+    }
+    if (metaRecordSize == kStringMetaRecordSize) {
+      if (!CheckStringRef(strings, record + 8, outError)) {
+        return false;
+      }
+    } else if (LoadU32(record + 8) > static_cast<uint32_t>(MetaType::Float)) {
+      return Invalid("meta " + std::to_string(i) + " has unknown value type", outError);
+    } else if (LoadU32(record + 8) == static_cast<uint32_t>(MetaType::String) &&
+               !CheckStringRef(strings, record + 16, outError)) {
+      return false;
+    }
+    keys.push_back(strings.substr(LoadU32(record), LoadU32(record + 4)));
+  }
+  std::sort(keys.begin(), keys.end());
+  const auto duplicate = std::adjacent_find(keys.begin(), keys.end());
+  if (duplicate != keys.end()) {
+    return Invalid("duplicate meta key: " + std::string(*duplicate), outError);
+  }
+
+  const char* widgets = bytes.data() + widgetsOffset;
+  for (uint32_t i = 0; i < widgetCount; ++i) {
+    const char* record = widgets + static_cast<size_t>(i) * kWidgetRecordSize;
+    if (LoadU16(record + 4) >= kindCount) {
+      return Invalid("widget " + std::to_string(i) + " has kind index out of range", outError);
+    }
+    if (!CheckStringRef(strings, record + 24, outError)) {
+      return false;
+    }
+  }
+
+  bytes_ = bytes;
+  strings_ = strings;
+  cgulVersion_ = StringAt(header + kOffVersionString);
+  gridWCells_ = LoadI32(header + kOffGridW);
+  gridHCells_ = LoadI32(header + kOffGridH);
+  seed_ = LoadU64(header + kOffSeed);
+  widgets_ = widgets;
+  widgetCount_ = widgetCount;
+  meta_ = bytes.data() + metaOffset;
+  metaCount_ = metaCount;
+  metaRecordSize_ = metaRecordSize;
+  kinds_ = std::move(kinds);
+  return true;
+}
+
+void CgulBinaryView::Close() {
+  mapping_.reset();
+  bytes_ = std::string_view();
+  strings_ = std::string_view();
+  cgulVersion_ = std::string_view();
+  gridWCells_ = 0;
+  gridHCells_ = 0;
+  seed_ = 0;
+  widgets_ = nullptr;
+  widgetCount_ = 0;
+  meta_ = nullptr;
+  metaCount_ = 0;
+  metaRecordSize_ = 0;
+  kinds_.clear();
+}
+
+std::string_view CgulBinaryView::StringAt(const char* ref) const {
+  return strings_.substr(LoadU32(ref), LoadU32(ref + 4));
+}
+
+CgulBinaryWidget CgulBinaryView::widget(size_t index) const {
+  const char* record = widgets_ + index * kWidgetRecordSize;
+  CgulBinaryWidget widget;
+  widget.id = LoadU32(record);
+  widget.kind = kinds_[LoadU16(record + 4)];
+  widget.boundsCells = RectI{LoadI32(record + 8), LoadI32(record + 12), LoadI32(record + 16),
+                             LoadI32(record + 20)};
+  widget.title = StringAt(record + 24);
+  return widget;
+}
+
+CgulBinaryMeta CgulBinaryView::meta(size_t index) const {
+  const char* record = meta_ + index * metaRecordSize_;
+  CgulBinaryMeta meta;
+  meta.key = StringAt(record);
+  if (metaRecordSize_ == kStringMetaRecordSize) {
+    meta.text = StringAt(record + 8);
+  } else {
+    meta.type = static_cast<MetaType>(LoadU32(record + 8));
+    if (meta.type == MetaType::String) {
+      meta.text = StringAt(record + 16);
+    } else {
+      meta.scalarBits = LoadU64(record + 16);
+    }
+  }
+  return meta;
+}
+
+void CgulBinaryView::ToDocument(CgulDocument* outDoc) const {
+  CgulDocument doc;
+  doc.cgulVersion.assign(cgulVersion_);
+  doc.gridWCells = gridWCells_;
+  doc.gridHCells = gridHCells_;
+  doc.seed = seed_;
+  std::vector<MetaMap::value_type> entries;
+  entries.reserve(metaCount_);
+  for (size_t i = 0; i < metaCount_; ++i) {
+    const CgulBinaryMeta entry = meta(i);
+    entries.emplace_back(std::string(entry.key),
+                         entry.type == MetaType::String
+                             ? MetaValue(std::string(entry.text))
+                             : MetaValue::FromScalarBits(entry.type, entry.scalarBits));
+  }
+  doc.meta.Assign(std::move(entries));
+
+  doc.widgets.resize(widgetCount_);
+  for (size_t i = 0; i < widgetCount_; ++i) {
+    const CgulBinaryWidget record = widget(i);
+    Widget& target = doc.widgets[i];
+    target.id = record.id;
+    target.kind = record.kind;
+    target.boundsCells = record.boundsCells;
+    target.title.assign(record.title);
+  }
+
+  *outDoc = std::move(doc);
+}
+
+}  // namespace cgul
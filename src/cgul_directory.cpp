@@ -0,0 +1,130 @@
+#include "cgul/io/cgul_directory.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <system_error>
+#include <utility>
+
+#include "cgul/io/cgul_binary.h"
+#include "cgul/validate/validate.h"
+#include "parallel_for.h"
+
+namespace cgul {
+
+namespace {
+
+namespace fs = std::filesystem;
+
+double ElapsedMs(std::chrono::steady_clock::time_point start,
+                 std::chrono::steady_clock::time_point end) {
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+bool IsBinaryFile(const fs::path& path) {
+  return path.extension() == ".cgulb";
+}
+
+bool IsCgulFile(const fs::path& path, bool includeBinary) {
+  if (path.extension() == ".cgul") {
+    return true;
+  }
+  if (path.extension() == ".gz") {
+    return path.stem().extension() == ".cgul";
+  }
+  return includeBinary && IsBinaryFile(path);
+}
+
+template <typename Iterator>
+bool CollectFiles(Iterator it, const CgulDirectoryOptions& options,
+                  std::vector<CgulDirectoryEntry>* outEntries, std::error_code& ec) {
+  for (; !ec && it != Iterator(); it.increment(ec)) {
+    std::error_code entryError;
+    if (!it->is_regular_file(entryError) || !IsCgulFile(it->path(), options.includeBinary)) {
+      continue;
+    }
+    CgulDirectoryEntry entry;
+    entry.path = it->path().string();
+    const std::uintmax_t fileBytes = it->file_size(entryError);
+    entry.fileBytes = entryError ? 0 : fileBytes;
+    outEntries->push_back(std::move(entry));
+  }
+  return !ec;
+}
+
+void LoadEntry(const CgulDirectoryOptions& options, CgulDirectoryEntry* entry) {
+  const auto start = std::chrono::steady_clock::now();
+  const bool loaded = IsBinaryFile(entry->path)
+                          ? LoadCgulBinaryFile(entry->path, &entry->doc, &entry->error)
+                          : LoadCgulFile(entry->path, &entry->doc, &entry->error);
+  if (!loaded) {
+    entry->status = CgulFileStatus::LoadFailed;
+  } else if (options.validate && !Validate(entry->doc, &entry->error)) {
+    entry->status = CgulFileStatus::ValidationFailed;
+  }
+  if (!options.keepDocuments || entry->status != CgulFileStatus::Ok) {
+    entry->doc = CgulDocument();
+  }
+  entry->loadMs = ElapsedMs(start, std::chrono::steady_clock::now());
+}
+
+}  // namespace
+
+bool LoadCgulDirectory(const std::string& path, const CgulDirectoryOptions& options,
+                       std::vector<CgulDirectoryEntry>* outEntries, CgulDirectoryReport* outReport,
+                       std::string* outError) {
+  if (outError != nullptr) {
+    outError->clear();
+  }
+  if (outEntries == nullptr) {
+    if (outError != nullptr) {
+      *outError = "outEntries must not be null";
+    }
+    return false;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<CgulDirectoryEntry> entries;
+  std::error_code ec;
+  const bool listed =
+      options.recursive
+          ? CollectFiles(fs::recursive_directory_iterator(path, ec), options, &entries, ec)
+          : CollectFiles(fs::directory_iterator(path, ec), options, &entries, ec);
+  if (!listed) {
+    if (outError != nullptr) {
+      *outError = "Failed to read directory: " + path + ": " + ec.message();
+    }
+    return false;
+  }
+  std::sort(entries.begin(), entries.end(),
+            [](const CgulDirectoryEntry& a, const CgulDirectoryEntry& b) {
+              return a.path < b.path;
+            });
+
+  const unsigned workers = detail::ResolveWorkerCount(options.threadCount, entries.size());
+  detail::ParallelFor(entries.size(), workers,
+                      [&](size_t index, unsigned) { LoadEntry(options, &entries[index]); });
+
+  if (outReport != nullptr) {
+    CgulDirectoryReport report;
+    report.threadCount = workers;
+    report.fileCount = entries.size();
+    for (const CgulDirectoryEntry& entry : entries) {
+      report.totalBytes += entry.fileBytes;
+      report.failedCount += entry.status != CgulFileStatus::Ok ? 1 : 0;
+    }
+    report.wallMs = ElapsedMs(start, std::chrono::steady_clock::now());
+    if (report.wallMs > 0.0) {
+      const double seconds = report.wallMs / 1000.0;
+      report.megabytesPerSecond =
+          static_cast<double>(report.totalBytes) / (1024.0 * 1024.0) / seconds;
+      report.documentsPerSecond = static_cast<double>(report.fileCount) / seconds;
+    }
+    *outReport = report;
+  }
+  *outEntries = std::move(entries);
+  return true;
+}
+
+}  // namespace cgul
@@ -1,12 +1,17 @@
 #include "cgul/io/cgul_document.h"
 
-#include <cctype>
+#include "file_writer.h"
+#include "gzip_codec.h"
+#include "json_parser.h"
+#include "mapped_file.h"
+
+#include <charconv>
+#include <cmath>
 #include <cstdint>
-#include <fstream>
+#include <deque>
 #include <limits>
-#include <map>
-#include <sstream>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -14,403 +19,519 @@ namespace cgul {
 
 namespace {
 
-struct JsonValue {
-  enum class Type {
-    Null,
-    Bool,
-    Integer,
-    String,
-    Object,
-    Array,
-  };
-
-  Type type = Type::Null;
-  bool boolValue = false;
-  int64_t intValue = 0;
-  std::string stringValue;
-  std::map<std::string, JsonValue> objectValue;
-  std::vector<JsonValue> arrayValue;
-};
+using detail::JsonParser;
+using detail::JsonType;
+using detail::SeenKeys;
 
-class JsonParser {
- public:
-  explicit JsonParser(const std::string& input) : input_(input) {}
-
-  bool Parse(JsonValue* outValue, std::string* outError) {
-    SkipWhitespace();
-    if (!ParseValue(outValue, outError)) {
-      return false;
+int FindKey(const std::string& key, const char* const* keys, int keyCount) {
+  for (int i = 0; i < keyCount; ++i) {
+    if (key == keys[i]) {
+      return i;
     }
-    SkipWhitespace();
-    if (pos_ != input_.size()) {
-      return Error("unexpected trailing characters", outError);
-    }
-    return true;
   }
+  return -1;
+}
 
- private:
-  bool ParseValue(JsonValue* outValue, std::string* outError) {
-    if (pos_ >= input_.size()) {
-      return Error("unexpected end of input", outError);
-    }
-
-    const char ch = input_[pos_];
-    if (ch == '{') {
-      return ParseObject(outValue, outError);
-    }
-    if (ch == '[') {
-      return ParseArray(outValue, outError);
-    }
-    if (ch == '"') {
-      outValue->type = JsonValue::Type::String;
-      return ParseString(&outValue->stringValue, outError);
-    }
-    if (ch == '-' || std::isdigit(static_cast<unsigned char>(ch)) != 0) {
-      outValue->type = JsonValue::Type::Integer;
-      return ParseInteger(&outValue->intValue, outError);
-    }
-    if (StartsWith("true")) {
-      pos_ += 4;
-      outValue->type = JsonValue::Type::Bool;
-      outValue->boolValue = true;
-      return true;
-    }
-    if (StartsWith("false")) {
-      pos_ += 5;
-      outValue->type = JsonValue::Type::Bool;
-      outValue->boolValue = false;
-      return true;
-    }
-    if (StartsWith("null")) {
-      pos_ += 4;
-      outValue->type = JsonValue::Type::Null;
-      return true;
-    }
+// Single pass over the text: schema keys are decoded straight into the document and
+// everything else is validated and skipped. Member functions return false only on syntax
+// errors; schema errors are held back until the whole text has parsed, so syntax errors
+// still take precedence. Of several schema errors the one reported is the one the DOM
+// loader met first, which checked in a fixed order regardless of key order in the text:
+// cgulVersion, grid (w, h), seed, meta (by key), widgets in array order (id, kind,
+// bounds x/y/w/h, title).
+class CgulReader {
+ public:
+  explicit CgulReader(std::string_view text) : parser_(text) {}
 
-    return Error("unexpected token", outError);
-  }
+  bool Read(CgulDocument* doc, std::string* outError) {
+    enum RootKey { kVersion, kGrid, kSeed, kMeta, kWidgets, kRootKeyCount };
+    static const char* const kRootKeys[] = {"cgulVersion", "grid", "seed", "meta", "widgets"};
+    static const char* const kGridKeys[] = {"w", "h"};
 
-  bool ParseObject(JsonValue* outValue, std::string* outError) {
-    if (!Consume('{', outError)) {
+    parser_.SkipWhitespace();
+    bool isObject = false;
+    if (!ExpectType(JsonType::Object, "root", &isObject, outError)) {
       return false;
     }
 
-    outValue->type = JsonValue::Type::Object;
-    outValue->objectValue.clear();
-
-    SkipWhitespace();
-    if (TryConsume('}')) {
-      return true;
-    }
-
-    while (true) {
-      std::string key;
-      if (!ParseString(&key, outError)) {
+    SeenKeys seen;
+    if (isObject) {
+      const bool ok = parser_.ParseObject(
+          [&](const std::string& key, std::string* err) {
+            const int keyIndex = FindKey(key, kRootKeys, kRootKeyCount);
+            bool valueOk = true;
+            path_.assign(1, static_cast<size_t>(keyIndex));
+            switch (keyIndex) {
+              case kVersion:
+                valueOk = ReadString(key, &doc->cgulVersion, err);
+                break;
+              case kGrid: {
+                int* const outs[] = {&doc->gridWCells, &doc->gridHCells};
+                valueOk = ReadIntObject("grid", kGridKeys, outs, 2, err);
+                break;
+              }
+              case kSeed:
+                valueOk = ReadSeed(&doc->seed, err);
+                break;
+              case kMeta:
+                valueOk = ReadMeta(&doc->meta, err);
+                break;
+              case kWidgets:
+                valueOk = ReadWidgets(&doc->widgets, err);
+                break;
+              default:
+                valueOk = parser_.SkipValue(err);
+                break;
+            }
+            return valueOk && seen.Mark(parser_, keyIndex, key, err);
+          },
+          outError);
+      if (!ok) {
         return false;
       }
+    }
 
-      SkipWhitespace();
-      if (!Consume(':', outError)) {
-        return false;
-      }
+    parser_.SkipWhitespace();
+    if (!parser_.AtEnd()) {
+      return parser_.Error("unexpected trailing characters", outError);
+    }
 
-      SkipWhitespace();
-      JsonValue value;
-      if (!ParseValue(&value, outError)) {
-        return false;
+    if (isObject) {
+      path_.clear();
+      for (int i = kVersion; i <= kWidgets; ++i) {
+        if (i != kMeta && !seen.Has(i)) {
+          MissingKey(i, kRootKeys[i]);
+        }
       }
+    }
 
-      if (outValue->objectValue.find(key) != outValue->objectValue.end()) {
-        return Error("duplicate object key: " + key, outError);
+    if (!schemaError_.empty()) {
+      if (outError != nullptr) {
+        *outError = schemaError_;
       }
-      outValue->objectValue.emplace(std::move(key), std::move(value));
+      return false;
+    }
+    return true;
+  }
 
-      SkipWhitespace();
-      if (TryConsume('}')) {
-        return true;
-      }
-      if (!Consume(',', outError)) {
-        return false;
-      }
-      SkipWhitespace();
+ private:
+  // Keeps the error whose position (path_, then metaKey_) comes first in the check order.
+  void SchemaError(const std::string& message) {
+    if (!schemaError_.empty() &&
+        !(path_ < schemaErrorPath_ ||
+          (path_ == schemaErrorPath_ && metaKey_ < schemaErrorMetaKey_))) {
+      return;
+    }
+    schemaError_ = message;
+    schemaErrorPath_ = path_;
+    schemaErrorMetaKey_ = metaKey_;
+  }
+
+  // A missing key ranks where its value would have been checked.
+  void MissingKey(int slot, const char* key) {
+    path_.push_back(static_cast<size_t>(slot));
+    SchemaError(std::string("Missing required key: ") + key);
+    path_.pop_back();
+  }
+
+  // Malformed input is a syntax error; a well-formed value of the wrong type is recorded as
+  // a schema error and skipped.
+  bool ExpectType(JsonType expected, const std::string& label, bool* outMatches,
+                  std::string* outError) {
+    const JsonType actual = parser_.PeekType();
+    if (actual == JsonType::Invalid) {
+      return parser_.Error(parser_.AtEnd() ? "unexpected end of input" : "unexpected token",
+                           outError);
+    }
+    *outMatches = (actual == expected);
+    if (!*outMatches) {
+      SchemaError("Expected '" + label + "' to be " + DescribeType(expected));
+      return parser_.SkipValue(outError);
     }
+    return true;
   }
 
-  bool ParseArray(JsonValue* outValue, std::string* outError) {
-    if (!Consume('[', outError)) {
+  bool ReadInteger(const std::string& label, int64_t* out, bool* outMatches,
+                   std::string* outError) {
+    if (!ExpectType(JsonType::Integer, label, outMatches, outError)) {
       return false;
     }
+    return !*outMatches || parser_.ParseInteger(out, outError);
+  }
 
-    outValue->type = JsonValue::Type::Array;
-    outValue->arrayValue.clear();
-
-    SkipWhitespace();
-    if (TryConsume(']')) {
-      return true;
+  bool ReadInt(const std::string& key, int* out, std::string* outError) {
+    int64_t value = 0;
+    bool matches = false;
+    if (!ReadInteger(key, &value, &matches, outError)) {
+      return false;
     }
-
-    while (true) {
-      JsonValue item;
-      if (!ParseValue(&item, outError)) {
-        return false;
-      }
-      outValue->arrayValue.push_back(std::move(item));
-
-      SkipWhitespace();
-      if (TryConsume(']')) {
-        return true;
-      }
-      if (!Consume(',', outError)) {
-        return false;
+    if (matches) {
+      if (value < static_cast<int64_t>(std::numeric_limits<int>::min()) ||
+          value > static_cast<int64_t>(std::numeric_limits<int>::max())) {
+        SchemaError("Integer out of range for key: " + key);
+      } else {
+        *out = static_cast<int>(value);
       }
-      SkipWhitespace();
     }
+    return true;
   }
 
-  bool ParseString(std::string* outString, std::string* outError) {
-    if (!Consume('"', outError)) {
+  bool ReadUInt32(const std::string& key, uint32_t* out, std::string* outError) {
+    int64_t value = 0;
+    bool matches = false;
+    if (!ReadInteger(key, &value, &matches, outError)) {
       return false;
     }
-
-    outString->clear();
-    while (pos_ < input_.size()) {
-      const char ch = input_[pos_++];
-      if (ch == '"') {
-        return true;
-      }
-      if (ch == '\\') {
-        if (pos_ >= input_.size()) {
-          return Error("unterminated escape sequence", outError);
-        }
-        const char esc = input_[pos_++];
-        switch (esc) {
-          case '"': outString->push_back('"'); break;
-          case '\\': outString->push_back('\\'); break;
-          case 'n': outString->push_back('\n'); break;
-          case 'r': outString->push_back('\r'); break;
-          case 't': outString->push_back('\t'); break;
-          default:
-            return Error(std::string("unsupported string escape: \\") + esc, outError);
-        }
-        continue;
-      }
-
-      const unsigned char uch = static_cast<unsigned char>(ch);
-      if (uch < 0x20) {
-        return Error("control character in string", outError);
+    if (matches) {
+      if (value < 0 || value > static_cast<int64_t>(std::numeric_limits<uint32_t>::max())) {
+        SchemaError("Unsigned integer out of range for key: " + key);
+      } else {
+        *out = static_cast<uint32_t>(value);
       }
-      outString->push_back(ch);
     }
-
-    return Error("unterminated string literal", outError);
+    return true;
   }
 
-  bool ParseInteger(int64_t* outInteger, std::string* outError) {
-    if (pos_ >= input_.size()) {
-      return Error("expected integer", outError);
+  bool ReadSeed(uint64_t* out, std::string* outError) {
+    int64_t value = 0;
+    bool matches = false;
+    if (!ReadInteger("seed", &value, &matches, outError)) {
+      return false;
     }
-
-    bool negative = false;
-    if (input_[pos_] == '-') {
-      negative = true;
-      ++pos_;
-      if (pos_ >= input_.size()) {
-        return Error("expected digits after '-'", outError);
+    if (matches) {
+      if (value < 0) {
+        SchemaError("seed must be a non-negative integer");
+      } else {
+        *out = static_cast<uint64_t>(value);
       }
     }
+    return true;
+  }
 
-    if (input_[pos_] == '0' && pos_ + 1 < input_.size() &&
-        std::isdigit(static_cast<unsigned char>(input_[pos_ + 1])) != 0) {
-      return Error("leading zeros are not allowed", outError);
+  bool ReadString(const std::string& label, std::string* out, std::string* outError) {
+    bool matches = false;
+    if (!ExpectType(JsonType::String, label, &matches, outError)) {
+      return false;
     }
+    return !matches || parser_.ParseString(out, outError);
+  }
 
-    if (std::isdigit(static_cast<unsigned char>(input_[pos_])) == 0) {
-      return Error("expected integer digits", outError);
+  // Reads an object whose schema members are all required ints, e.g. grid and bounds.
+  bool ReadIntObject(const char* label, const char* const* keys, int* const* outs, int keyCount,
+                     std::string* outError) {
+    bool isObject = false;
+    if (!ExpectType(JsonType::Object, label, &isObject, outError)) {
+      return false;
+    }
+    if (!isObject) {
+      return true;
     }
 
-    uint64_t magnitude = 0;
-    while (pos_ < input_.size() && std::isdigit(static_cast<unsigned char>(input_[pos_])) != 0) {
-      const uint64_t digit = static_cast<uint64_t>(input_[pos_] - '0');
-      if (magnitude > (std::numeric_limits<uint64_t>::max() - digit) / 10ULL) {
-        return Error("integer out of range", outError);
+    SeenKeys seen;
+    const bool ok = parser_.ParseObject(
+        [&](const std::string& key, std::string* err) {
+          const int index = FindKey(key, keys, keyCount);
+          if (index < 0) {
+            return parser_.SkipValue(err) && seen.Mark(parser_, index, key, err);
+          }
+          path_.push_back(static_cast<size_t>(index));
+          const bool valueOk = ReadInt(key, outs[index], err);
+          path_.pop_back();
+          return valueOk && seen.Mark(parser_, index, key, err);
+        },
+        outError);
+    if (!ok) {
+      return false;
+    }
+    for (int i = 0; i < keyCount; ++i) {
+      if (!seen.Has(i)) {
+        MissingKey(i, keys[i]);
       }
-      magnitude = magnitude * 10ULL + digit;
-      ++pos_;
     }
+    return true;
+  }
 
-    if (pos_ < input_.size() && (input_[pos_] == '.' || input_[pos_] == 'e' || input_[pos_] == 'E')) {
-      return Error("floating-point numbers are not supported", outError);
+  bool ReadMeta(MetaMap* meta, std::string* outError) {
+    bool isObject = false;
+    if (!ExpectType(JsonType::Object, "meta", &isObject, outError)) {
+      return false;
+    }
+    if (!isObject) {
+      return true;
     }
 
-    if (negative) {
-      const uint64_t maxNegative = static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) + 1ULL;
-      if (magnitude > maxNegative) {
-        return Error("integer out of int64 range", outError);
-      }
-      if (magnitude == maxNegative) {
-        *outInteger = std::numeric_limits<int64_t>::min();
-      } else {
-        *outInteger = -static_cast<int64_t>(magnitude);
+    std::vector<MetaMap::value_type> entries;
+    SeenKeys seen;
+    const bool ok = parser_.ParseObject(
+        [&](const std::string& key, std::string* err) {
+          MetaValue value;
+          bool matches = false;
+          metaKey_ = key;
+          const bool valueOk = ReadMetaValue("meta." + key, &value, &matches, err);
+          metaKey_.clear();
+          if (!valueOk || !seen.Mark(parser_, -1, key, err)) {
+            return false;
+          }
+          if (matches) {
+            entries.emplace_back(key, std::move(value));
+          }
+          return true;
+        },
+        outError);
+    if (ok) {
+      meta->Assign(std::move(entries));
+    }
+    return ok;
+  }
+
+  // Strings, booleans and numbers are stored with their type; a number with a fraction or
+  // exponent is a float, any other number an int.
+  bool ReadMetaValue(const std::string& label, MetaValue* out, bool* outMatches,
+                     std::string* outError) {
+    *outMatches = true;
+    switch (parser_.PeekType()) {
+      case JsonType::String:
+        if (!parser_.ParseString(&scratch_, outError)) {
+          return false;
+        }
+        *out = MetaValue(scratch_);
+        return true;
+      case JsonType::Bool: {
+        bool value = false;
+        if (!parser_.ParseBool(&value, outError)) {
+          return false;
+        }
+        *out = MetaValue::FromBool(value);
+        return true;
       }
-    } else {
-      if (magnitude > static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) {
-        return Error("integer out of int64 range", outError);
+      case JsonType::Integer: {
+        int64_t integer = 0;
+        double number = 0.0;
+        bool isFloat = false;
+        if (!parser_.ParseNumber(&integer, &number, &isFloat, outError)) {
+          return false;
+        }
+        *out = isFloat ? MetaValue::FromFloat(number) : MetaValue::FromInt(integer);
+        return true;
       }
-      *outInteger = static_cast<int64_t>(magnitude);
+      case JsonType::Invalid:
+        return parser_.Error(parser_.AtEnd() ? "unexpected end of input" : "unexpected token",
+                             outError);
+      default:
+        *outMatches = false;
+        SchemaError("Expected '" + label + "' to be a string, number or boolean");
+        return parser_.SkipValue(outError);
     }
-
-    return true;
   }
 
-  bool Consume(char expected, std::string* outError) {
-    if (pos_ >= input_.size() || input_[pos_] != expected) {
-      return Error(std::string("expected '") + expected + "'", outError);
+  bool ReadWidgets(std::vector<Widget>* widgets, std::string* outError) {
+    bool isArray = false;
+    if (!ExpectType(JsonType::Array, "widgets", &isArray, outError)) {
+      return false;
     }
-    ++pos_;
-    return true;
-  }
-
-  bool TryConsume(char expected) {
-    if (pos_ < input_.size() && input_[pos_] == expected) {
-      ++pos_;
+    if (!isArray) {
       return true;
     }
-    return false;
+
+    widgets->clear();
+    return parser_.ParseArray(
+        [&](size_t index, std::string* err) {
+          widgets->emplace_back();
+          path_.resize(1);
+          path_.push_back(index);
+          return ReadWidget(index, &widgets->back(), err);
+        },
+        outError);
   }
 
-  bool StartsWith(const char* token) const {
-    size_t i = 0;
-    while (token[i] != '\0') {
-      if (pos_ + i >= input_.size() || input_[pos_ + i] != token[i]) {
-        return false;
-      }
-      ++i;
+  bool ReadWidget(size_t index, Widget* widget, std::string* outError) {
+    enum WidgetKey { kId, kKind, kBounds, kTitle, kWidgetKeyCount };
+    static const char* const kWidgetKeys[] = {"id", "kind", "bounds", "title"};
+    static const char* const kBoundsKeys[] = {"x", "y", "w", "h"};
+
+    bool isObject = false;
+    if (!ExpectType(JsonType::Object, "widgets[" + std::to_string(index) + "]", &isObject,
+                    outError)) {
+      return false;
+    }
+    if (!isObject) {
+      return true;
     }
-    return true;
-  }
 
-  void SkipWhitespace() {
-    while (pos_ < input_.size()) {
-      const unsigned char ch = static_cast<unsigned char>(input_[pos_]);
-      if (ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t') {
-        ++pos_;
-      } else {
-        break;
-      }
+    SeenKeys seen;
+    const bool ok = parser_.ParseObject(
+        [&](const std::string& key, std::string* err) {
+          const int keyIndex = FindKey(key, kWidgetKeys, kWidgetKeyCount);
+          bool valueOk = true;
+          path_.resize(2);
+          path_.push_back(static_cast<size_t>(keyIndex));
+          switch (keyIndex) {
+            case kId:
+              valueOk = ReadUInt32(key, &widget->id, err);
+              break;
+            case kKind: {
+              bool isString = false;
+              valueOk = ExpectType(JsonType::String, key, &isString, err);
+              if (valueOk && isString) {
+                valueOk = parser_.ParseString(&scratch_, err);
+                if (valueOk && !ParseWidgetKind(scratch_, &widget->kind)) {
+                  SchemaError("Unknown widget kind: " + scratch_);
+                }
+              }
+              break;
+            }
+            case kBounds: {
+              int* const outs[] = {&widget->boundsCells.x, &widget->boundsCells.y,
+                                   &widget->boundsCells.w, &widget->boundsCells.h};
+              valueOk = ReadIntObject("bounds", kBoundsKeys, outs, 4, err);
+              break;
+            }
+            case kTitle:
+              valueOk = ReadString(key, &widget->title, err);
+              break;
+            default:
+              valueOk = parser_.SkipValue(err);
+              break;
+          }
+          return valueOk && seen.Mark(parser_, keyIndex, key, err);
+        },
+        outError);
+    if (!ok) {
+      return false;
     }
-  }
 
-  bool Error(const std::string& message, std::string* outError) const {
-    if (outError != nullptr) {
-      *outError = "Parse error at byte " + std::to_string(pos_) + ": " + message;
+    path_.resize(2);
+    for (int i = kId; i <= kBounds; ++i) {
+      if (!seen.Has(i)) {
+        MissingKey(i, kWidgetKeys[i]);
+      }
     }
-    return false;
+    return true;
   }
 
-  const std::string& input_;
-  size_t pos_ = 0;
+  JsonParser parser_;
+  // Check-order position of the value being read: root key slot, then widget index, widget
+  // key slot and grid/bounds key slot as applicable. Unknown keys take slot -1 (SIZE_MAX) but
+  // never raise schema errors.
+  std::vector<size_t> path_;
+  std::string metaKey_;  // key of the meta value being read
+  std::string schemaError_;
+  std::vector<size_t> schemaErrorPath_;
+  std::string schemaErrorMetaKey_;
+  std::string scratch_;
 };
 
-bool RequireType(const JsonValue& value, JsonValue::Type expected, const std::string& label,
-                 std::string* outError) {
-  if (value.type != expected) {
-    if (outError != nullptr) {
-      *outError = "Expected '" + label + "' to be " +
-                  (expected == JsonValue::Type::Object ? "an object" :
-                   expected == JsonValue::Type::Array ? "an array" :
-                   expected == JsonValue::Type::String ? "a string" :
-                   expected == JsonValue::Type::Integer ? "an integer" :
-                   expected == JsonValue::Type::Bool ? "a boolean" : "null");
-    }
-    return false;
-  }
-  return true;
+std::deque<std::string>& CustomWidgetKindNames() {
+  static std::deque<std::string> names;
+  return names;
 }
 
-const JsonValue* FindObjectKey(const JsonValue& objectValue, const std::string& key) {
-  const auto it = objectValue.objectValue.find(key);
-  if (it == objectValue.objectValue.end()) {
-    return nullptr;
-  }
-  return &it->second;
+void AppendEscaped(std::string* out, const std::string& value) {
+  size_t plainStart = 0;
+  for (size_t i = 0; i < value.size(); ++i) {
+    const char* escape = nullptr;
+    switch (value[i]) {
+      case '"': escape = "\\\""; break;
+      case '\\': escape = "\\\\"; break;
+      case '\n': escape = "\\n"; break;
+      case '\r': escape = "\\r"; break;
+      case '\t': escape = "\\t"; break;
+      default: continue;
+    }
+    out->append(value, plainStart, i - plainStart);
+    out->append(escape, 2);
+    plainStart = i + 1;
+  }
+  out->append(value, plainStart, std::string::npos);
 }
 
-bool ReadRequiredInt(const JsonValue& objectValue, const std::string& key, int* out,
-                     std::string* outError) {
-  const JsonValue* value = FindObjectKey(objectValue, key);
-  if (value == nullptr) {
-    if (outError != nullptr) {
-      *outError = "Missing required key: " + key;
-    }
-    return false;
-  }
-  if (!RequireType(*value, JsonValue::Type::Integer, key, outError)) {
-    return false;
-  }
-  if (value->intValue < static_cast<int64_t>(std::numeric_limits<int>::min()) ||
-      value->intValue > static_cast<int64_t>(std::numeric_limits<int>::max())) {
-    if (outError != nullptr) {
-      *outError = "Integer out of range for key: " + key;
-    }
-    return false;
-  }
-  *out = static_cast<int>(value->intValue);
-  return true;
+void AppendQuoted(std::string* out, const std::string& value) {
+  out->push_back('"');
+  AppendEscaped(out, value);
+  out->push_back('"');
 }
 
-bool ReadRequiredUInt32(const JsonValue& objectValue, const std::string& key, uint32_t* out,
-                        std::string* outError) {
-  const JsonValue* value = FindObjectKey(objectValue, key);
-  if (value == nullptr) {
-    if (outError != nullptr) {
-      *outError = "Missing required key: " + key;
-    }
-    return false;
-  }
-  if (!RequireType(*value, JsonValue::Type::Integer, key, outError)) {
-    return false;
+template <typename Integer>
+void AppendInteger(std::string* out, Integer value) {
+  char digits[24];
+  const std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value);
+  out->append(digits, static_cast<size_t>(result.ptr - digits));
+}
+
+// Upper bound on the fixed text per widget, excluding title and kind name.
+constexpr size_t kWidgetTextEstimate = 200;
+
+size_t EstimateCgulTextSize(const CgulDocument& doc) {
+  size_t size = 160 + doc.cgulVersion.size();
+  for (const auto& entry : doc.meta) {
+    size += entry.first.size() + entry.second.text().size() + 32;
   }
-  if (value->intValue < 0 ||
-      value->intValue > static_cast<int64_t>(std::numeric_limits<uint32_t>::max())) {
-    if (outError != nullptr) {
-      *outError = "Unsigned integer out of range for key: " + key;
-    }
-    return false;
+  for (const Widget& widget : doc.widgets) {
+    size += kWidgetTextEstimate + widget.title.size();
   }
-  *out = static_cast<uint32_t>(value->intValue);
-  return true;
+  return size;
 }
 
-bool ReadRequiredString(const JsonValue& objectValue, const std::string& key, std::string* out,
-                        std::string* outError) {
-  const JsonValue* value = FindObjectKey(objectValue, key);
-  if (value == nullptr) {
-    if (outError != nullptr) {
-      *outError = "Missing required key: " + key;
+void AppendCgulText(const CgulDocument& doc, std::string* out) {
+  out->append("{\n  \"cgulVersion\": ");
+  AppendQuoted(out, doc.cgulVersion);
+  out->append(",\n  \"grid\": {\n    \"w\": ");
+  AppendInteger(out, doc.gridWCells);
+  out->append(",\n    \"h\": ");
+  AppendInteger(out, doc.gridHCells);
+  out->append("\n  },\n  \"seed\": ");
+  AppendInteger(out, doc.seed);
+  out->append(",\n");
+  if (!doc.meta.empty()) {
+    out->append("  \"meta\": {\n");
+    size_t metaIndex = 0;
+    for (const auto& entry : doc.meta) {
+      out->append("    ");
+      AppendQuoted(out, entry.first);
+      out->append(": ");
+      if (entry.second.isString()) {
+        AppendQuoted(out, entry.second.text());
+      } else {
+        out->append(ToString(entry.second));
+      }
+      out->append(++metaIndex < doc.meta.size() ? ",\n" : "\n");
     }
-    return false;
+    out->append("  },\n");
   }
-  if (!RequireType(*value, JsonValue::Type::String, key, outError)) {
-    return false;
+  out->append(doc.widgets.empty() ? "  \"widgets\": [" : "  \"widgets\": [\n");
+
+  for (size_t i = 0; i < doc.widgets.size(); ++i) {
+    const Widget& widget = doc.widgets[i];
+    out->append("    {\n      \"id\": ");
+    AppendInteger(out, widget.id);
+    out->append(",\n      \"kind\": \"");
+    out->append(ToString(widget.kind));
+    out->append("\",\n      \"bounds\": {\n        \"x\": ");
+    AppendInteger(out, widget.boundsCells.x);
+    out->append(",\n        \"y\": ");
+    AppendInteger(out, widget.boundsCells.y);
+    out->append(",\n        \"w\": ");
+    AppendInteger(out, widget.boundsCells.w);
+    out->append(",\n        \"h\": ");
+    AppendInteger(out, widget.boundsCells.h);
+    if (!widget.title.empty()) {
+      out->append("\n      },\n      \"title\": ");
+      AppendQuoted(out, widget.title);
+      out->append("\n    }");
+    } else {
+      out->append("\n      }\n    }");
+    }
+    out->append(i + 1 < doc.widgets.size() ? ",\n" : "\n");
   }
-  *out = value->stringValue;
-  return true;
+
+  out->append(doc.widgets.empty() ? "]\n}\n" : "  ]\n}\n");
 }
 
-std::string EscapeString(const std::string& value) {
-  std::string escaped;
-  escaped.reserve(value.size());
-  for (char ch : value) {
-    switch (ch) {
-      case '"': escaped += "\\\""; break;
-      case '\\': escaped += "\\\\"; break;
-      case '\n': escaped += "\\n"; break;
-      case '\r': escaped += "\\r"; break;
-      case '\t': escaped += "\\t"; break;
-      default: escaped.push_back(ch); break;
-    }
+bool UseGzip(const std::string& path, CgulCompression compression) {
+  if (compression == CgulCompression::Auto) {
+    return path.size() >= 3 && path.compare(path.size() - 3, 3, ".gz") == 0;
   }
-  return escaped;
+  return compression == CgulCompression::Gzip;
 }
 
 }  // namespace
@@ -422,6 +543,12 @@ const char* ToString(WidgetKind kind) {
     case WidgetKind::Label: return "label";
     case WidgetKind::Button: return "button";
   }
+  const std::deque<std::string>& names = CustomWidgetKindNames();
+  const uint16_t value = static_cast<uint16_t>(kind);
+  if (value >= kFirstCustomWidgetKind &&
+      static_cast<size_t>(value - kFirstCustomWidgetKind) < names.size()) {
+    return names[value - kFirstCustomWidgetKind].c_str();
+  }
   return "panel";
 }
 
@@ -445,242 +572,170 @@ bool ParseWidgetKind(const std::string& text, WidgetKind* outKind) {
     *outKind = WidgetKind::Button;
     return true;
   }
+  const std::deque<std::string>& names = CustomWidgetKindNames();
+  for (size_t i = 0; i < names.size(); ++i) {
+    if (names[i] == text) {
+      *outKind = static_cast<WidgetKind>(kFirstCustomWidgetKind + i);
+      return true;
+    }
+  }
   return false;
 }
 
-bool SaveCgulFile(const std::string& path, const CgulDocument& doc, std::string* outError) {
+bool IsBuiltinWidgetKind(WidgetKind kind) {
+  return static_cast<uint16_t>(kind) <= static_cast<uint16_t>(WidgetKind::Button);
+}
+
+bool RegisterWidgetKind(const std::string& name, WidgetKind* outKind, std::string* outError) {
   if (outError != nullptr) {
     outError->clear();
   }
-
-  std::ostringstream os;
-  os << "{\n";
-  os << "  \"cgulVersion\": \"" << EscapeString(doc.cgulVersion) << "\",\n";
-  os << "  \"grid\": {\n";
-  os << "    \"w\": " << doc.gridWCells << ",\n";
-  os << "    \"h\": " << doc.gridHCells << "\n";
-  os << "  },\n";
-  os << "  \"seed\": " << doc.seed << ",\n";
-  if (!doc.meta.empty()) {
-    os << "  \"meta\": {\n";
-    size_t metaIndex = 0;
-    for (const auto& entry : doc.meta) {
-      os << "    \"" << EscapeString(entry.first) << "\": \"" << EscapeString(entry.second) << "\"";
-      if (metaIndex + 1 < doc.meta.size()) {
-        os << ",";
-      }
-      os << "\n";
-      ++metaIndex;
+  if (outKind == nullptr) {
+    if (outError != nullptr) {
+      *outError = "outKind must not be null";
     }
-    os << "  },\n";
-  }
-  os << "  \"widgets\": [";
-
-  if (!doc.widgets.empty()) {
-    os << "\n";
+    return false;
   }
-
-  for (size_t i = 0; i < doc.widgets.size(); ++i) {
-    const Widget& widget = doc.widgets[i];
-    os << "    {\n";
-    os << "      \"id\": " << widget.id << ",\n";
-    os << "      \"kind\": \"" << ToString(widget.kind) << "\",\n";
-    os << "      \"bounds\": {\n";
-    os << "        \"x\": " << widget.boundsCells.x << ",\n";
-    os << "        \"y\": " << widget.boundsCells.y << ",\n";
-    os << "        \"w\": " << widget.boundsCells.w << ",\n";
-    os << "        \"h\": " << widget.boundsCells.h << "\n";
-    os << "      }";
-    if (!widget.title.empty()) {
-      os << ",\n";
-      os << "      \"title\": \"" << EscapeString(widget.title) << "\"\n";
-    } else {
-      os << "\n";
-    }
-    os << "    }";
-    if (i + 1 < doc.widgets.size()) {
-      os << ",";
+  if (name.empty()) {
+    if (outError != nullptr) {
+      *outError = "widget kind name must not be empty";
     }
-    os << "\n";
+    return false;
   }
-
-  if (!doc.widgets.empty()) {
-    os << "  ";
+  // Kind names are written unescaped, so they must not need escaping in a JSON string.
+  for (const char ch : name) {
+    if (ch == '"' || ch == '\\' || static_cast<unsigned char>(ch) < 0x20) {
+      if (outError != nullptr) {
+        *outError = "widget kind name must not contain quotes, backslashes or control "
+                    "characters: " + name;
+      }
+      return false;
+    }
   }
-  os << "]\n";
-  os << "}\n";
 
-  std::ofstream file(path, std::ios::binary);
-  if (!file.is_open()) {
-    if (outError != nullptr) {
-      *outError = "Failed to open file for writing: " + path;
+  WidgetKind existing = WidgetKind::Panel;
+  if (ParseWidgetKind(name, &existing)) {
+    if (IsBuiltinWidgetKind(existing)) {
+      if (outError != nullptr) {
+        *outError = "widget kind name is reserved: " + name;
+      }
+      return false;
     }
-    return false;
+    *outKind = existing;
+    return true;
   }
 
-  const std::string text = os.str();
-  file.write(text.data(), static_cast<std::streamsize>(text.size()));
-  if (!file.good()) {
+  std::deque<std::string>& names = CustomWidgetKindNames();
+  if (kFirstCustomWidgetKind + names.size() > std::numeric_limits<uint16_t>::max()) {
     if (outError != nullptr) {
-      *outError = "Failed to write file: " + path;
+      *outError = "too many custom widget kinds";
     }
     return false;
   }
+  names.push_back(name);
+  *outKind = static_cast<WidgetKind>(kFirstCustomWidgetKind + names.size() - 1);
+  return true;
+}
 
+bool IsCgulGzipSupported() {
+#if defined(CGUL_HAVE_ZLIB)
   return true;
+#else
+  return false;
+#endif
 }
 
-bool LoadCgulFile(const std::string& path, CgulDocument* outDoc, std::string* outError) {
+bool SaveCgulToBuffer(const CgulDocument& doc, std::string* outText, std::string* outError) {
   if (outError != nullptr) {
     outError->clear();
   }
-  if (outDoc == nullptr) {
+  if (outText == nullptr) {
     if (outError != nullptr) {
-      *outError = "outDoc must not be null";
+      *outError = "outText must not be null";
     }
     return false;
   }
 
-  std::ifstream file(path, std::ios::binary);
-  if (!file.is_open()) {
-    if (outError != nullptr) {
-      *outError = "Failed to open file for reading: " + path;
+  for (const auto& entry : doc.meta) {
+    if (entry.second.type() == MetaType::Float && !std::isfinite(entry.second.floatValue())) {
+      if (outError != nullptr) {
+        *outError = "meta value is not a finite number: " + entry.first;
+      }
+      return false;
     }
-    return false;
   }
 
-  std::ostringstream buffer;
-  buffer << file.rdbuf();
-  const std::string text = buffer.str();
-
-  JsonValue root;
-  JsonParser parser(text);
-  if (!parser.Parse(&root, outError)) {
-    return false;
-  }
-  if (!RequireType(root, JsonValue::Type::Object, "root", outError)) {
-    return false;
-  }
+  outText->clear();
+  outText->reserve(EstimateCgulTextSize(doc));
+  AppendCgulText(doc, outText);
+  return true;
+}
 
-  CgulDocument doc;
+bool SaveCgulFile(const std::string& path, const CgulDocument& doc, std::string* outError) {
+  return SaveCgulFile(path, doc, CgulSaveOptions{}, outError);
+}
 
-  if (!ReadRequiredString(root, "cgulVersion", &doc.cgulVersion, outError)) {
+bool SaveCgulFile(const std::string& path, const CgulDocument& doc,
+                  const CgulSaveOptions& options, std::string* outError) {
+  std::string text;
+  if (!SaveCgulToBuffer(doc, &text, outError)) {
     return false;
   }
 
-  const JsonValue* gridValue = FindObjectKey(root, "grid");
-  if (gridValue == nullptr) {
-    if (outError != nullptr) {
-      *outError = "Missing required key: grid";
-    }
-    return false;
-  }
-  if (!RequireType(*gridValue, JsonValue::Type::Object, "grid", outError)) {
-    return false;
-  }
-  if (!ReadRequiredInt(*gridValue, "w", &doc.gridWCells, outError) ||
-      !ReadRequiredInt(*gridValue, "h", &doc.gridHCells, outError)) {
-    return false;
+  detail::FileWriteOptions writeOptions;
+  writeOptions.atomicReplace = options.atomicReplace;
+  writeOptions.syncToDisk = options.fsync;
+  if (UseGzip(path, options.compression)) {
+    return detail::WriteGzipFile(path, text, writeOptions, outError);
   }
+  return detail::WriteFileContents(path, text, writeOptions, outError);
+}
 
-  const JsonValue* seedValue = FindObjectKey(root, "seed");
-  if (seedValue == nullptr) {
-    if (outError != nullptr) {
-      *outError = "Missing required key: seed";
-    }
-    return false;
-  }
-  if (!RequireType(*seedValue, JsonValue::Type::Integer, "seed", outError)) {
-    return false;
+bool LoadCgulFromBuffer(std::string_view text, CgulDocument* outDoc, std::string* outError) {
+  if (outError != nullptr) {
+    outError->clear();
   }
-  if (seedValue->intValue < 0) {
+  if (outDoc == nullptr) {
     if (outError != nullptr) {
-      *outError = "seed must be a non-negative integer";
+      *outError = "outDoc must not be null";
     }
     return false;
   }
-  doc.seed = static_cast<uint64_t>(seedValue->intValue);
 
-  const JsonValue* metaValue = FindObjectKey(root, "meta");
-  if (metaValue != nullptr) {
-    if (!RequireType(*metaValue, JsonValue::Type::Object, "meta", outError)) {
+  std::string inflated;
+  if (detail::IsGzipData(text)) {
+    if (!detail::GunzipToString(text, &inflated, outError)) {
       return false;
     }
-    for (const auto& entry : metaValue->objectValue) {
-      if (!RequireType(entry.second, JsonValue::Type::String, "meta." + entry.first, outError)) {
-        return false;
-      }
-      doc.meta[entry.first] = entry.second.stringValue;
-    }
+    text = inflated;
   }
 
-  const JsonValue* widgetsValue = FindObjectKey(root, "widgets");
-  if (widgetsValue == nullptr) {
-    if (outError != nullptr) {
-      *outError = "Missing required key: widgets";
-    }
-    return false;
-  }
-  if (!RequireType(*widgetsValue, JsonValue::Type::Array, "widgets", outError)) {
+  CgulDocument doc;
+  CgulReader reader(text);
+  if (!reader.Read(&doc, outError)) {
     return false;
   }
 
-  doc.widgets.clear();
-  doc.widgets.reserve(widgetsValue->arrayValue.size());
-
-  for (size_t i = 0; i < widgetsValue->arrayValue.size(); ++i) {
-    const JsonValue& item = widgetsValue->arrayValue[i];
-    if (!RequireType(item, JsonValue::Type::Object, "widgets[" + std::to_string(i) + "]", outError)) {
-      return false;
-    }
-
-    Widget widget;
-    if (!ReadRequiredUInt32(item, "id", &widget.id, outError)) {
-      return false;
-    }
-
-    std::string kindString;
-    if (!ReadRequiredString(item, "kind", &kindString, outError)) {
-      return false;
-    }
-    if (!ParseWidgetKind(kindString, &widget.kind)) {
-      if (outError != nullptr) {
-        *outError = "Unknown widget kind: " + kindString;
-      }
-      return false;
-    }
-
-    const JsonValue* boundsValue = FindObjectKey(item, "bounds");
-    if (boundsValue == nullptr) {
-      if (outError != nullptr) {
-        *outError = "Missing required key: bounds";
-      }
-      return false;
-    }
-    if (!RequireType(*boundsValue, JsonValue::Type::Object, "bounds", outError)) {
-      return false;
-    }
-
-    if (!ReadRequiredInt(*boundsValue, "x", &widget.boundsCells.x, outError) ||
-        !ReadRequiredInt(*boundsValue, "y", &widget.boundsCells.y, outError) ||
-        !ReadRequiredInt(*boundsValue, "w", &widget.boundsCells.w, outError) ||
-        !ReadRequiredInt(*boundsValue, "h", &widget.boundsCells.h, outError)) {
-      return false;
-    }
+  *outDoc = std::move(doc);
+  return true;
+}
 
-    const JsonValue* titleValue = FindObjectKey(item, "title");
-    if (titleValue != nullptr) {
-      if (!RequireType(*titleValue, JsonValue::Type::String, "title", outError)) {
-        return false;
-      }
-      widget.title = titleValue->stringValue;
+bool LoadCgulFile(const std::string& path, CgulDocument* outDoc, std::string* outError) {
+  if (outError != nullptr) {
+    outError->clear();
+  }
+  if (outDoc == nullptr) {
+    if (outError != nullptr) {
+      *outError = "outDoc must not be null";
     }
-
-    doc.widgets.push_back(std::move(widget));
+    return false;
   }
 
-  *outDoc = std::move(doc);
-  return true;
+  detail::MappedFile file;
+  if (!file.Open(path, outError)) {
+    return false;
+  }
+  return LoadCgulFromBuffer(file.view(), outDoc, outError);
 }
 
 }  // namespace cgul
@@ -0,0 +1,766 @@
+#include "cgul/io/cgul_journal.h"
+
+#include "byte_order.h"
+#include "cgul/core/document_index.h"
+#include "file_writer.h"
+#include "hash.h"
+#include "mapped_file.h"
+
+#include <cstring>
+#include <filesystem>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace cgul {
+
+namespace {
+
+using detail::HashBytes32;
+using detail::HashBytes64;
+
+constexpr char kJournalMagic[8] = {'C', 'G', 'U', 'L', 'J', 'N', 'L', '1'};
+constexpr size_t kJournalHeaderSize = 16;
+// Each record: u32 payload length, u32 payload checksum, payload.
+constexpr size_t kRecordHeaderSize = 8;
+// Payload op byte for SetMeta with a non-string value: key, u8 type, u64 scalar bits. String
+// values keep the original SetMeta payload so older readers still replay them.
+constexpr uint8_t kTypedSetMetaOp = 13;
+
+bool Fail(const std::string& message, std::string* outError) {
+  if (outError != nullptr) {
+    *outError = message;
+  }
+  return false;
+}
+
+std::string MakeJournalHeader(uint64_t baseHash) {
+  std::string header(kJournalHeaderSize, '\0');
+  std::memcpy(&header[0], kJournalMagic, sizeof(kJournalMagic));
+  detail::StoreU64(&header[8], baseHash);
+  return header;
+}
+
+void AppendU32(std::string* out, uint32_t value) {
+  char bytes[4];
+  detail::StoreU32(bytes, value);
+  out->append(bytes, sizeof(bytes));
+}
+
+void AppendU64(std::string* out, uint64_t value) {
+  char bytes[8];
+  detail::StoreU64(bytes, value);
+  out->append(bytes, sizeof(bytes));
+}
+
+void AppendString(std::string* out, const std::string& text) {
+  AppendU32(out, static_cast<uint32_t>(text.size()));
+  out->append(text);
+}
+
+void EncodeRecord(const JournalRecord& record, std::string* out) {
+  const size_t start = out->size();
+  out->append(kRecordHeaderSize, '\0');
+  const bool typedMeta = record.op == JournalOp::SetMeta && !record.metaValue.isString();
+  const uint8_t op = typedMeta ? kTypedSetMetaOp : static_cast<uint8_t>(record.op);
+  out->push_back(static_cast<char>(op));
+
+  const Widget& widget = record.widget;
+  switch (record.op) {
+    case JournalOp::AddWidget:
+      AppendU32(out, record.index);
+      AppendU32(out, widget.id);
+      AppendString(out, ToString(widget.kind));
+      AppendU32(out, static_cast<uint32_t>(widget.boundsCells.x));
+      AppendU32(out, static_cast<uint32_t>(widget.boundsCells.y));
+      AppendU32(out, static_cast<uint32_t>(widget.boundsCells.w));
+      AppendU32(out, static_cast<uint32_t>(widget.boundsCells.h));
+      AppendString(out, widget.title);
+      break;
+    case JournalOp::RemoveWidget:
+      AppendU32(out, widget.id);
+      break;
+    case JournalOp::MoveWidget:
+      AppendU32(out, widget.id);
+      AppendU32(out, static_cast<uint32_t>(widget.boundsCells.x));
+      AppendU32(out, static_cast<uint32_t>(widget.boundsCells.y));
+      break;
+    case JournalOp::ResizeWidget:
+      AppendU32(out, widget.id);
+      AppendU32(out, static_cast<uint32_t>(widget.boundsCells.w));
+      AppendU32(out, static_cast<uint32_t>(widget.boundsCells.h));
+      break;
+    case JournalOp::SetMeta:
+      AppendString(out, record.key);
+      if (typedMeta) {
+        out->push_back(static_cast<char>(record.metaValue.type()));
+        AppendU64(out, record.metaValue.scalarBits());
+      } else {
+        AppendString(out, record.metaValue.text());
+      }
+      break;
+    case JournalOp::EraseMeta:
+      AppendString(out, record.key);
+      break;
+    case JournalOp::RetitleWidget:
+      AppendU32(out, widget.id);
+      AppendString(out, widget.title);
+      break;
+    case JournalOp::SetWidgetKind:
+      AppendU32(out, widget.id);
+      AppendString(out, ToString(widget.kind));
+      break;
+    case JournalOp::ReorderWidget:
+      AppendU32(out, widget.id);
+      AppendU32(out, record.index);
+      break;
+    case JournalOp::SetGrid:
+      AppendU32(out, static_cast<uint32_t>(record.gridWCells));
+      AppendU32(out, static_cast<uint32_t>(record.gridHCells));
+      break;
+    case JournalOp::SetSeed:
+      AppendU64(out, record.seed);
+      break;
+    case JournalOp::SetVersion:
+      AppendString(out, record.value);
+      break;
+  }
+
+  const std::string_view payload(out->data() + start + kRecordHeaderSize,
+                                 out->size() - start - kRecordHeaderSize);
+  detail::StoreU32(&(*out)[start], static_cast<uint32_t>(payload.size()));
+  detail::StoreU32(&(*out)[start + 4], HashBytes32(payload));
+}
+
+// Bounds-checked cursor over one record payload.
+class PayloadReader {
+ public:
+  explicit PayloadReader(std::string_view payload) : payload_(payload) {}
+
+  bool ReadU8(uint8_t* out) {
+    if (payload_.size() - pos_ < 1) {
+      return false;
+    }
+    *out = static_cast<uint8_t>(payload_[pos_++]);
+    return true;
+  }
+
+  bool ReadU32(uint32_t* out) {
+    if (payload_.size() - pos_ < 4) {
+      return false;
+    }
+    *out = detail::LoadU32(payload_.data() + pos_);
+    pos_ += 4;
+    return true;
+  }
+
+  bool ReadU64(uint64_t* out) {
+    if (payload_.size() - pos_ < 8) {
+      return false;
+    }
+    *out = detail::LoadU64(payload_.data() + pos_);
+    pos_ += 8;
+    return true;
+  }
+
+  bool ReadI32(int* out) {
+    uint32_t value = 0;
+    if (!ReadU32(&value)) {
+      return false;
+    }
+    *out = static_cast<int32_t>(value);
+    return true;
+  }
+
+  bool ReadString(std::string* out) {
+    uint32_t length = 0;
+    if (!ReadU32(&length) || payload_.size() - pos_ < length) {
+      return false;
+    }
+    out->assign(payload_.data() + pos_, length);
+    pos_ += length;
+    return true;
+  }
+
+  bool AtEnd() const { return pos_ == payload_.size(); }
+
+ private:
+  std::string_view payload_;
+  size_t pos_ = 0;
+};
+
+bool DecodeRecord(std::string_view payload, JournalRecord* outRecord, std::string* outError) {
+  PayloadReader reader(payload);
+  JournalRecord record;
+  uint8_t op = 0;
+  bool ok = reader.ReadU8(&op);
+  record.op = op == kTypedSetMetaOp ? JournalOp::SetMeta : static_cast<JournalOp>(op);
+
+  Widget& widget = record.widget;
+  switch (record.op) {
+    case JournalOp::AddWidget: {
+      std::string kindName;
+      ok = ok && reader.ReadU32(&record.index) && reader.ReadU32(&widget.id) &&
+           reader.ReadString(&kindName) && reader.ReadI32(&widget.boundsCells.x) &&
+           reader.ReadI32(&widget.boundsCells.y) && reader.ReadI32(&widget.boundsCells.w) &&
+           reader.ReadI32(&widget.boundsCells.h) && reader.ReadString(&widget.title);
+      if (ok && !ParseWidgetKind(kindName, &widget.kind)) {
+        return Fail("Unknown widget kind: " + kindName, outError);
+      }
+      break;
+    }
+    case JournalOp::RemoveWidget:
+      ok = ok && reader.ReadU32(&widget.id);
+      break;
+    case JournalOp::MoveWidget:
+      ok = ok && reader.ReadU32(&widget.id) && reader.ReadI32(&widget.boundsCells.x) &&
+           reader.ReadI32(&widget.boundsCells.y);
+      break;
+    case JournalOp::ResizeWidget:
+      ok = ok && reader.ReadU32(&widget.id) && reader.ReadI32(&widget.boundsCells.w) &&
+           reader.ReadI32(&widget.boundsCells.h);
+      break;
+    case JournalOp::SetMeta: {
+      if (op != kTypedSetMetaOp) {
+        std::string text;
+        ok = ok && reader.ReadString(&record.key) && reader.ReadString(&text);
+        record.metaValue = MetaValue(std::move(text));
+        break;
+      }
+      uint8_t type = 0;
+      uint64_t bits = 0;
+      ok = ok && reader.ReadString(&record.key) && reader.ReadU8(&type) && reader.ReadU64(&bits);
+      if (ok && (type == static_cast<uint8_t>(MetaType::String) ||
+                 type > static_cast<uint8_t>(MetaType::Float))) {
+        return Fail("unknown meta value type " + std::to_string(type), outError);
+      }
+      record.metaValue = MetaValue::FromScalarBits(static_cast<MetaType>(type), bits);
+      break;
+    }
+    case JournalOp::EraseMeta:
+      ok = ok && reader.ReadString(&record.key);
+      break;
+    case JournalOp::RetitleWidget:
+      ok = ok && reader.ReadU32(&widget.id) && reader.ReadString(&widget.title);
+      break;
+    case JournalOp::SetWidgetKind: {
+      std::string kindName;
+      ok = ok && reader.ReadU32(&widget.id) && reader.ReadString(&kindName);
+      if (ok && !ParseWidgetKind(kindName, &widget.kind)) {
+        return Fail("Unknown widget kind: " + kindName, outError);
+      }
+      break;
+    }
+    case JournalOp::ReorderWidget:
+      ok = ok && reader.ReadU32(&widget.id) && reader.ReadU32(&record.index);
+      break;
+    case JournalOp::SetGrid:
+      ok = ok && reader.ReadI32(&record.gridWCells) && reader.ReadI32(&record.gridHCells);
+      break;
+    case JournalOp::SetSeed:
+      ok = ok && reader.ReadU64(&record.seed);
+      break;
+    case JournalOp::SetVersion:
+      ok = ok && reader.ReadString(&record.value);
+      break;
+    default:
+      return Fail("unknown journal op " + std::to_string(op), outError);
+  }
+
+  if (!ok || !reader.AtEnd()) {
+    return Fail("malformed journal record", outError);
+  }
+  *outRecord = std::move(record);
+  return true;
+}
+
+}  // namespace
+
+JournalRecord MakeAddWidgetRecord(const Widget& widget, uint32_t index) {
+  JournalRecord record;
+  record.op = JournalOp::AddWidget;
+  record.widget = widget;
+  record.index = index;
+  return record;
+}
+
+JournalRecord MakeRemoveWidgetRecord(uint32_t id) {
+  JournalRecord record;
+  record.op = JournalOp::RemoveWidget;
+  record.widget.id = id;
+  return record;
+}
+
+JournalRecord MakeMoveWidgetRecord(uint32_t id, int x, int y) {
+  JournalRecord record;
+  record.op = JournalOp::MoveWidget;
+  record.widget.id = id;
+  record.widget.boundsCells.x = x;
+  record.widget.boundsCells.y = y;
+  return record;
+}
+
+JournalRecord MakeResizeWidgetRecord(uint32_t id, int w, int h) {
+  JournalRecord record;
+  record.op = JournalOp::ResizeWidget;
+  record.widget.id = id;
+  record.widget.boundsCells.w = w;
+  record.widget.boundsCells.h = h;
+  return record;
+}
+
+JournalRecord MakeSetMetaRecord(const std::string& key, const MetaValue& value) {
+  JournalRecord record;
+  record.op = JournalOp::SetMeta;
+  record.key = key;
+  record.metaValue = value;
+  return record;
+}
+
+JournalRecord MakeEraseMetaRecord(const std::string& key) {
+  JournalRecord record;
+  record.op = JournalOp::EraseMeta;
+  record.key = key;
+  return record;
+}
+
+JournalRecord MakeRetitleWidgetRecord(uint32_t id, const std::string& title) {
+  JournalRecord record;
+  record.op = JournalOp::RetitleWidget;
+  record.widget.id = id;
+  record.widget.title = title;
+  return record;
+}
+
+JournalRecord MakeSetWidgetKindRecord(uint32_t id, WidgetKind kind) {
+  JournalRecord record;
+  record.op = JournalOp::SetWidgetKind;
+  record.widget.id = id;
+  record.widget.kind = kind;
+  return record;
+}
+
+JournalRecord MakeReorderWidgetRecord(uint32_t id, uint32_t afterId) {
+  JournalRecord record;
+  record.op = JournalOp::ReorderWidget;
+  record.widget.id = id;
+  record.index = afterId;
+  return record;
+}
+
+JournalRecord MakeSetGridRecord(int gridWCells, int gridHCells) {
+  JournalRecord record;
+  record.op = JournalOp::SetGrid;
+  record.gridWCells = gridWCells;
+  record.gridHCells = gridHCells;
+  return record;
+}
+
+JournalRecord MakeSetSeedRecord(uint64_t seed) {
+  JournalRecord record;
+  record.op = JournalOp::SetSeed;
+  record.seed = seed;
+  return record;
+}
+
+JournalRecord MakeSetVersionRecord(const std::string& cgulVersion) {
+  JournalRecord record;
+  record.op = JournalOp::SetVersion;
+  record.value = cgulVersion;
+  return record;
+}
+
+std::string DescribeJournalRecord(const JournalRecord& record) {
+  const std::string id = std::to_string(record.widget.id);
+  const RectI& bounds = record.widget.boundsCells;
+  switch (record.op) {
+    case JournalOp::AddWidget:
+      return "add widget " + id + " (" + ToString(record.widget.kind) + ") at " +
+             std::to_string(bounds.x) + "," + std::to_string(bounds.y) + " size " +
+             std::to_string(bounds.w) + "x" + std::to_string(bounds.h);
+    case JournalOp::RemoveWidget:
+      return "remove widget " + id;
+    case JournalOp::MoveWidget:
+      return "move widget " + id + " to " + std::to_string(bounds.x) + "," +
+             std::to_string(bounds.y);
+    case JournalOp::ResizeWidget:
+      return "resize widget " + id + " to " + std::to_string(bounds.w) + "x" +
+             std::to_string(bounds.h);
+    case JournalOp::SetMeta:
+      return "set meta \"" + record.key + "\" = " + ToString(record.metaValue);
+    case JournalOp::EraseMeta:
+      return "erase meta \"" + record.key + "\"";
+    case JournalOp::RetitleWidget:
+      return "retitle widget " + id + " to \"" + record.widget.title + "\"";
+    case JournalOp::SetWidgetKind:
+      return "change widget " + id + " kind to " + ToString(record.widget.kind);
+    case JournalOp::ReorderWidget:
+      return record.index == 0 ? "reorder widget " + id + " to the front"
+                               : "reorder widget " + id + " after " +
+                                     std::to_string(record.index);
+    case JournalOp::SetGrid:
+      return "set grid to " + std::to_string(record.gridWCells) + "x" +
+             std::to_string(record.gridHCells);
+    case JournalOp::SetSeed:
+      return "set seed to " + std::to_string(record.seed);
+    case JournalOp::SetVersion:
+      return "set cgulVersion to \"" + record.value + "\"";
+  }
+  return "unknown journal op";
+}
+
+void EncodeJournalRecords(const std::vector<JournalRecord>& records, std::string* outBytes) {
+  outBytes->clear();
+  for (const JournalRecord& record : records) {
+    EncodeRecord(record, outBytes);
+  }
+}
+
+bool DecodeJournalRecords(std::string_view bytes, std::vector<JournalRecord>* outRecords,
+                          std::string* outError) {
+  if (outError != nullptr) {
+    outError->clear();
+  }
+  if (outRecords == nullptr) {
+    return Fail("outRecords must not be null", outError);
+  }
+
+  std::vector<JournalRecord> records;
+  size_t pos = 0;
+  while (pos < bytes.size()) {
+    if (bytes.size() - pos < kRecordHeaderSize ||
+        bytes.size() - pos - kRecordHeaderSize < detail::LoadU32(bytes.data() + pos)) {
+      return Fail("truncated record " + std::to_string(records.size()), outError);
+    }
+    const uint32_t length = detail::LoadU32(bytes.data() + pos);
+    const std::string_view payload = bytes.substr(pos + kRecordHeaderSize, length);
+    if (HashBytes32(payload) != detail::LoadU32(bytes.data() + pos + 4)) {
+      return Fail("checksum mismatch in record " + std::to_string(records.size()), outError);
+    }
+    JournalRecord record;
+    std::string recordError;
+    if (!DecodeRecord(payload, &record, &recordError)) {
+      return Fail("record " + std::to_string(records.size()) + ": " + recordError, outError);
+    }
+    records.push_back(std::move(record));
+    pos += kRecordHeaderSize + length;
+  }
+  *outRecords = std::move(records);
+  return true;
+}
+
+bool ApplyJournalRecord(CgulDocument* doc, const JournalRecord& record, std::string* outError) {
+  if (doc == nullptr) {
+    if (outError != nullptr) {
+      *outError = "doc must not be null";
+    }
+    return false;
+  }
+  DocumentIndex index(doc);
+  return ApplyJournalRecord(&index, record, outError);
+}
+
+bool ApplyJournalRecord(DocumentIndex* index, const JournalRecord& record,
+                        std::string* outError) {
+  if (outError != nullptr) {
+    outError->clear();
+  }
+  if (index == nullptr || index->document() == nullptr) {
+    return Fail("index must not be null", outError);
+  }
+
+  const uint32_t id = record.widget.id;
+  switch (record.op) {
+    case JournalOp::AddWidget: {
+      std::string insertError;
+      if (!index->Insert(record.index, record.widget, &insertError)) {
+        return Fail("journal edit cannot add widget: " + insertError, outError);
+      }
+      return true;
+    }
+    case JournalOp::RemoveWidget:
+      if (!index->Remove(id)) {
+        break;
+      }
+      return true;
+    case JournalOp::MoveWidget:
+    case JournalOp::ResizeWidget: {
+      const Widget* widget = index->Find(id);
+      if (widget == nullptr) {
+        break;
+      }
+      RectI bounds = widget->boundsCells;
+      if (record.op == JournalOp::MoveWidget) {
+        bounds.x = record.widget.boundsCells.x;
+        bounds.y = record.widget.boundsCells.y;
+      } else {
+        bounds.w = record.widget.boundsCells.w;
+        bounds.h = record.widget.boundsCells.h;
+      }
+      index->SetBounds(id, bounds);
+      return true;
+    }
+    case JournalOp::SetMeta:
+      index->SetMeta(record.key, record.metaValue);
+      return true;
+    case JournalOp::EraseMeta:
+      index->EraseMeta(record.key);
+      return true;
+    case JournalOp::RetitleWidget:
+      if (!index->SetTitle(id, record.widget.title)) {
+        break;
+      }
+      return true;
+    case JournalOp::SetWidgetKind:
+      if (!index->SetKind(id, record.widget.kind)) {
+        break;
+      }
+      return true;
+    case JournalOp::ReorderWidget: {
+      const size_t from = index->IndexOf(id);
+      if (from == DocumentIndex::kNotFound) {
+        break;
+      }
+      if (record.index == 0) {
+        index->MoveTo(id, 0);
+        return true;
+      }
+      const size_t anchor = index->IndexOf(record.index);
+      if (anchor == DocumentIndex::kNotFound || anchor == from) {
+        return Fail("journal edit orders after invalid widget id " +
+                        std::to_string(record.index),
+                    outError);
+      }
+      index->MoveTo(id, from < anchor ? anchor : anchor + 1);
+      return true;
+    }
+    case JournalOp::SetGrid:
+      index->SetGrid(record.gridWCells, record.gridHCells);
+      return true;
+    case JournalOp::SetSeed:
+      index->SetSeed(record.seed);
+      return true;
+    case JournalOp::SetVersion:
+      index->SetVersion(record.value);
+      return true;
+  }
+  return Fail("journal edit targets missing widget id " + std::to_string(id), outError);
+}
+
+CgulJournal::~CgulJournal() {
+  Close();
+}
+
+std::string CgulJournal::JournalPathFor(const std::string& basePath) {
+  return basePath + ".journal";
+}
+
+bool CgulJournal::Open(const std::string& basePath, CgulDocument* outDoc, std::string* outError) {
+  if (outError != nullptr) {
+    outError->clear();
+  }
+  if (outDoc == nullptr) {
+    return Fail("outDoc must not be null", outError);
+  }
+  Close();
+
+  detail::MappedFile base;
+  if (!base.Open(basePath, outError)) {
+    return false;
+  }
+  CgulDocument doc;
+  if (!LoadCgulFromBuffer(base.view(), &doc, outError)) {
+    return false;
+  }
+  DocumentIndex index(&doc);
+  const uint64_t baseHash = HashBytes64(base.view());
+  const uint64_t baseBytes = base.view().size();
+  base.Close();
+
+  const std::string journalPath = JournalPathFor(basePath);
+  detail::FileWriteOptions writeOptions;
+  writeOptions.syncToDisk = options_.fsync;
+  std::string validPrefix = MakeJournalHeader(baseHash);
+
+  detail::MappedFile journal;
+  std::string ignored;
+  if (journal.Open(journalPath, &ignored)) {
+    const std::string_view bytes = journal.view();
+    if (bytes.size() < kJournalHeaderSize ||
+        std::memcmp(bytes.data(), kJournalMagic, sizeof(kJournalMagic)) != 0) {
+      return Fail("Invalid journal file: " + journalPath, outError);
+    }
+
+    // A hash mismatch means the base was rewritten after this journal was started (an
+    // interrupted compaction); its edits are already in the base.
+    if (detail::LoadU64(bytes.data() + 8) == baseHash) {
+      size_t pos = kJournalHeaderSize;
+      size_t recordIndex = 0;
+      while (bytes.size() - pos >= kRecordHeaderSize) {
+        const uint32_t length = detail::LoadU32(bytes.data() + pos);
+        const uint32_t checksum = detail::LoadU32(bytes.data() + pos + 4);
+        if (bytes.size() - pos - kRecordHeaderSize < length) {
+          break;
+        }
+        const std::string_view payload = bytes.substr(pos + kRecordHeaderSize, length);
+        if (HashBytes32(payload) != checksum) {
+          // Only the final record can be torn by an interrupted append; damage with records
+          // after it is corruption, and truncating there would drop valid edits.
+          if (pos + kRecordHeaderSize + length == bytes.size()) {
+            break;
+          }
+          return Fail("Journal " + journalPath + ": checksum mismatch in record " +
+                          std::to_string(recordIndex),
+                      outError);
+        }
+
+        JournalRecord record;
+        std::string recordError;
+        if (!DecodeRecord(payload, &record, &recordError) ||
+            !ApplyJournalRecord(&index, record, &recordError)) {
+          return Fail("Journal record " + std::to_string(recordIndex) + " in " + journalPath +
+                          ": " + recordError,
+                      outError);
+        }
+        pos += kRecordHeaderSize + length;
+        ++recordIndex;
+      }
+      validPrefix.assign(bytes.data(), pos);
+    }
+
+    if (validPrefix.size() == bytes.size() &&
+        std::memcmp(validPrefix.data(), bytes.data(), bytes.size()) == 0) {
+      validPrefix.clear();
+    }
+  }
+  journal.Close();
+
+  // Start a journal for this base, or drop a stale journal or torn tail before appending.
+  if (!validPrefix.empty() &&
+      !detail::WriteFileContents(journalPath, validPrefix, writeOptions, outError)) {
+    return false;
+  }
+
+  basePath_ = basePath;
+  baseBytes_ = baseBytes;
+  if (!OpenForAppend(outError)) {
+    return false;
+  }
+  *outDoc = std::move(doc);
+  return true;
+}
+
+bool CgulJournal::Create(const std::string& basePath, const CgulDocument& doc,
+                         std::string* outError) {
+  if (outError != nullptr) {
+    outError->clear();
+  }
+  const std::string path = basePath;
+  std::string text;
+  if (!SaveCgulToBuffer(doc, &text, outError)) {
+    return false;
+  }
+
+  // Base first: if the journal reset below never happens, the old journal no longer
+  // matches the new base hash and is ignored on the next open. A failed base write leaves
+  // the journal open and usable.
+  detail::FileWriteOptions writeOptions;
+  writeOptions.syncToDisk = options_.fsync;
+  if (!detail::WriteFileContents(path, text, writeOptions, outError)) {
+    return false;
+  }
+  Close();
+  if (!detail::WriteFileContents(JournalPathFor(path), MakeJournalHeader(HashBytes64(text)),
+                                 writeOptions, outError)) {
+    return false;
+  }
+
+  basePath_ = path;
+  baseBytes_ = text.size();
+  return OpenForAppend(outError);
+}
+
+void CgulJournal::Close() {
+  if (file_ != nullptr) {
+    std::fclose(file_);
+  }
+  file_ = nullptr;
+  journalBytes_ = 0;
+}
+
+bool CgulJournal::OpenForAppend(std::string* outError) {
+  const std::string journalPath = JournalPathFor(basePath_);
+  file_ = std::fopen(journalPath.c_str(), "ab");
+  if (file_ == nullptr) {
+    return Fail("Failed to open file for writing: " + journalPath, outError);
+  }
+  std::fseek(file_, 0, SEEK_END);
+  const long size = std::ftell(file_);
+  journalBytes_ = size > 0 ? static_cast<uint64_t>(size) : 0;
+  return true;
+}
+
+bool CgulJournal::Append(const JournalRecord& record, std::string* outError) {
+  if (outError != nullptr) {
+    outError->clear();
+  }
+  if (file_ == nullptr) {
+    return Fail("journal is not open", outError);
+  }
+
+  std::string bytes;
+  EncodeRecord(record, &bytes);
+  bool ok = std::fwrite(bytes.data(), 1, bytes.size(), file_) == bytes.size() &&
+            std::fflush(file_) == 0;
+  if (ok && options_.fsync) {
+#if defined(_WIN32)
+    ok = _commit(_fileno(file_)) == 0;
+#else
+    ok = ::fsync(fileno(file_)) == 0;
+#endif
+  }
+  if (!ok) {
+    // Cut off whatever part of the record reached the file so later appends stay replayable.
+    // If that fails the journal stays closed.
+    const std::string journalPath = JournalPathFor(basePath_);
+    const uint64_t goodBytes = journalBytes_;
+    Close();
+    std::error_code resizeError;
+    std::filesystem::resize_file(journalPath, goodBytes, resizeError);
+    if (!resizeError) {
+      OpenForAppend(nullptr);
+    }
+    return Fail("Failed to write file: " + journalPath, outError);
+  }
+  journalBytes_ += bytes.size();
+  return true;
+}
+
+bool CgulJournal::Compact(const CgulDocument& doc, std::string* outError) {
+  if (file_ == nullptr) {
+    return Fail("journal is not open", outError);
+  }
+  return Create(basePath_, doc, outError);
+}
+
+bool CgulJournal::NeedsCompaction() const {
+  const uint64_t recordBytes =
+      journalBytes_ > kJournalHeaderSize ? journalBytes_ - kJournalHeaderSize : 0;
+  return recordBytes > options_.compactMinBytes &&
+         static_cast<double>(recordBytes) > options_.compactRatio * static_cast<double>(baseBytes_);
+}
+
+bool CgulJournal::CompactIfNeeded(const CgulDocument& doc, std::string* outError) {
+  if (outError != nullptr) {
+    outError->clear();
+  }
+  return !NeedsCompaction() || Compact(doc, outError);
+}
+
+}  // namespace cgul
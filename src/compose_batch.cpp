@@ -0,0 +1,59 @@
+#include "cgul/render/compose_batch.h"
+
+#include <chrono>
+
+#include "cgul/render/layout_composer.h"
+#include "parallel_for.h"
+
+namespace cgul {
+
+namespace {
+
+double ElapsedMs(std::chrono::steady_clock::time_point start,
+                 std::chrono::steady_clock::time_point end) {
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+}  // namespace
+
+void ComposeBatch(const CgulDocument* docs, size_t count, const ComposeBatchCallback& callback,
+                  const ComposeBatchOptions& options, ComposeBatchReport* outReport) {
+  const auto batchStart = std::chrono::steady_clock::now();
+  const unsigned workers = detail::ResolveWorkerCount(options.threadCount, count);
+
+  std::vector<Frame> frames(workers);
+  std::vector<ComposeTiming> timings(outReport != nullptr ? count : 0);
+
+  detail::ParallelFor(count, workers, [&](size_t index, unsigned worker) {
+    Frame& frame = frames[worker];
+
+    const auto composeStart = std::chrono::steady_clock::now();
+    ComposeLayoutIntoFrame(docs[index], &frame);
+    const auto composeEnd = std::chrono::steady_clock::now();
+    if (callback) {
+      callback(index, frame);
+    }
+    const auto callbackEnd = std::chrono::steady_clock::now();
+
+    if (!timings.empty()) {
+      ComposeTiming& timing = timings[index];
+      timing.documentIndex = index;
+      timing.worker = worker;
+      timing.composeMs = ElapsedMs(composeStart, composeEnd);
+      timing.callbackMs = ElapsedMs(composeEnd, callbackEnd);
+    }
+  });
+
+  if (outReport != nullptr) {
+    outReport->threadCount = workers;
+    outReport->wallMs = ElapsedMs(batchStart, std::chrono::steady_clock::now());
+    outReport->documents = std::move(timings);
+  }
+}
+
+void ComposeBatch(const std::vector<CgulDocument>& docs, const ComposeBatchCallback& callback,
+                  const ComposeBatchOptions& options, ComposeBatchReport* outReport) {
+  ComposeBatch(docs.data(), docs.size(), callback, options, outReport);
+}
+
+}  // namespace cgul
@@ -0,0 +1,63 @@
+#include "cgul/core/content_hash.h"
+
+#include "hash.h"
+
+namespace cgul {
+
+namespace {
+
+// Separate domains keep a widget, a meta entry and a document root from colliding by
+// construction.
+constexpr uint64_t kWidgetDomain = 0x6367756C2D776467ULL;  // "cgul-wdg"
+constexpr uint64_t kMetaDomain = 0x6367756C2D6D6574ULL;    // "cgul-met"
+constexpr uint64_t kDocumentDomain = 0x6367756C2D646F63ULL;  // "cgul-doc"
+
+}  // namespace
+
+uint64_t HashWidget(const Widget& widget) {
+  detail::Hasher hasher(kWidgetDomain);
+  hasher.Add(widget.id);
+  hasher.AddString(ToString(widget.kind));
+  hasher.Add(static_cast<uint32_t>(widget.boundsCells.x));
+  hasher.Add(static_cast<uint32_t>(widget.boundsCells.y));
+  hasher.Add(static_cast<uint32_t>(widget.boundsCells.w));
+  hasher.Add(static_cast<uint32_t>(widget.boundsCells.h));
+  hasher.AddString(widget.title);
+  return hasher.value();
+}
+
+uint64_t HashDocument(const CgulDocument& doc) {
+  uint64_t widgetHashSum = 0;
+  for (const Widget& widget : doc.widgets) {
+    widgetHashSum += HashWidget(widget);
+  }
+  return HashDocumentFromWidgetSum(doc, widgetHashSum);
+}
+
+uint64_t HashDocumentFromWidgetSum(const CgulDocument& doc, uint64_t widgetHashSum) {
+  uint64_t metaHashSum = 0;
+  for (const auto& entry : doc.meta) {
+    detail::Hasher hasher(kMetaDomain);
+    hasher.AddString(entry.first);
+    hasher.Add(static_cast<uint64_t>(entry.second.type()));
+    if (entry.second.isString()) {
+      hasher.AddString(entry.second.text());
+    } else {
+      hasher.Add(entry.second.scalarBits());
+    }
+    metaHashSum += hasher.value();
+  }
+
+  detail::Hasher root(kDocumentDomain);
+  root.AddString(doc.cgulVersion);
+  root.Add(static_cast<uint32_t>(doc.gridWCells));
+  root.Add(static_cast<uint32_t>(doc.gridHCells));
+  root.Add(doc.seed);
+  root.Add(doc.widgets.size());
+  root.Add(widgetHashSum);
+  root.Add(doc.meta.size());
+  root.Add(metaHashSum);
+  return root.value();
+}
+
+}  // namespace cgul
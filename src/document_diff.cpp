@@ -0,0 +1,193 @@
+#include "cgul/core/document_diff.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace cgul {
+
+namespace {
+
+// Appends past the end of doc.widgets.
+constexpr uint32_t kAppendIndex = UINT32_MAX;
+
+bool Fail(const std::string& message, std::string* outError) {
+  if (outError != nullptr) {
+    *outError = message;
+  }
+  return false;
+}
+
+bool IndexWidgetIds(const CgulDocument& doc, const char* which, WidgetIdMap* ids,
+                    std::string* outError) {
+  ids->Reserve(doc.widgets.size());
+  for (size_t i = 0; i < doc.widgets.size(); ++i) {
+    const uint32_t id = doc.widgets[i].id;
+    if (id == 0) {
+      return Fail(std::string(which) + " document has a zero widget id (index " +
+                      std::to_string(i) + ")",
+                  outError);
+    }
+    if (!ids->Insert(id, i)) {
+      return Fail(std::string(which) + " document has duplicate widget id " + std::to_string(id),
+                  outError);
+    }
+  }
+  return true;
+}
+
+// Flags the members of one longest strictly increasing subsequence of `values`.
+std::vector<bool> LongestIncreasingRun(const std::vector<uint32_t>& values) {
+  std::vector<size_t> tails;  // index of the smallest tail of each run length
+  std::vector<size_t> previous(values.size(), SIZE_MAX);
+  for (size_t i = 0; i < values.size(); ++i) {
+    const auto slot = std::lower_bound(
+        tails.begin(), tails.end(), values[i],
+        [&values](size_t index, uint32_t value) { return values[index] < value; });
+    if (slot != tails.begin()) {
+      previous[i] = *(slot - 1);
+    }
+    if (slot == tails.end()) {
+      tails.push_back(i);
+    } else {
+      *slot = i;
+    }
+  }
+
+  std::vector<bool> inRun(values.size(), false);
+  for (size_t i = tails.empty() ? SIZE_MAX : tails.back(); i != SIZE_MAX; i = previous[i]) {
+    inRun[i] = true;
+  }
+  return inRun;
+}
+
+void DiffMeta(const MetaMap& from, const MetaMap& to, DocumentPatch* patch) {
+  auto a = from.begin();
+  auto b = to.begin();
+  while (a != from.end() || b != to.end()) {
+    if (b == to.end() || (a != from.end() && a->first < b->first)) {
+      patch->push_back(MakeEraseMetaRecord(a->first));
+      ++a;
+    } else if (a == from.end() || b->first < a->first) {
+      patch->push_back(MakeSetMetaRecord(b->first, b->second));
+      ++b;
+    } else {
+      if (a->second != b->second) {
+        patch->push_back(MakeSetMetaRecord(b->first, b->second));
+      }
+      ++a;
+      ++b;
+    }
+  }
+}
+
+void DiffWidget(const Widget& from, const Widget& to, DocumentPatch* patch) {
+  if (from.kind != to.kind) {
+    patch->push_back(MakeSetWidgetKindRecord(to.id, to.kind));
+  }
+  if (from.boundsCells.x != to.boundsCells.x || from.boundsCells.y != to.boundsCells.y) {
+    patch->push_back(MakeMoveWidgetRecord(to.id, to.boundsCells.x, to.boundsCells.y));
+  }
+  if (from.boundsCells.w != to.boundsCells.w || from.boundsCells.h != to.boundsCells.h) {
+    patch->push_back(MakeResizeWidgetRecord(to.id, to.boundsCells.w, to.boundsCells.h));
+  }
+  if (from.title != to.title) {
+    patch->push_back(MakeRetitleWidgetRecord(to.id, to.title));
+  }
+}
+
+}  // namespace
+
+bool DiffDocuments(const CgulDocument& from, const CgulDocument& to, DocumentPatch* outPatch,
+                   std::string* outError) {
+  if (outError != nullptr) {
+    outError->clear();
+  }
+  if (outPatch == nullptr) {
+    return Fail("outPatch must not be null", outError);
+  }
+  outPatch->clear();
+
+  WidgetIdMap fromIds;
+  WidgetIdMap toIds;
+  if (!IndexWidgetIds(from, "from", &fromIds, outError) ||
+      !IndexWidgetIds(to, "to", &toIds, outError)) {
+    return false;
+  }
+
+  DocumentPatch& patch = *outPatch;
+  if (from.cgulVersion != to.cgulVersion) {
+    patch.push_back(MakeSetVersionRecord(to.cgulVersion));
+  }
+  if (from.gridWCells != to.gridWCells || from.gridHCells != to.gridHCells) {
+    patch.push_back(MakeSetGridRecord(to.gridWCells, to.gridHCells));
+  }
+  if (from.seed != to.seed) {
+    patch.push_back(MakeSetSeedRecord(to.seed));
+  }
+  DiffMeta(from.meta, to.meta, &patch);
+
+  // Target positions of the kept widgets, in their current order. Widgets on a longest
+  // increasing run already sit in the right relative order and never move.
+  std::vector<uint32_t> keptTargets;
+  keptTargets.reserve(std::min(from.widgets.size(), to.widgets.size()));
+  for (const Widget& widget : from.widgets) {
+    const size_t target = toIds.Find(widget.id);
+    if (target == WidgetIdMap::kNotFound) {
+      patch.push_back(MakeRemoveWidgetRecord(widget.id));
+    } else {
+      keptTargets.push_back(static_cast<uint32_t>(target));
+    }
+  }
+  const std::vector<bool> inRun = LongestIncreasingRun(keptTargets);
+  std::vector<bool> staysInPlace(to.widgets.size(), false);
+  for (size_t i = 0; i < keptTargets.size(); ++i) {
+    staysInPlace[keptTargets[i]] = inRun[i];
+  }
+
+  // Additions after the last kept widget are appended in order and need no reordering.
+  size_t trailingAdds = to.widgets.size();
+  while (trailingAdds > 0 && fromIds.Find(to.widgets[trailingAdds - 1].id) ==
+                                 WidgetIdMap::kNotFound) {
+    --trailingAdds;
+  }
+
+  // Walking `to` in order and placing every other widget directly after its predecessor
+  // leaves all widgets in target order once the walk ends.
+  for (size_t i = 0; i < to.widgets.size(); ++i) {
+    const Widget& widget = to.widgets[i];
+    const uint32_t afterId = i == 0 ? 0 : to.widgets[i - 1].id;
+    const size_t source = fromIds.Find(widget.id);
+    if (source == WidgetIdMap::kNotFound) {
+      patch.push_back(MakeAddWidgetRecord(widget, kAppendIndex));
+      if (i < trailingAdds) {
+        patch.push_back(MakeReorderWidgetRecord(widget.id, afterId));
+      }
+      continue;
+    }
+    DiffWidget(from.widgets[source], widget, &patch);
+    if (!staysInPlace[i]) {
+      patch.push_back(MakeReorderWidgetRecord(widget.id, afterId));
+    }
+  }
+  return true;
+}
+
+bool ApplyPatch(CgulDocument* doc, const DocumentPatch& patch, std::string* outError) {
+  if (outError != nullptr) {
+    outError->clear();
+  }
+  if (doc == nullptr) {
+    return Fail("doc must not be null", outError);
+  }
+
+  DocumentIndex index(doc);
+  std::string recordError;
+  for (size_t i = 0; i < patch.size(); ++i) {
+    if (!ApplyJournalRecord(&index, patch[i], &recordError)) {
+      return Fail("patch record " + std::to_string(i) + ": " + recordError, outError);
+    }
+  }
+  return true;
+}
+
+}  // namespace cgul
@@ -0,0 +1,56 @@
+#include "cgul/core/document_history.h"
+
+namespace cgul {
+
+DocumentHistory::DocumentHistory(size_t memoryLimitBytes) : memoryLimitBytes_(memoryLimitBytes) {
+  Reset(PersistentDocument());
+}
+
+void DocumentHistory::Reset(const PersistentDocument& doc) {
+  versions_.clear();
+  versions_.push_back(Version{doc, doc.MemoryBytes()});
+  cursor_ = 0;
+  memoryBytes_ = versions_.front().bytes;
+}
+
+void DocumentHistory::Commit(const PersistentDocument& doc) {
+  while (CanRedo()) {
+    memoryBytes_ -= versions_.back().bytes;
+    versions_.pop_back();
+  }
+  const size_t bytes = doc.BytesNotSharedWith(versions_.back().doc);
+  versions_.push_back(Version{doc, bytes});
+  memoryBytes_ += bytes;
+  ++cursor_;
+  Trim();
+}
+
+bool DocumentHistory::Undo() {
+  if (!CanUndo()) {
+    return false;
+  }
+  --cursor_;
+  return true;
+}
+
+bool DocumentHistory::Redo() {
+  if (!CanRedo()) {
+    return false;
+  }
+  ++cursor_;
+  return true;
+}
+
+void DocumentHistory::Trim() {
+  // Dropping the oldest version makes the next one the oldest, which is then charged in full
+  // for whatever it had shared with the dropped one.
+  while (memoryBytes_ > memoryLimitBytes_ && cursor_ > 0) {
+    memoryBytes_ -= versions_[0].bytes + versions_[1].bytes;
+    versions_.pop_front();
+    --cursor_;
+    versions_.front().bytes = versions_.front().doc.MemoryBytes();
+    memoryBytes_ += versions_.front().bytes;
+  }
+}
+
+}  // namespace cgul
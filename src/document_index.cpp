@@ -0,0 +1,420 @@
+#include "cgul/core/document_index.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include "cgul/core/content_hash.h"
+
+namespace cgul {
+
+namespace {
+
+constexpr size_t kMinCapacity = 16;
+// Change-log entries allowed beyond twice the widget count before it is compacted.
+constexpr size_t kMinChangeLog = 64;
+
+}  // namespace
+
+void WidgetIdMap::Clear() {
+  std::fill(slots_.begin(), slots_.end(), Slot{});
+  size_ = 0;
+}
+
+void WidgetIdMap::Reserve(size_t count) {
+  // Keep the load factor at or below 1/2 so probe sequences stay short.
+  size_t capacity = kMinCapacity;
+  while (capacity < count * 2) {
+    capacity *= 2;
+  }
+  if (capacity > slots_.size()) {
+    Rehash(capacity);
+  }
+}
+
+bool WidgetIdMap::Insert(uint32_t id, size_t position) {
+  if (id == 0) {
+    return false;
+  }
+  Reserve(size_ + 1);
+  size_t slot = SlotFor(id);
+  for (; slots_[slot].id != 0; slot = (slot + 1) & mask_) {
+    if (slots_[slot].id == id) {
+      return false;
+    }
+  }
+  slots_[slot] = Slot{id, static_cast<uint32_t>(position)};
+  ++size_;
+  return true;
+}
+
+void WidgetIdMap::Update(uint32_t id, size_t position) {
+  if (size_ == 0 || id == 0) {
+    return;
+  }
+  for (size_t slot = SlotFor(id); slots_[slot].id != 0; slot = (slot + 1) & mask_) {
+    if (slots_[slot].id == id) {
+      slots_[slot].position = static_cast<uint32_t>(position);
+      return;
+    }
+  }
+}
+
+bool WidgetIdMap::Erase(uint32_t id) {
+  if (size_ == 0 || id == 0) {
+    return false;
+  }
+  size_t hole = SlotFor(id);
+  while (slots_[hole].id != id) {
+    if (slots_[hole].id == 0) {
+      return false;
+    }
+    hole = (hole + 1) & mask_;
+  }
+
+  // Backward-shift deletion: pull later entries of the probe run into the hole unless that
+  // would move them before their home slot. No tombstones are needed.
+  for (size_t next = (hole + 1) & mask_; slots_[next].id != 0; next = (next + 1) & mask_) {
+    const size_t home = SlotFor(slots_[next].id);
+    if (((next - home) & mask_) >= ((next - hole) & mask_)) {
+      slots_[hole] = slots_[next];
+      hole = next;
+    }
+  }
+  slots_[hole] = Slot{};
+  --size_;
+  return true;
+}
+
+void WidgetIdMap::Rehash(size_t capacity) {
+  std::vector<Slot> old = std::move(slots_);
+  slots_.assign(capacity, Slot{});
+  mask_ = capacity - 1;
+  shift_ = 64;
+  for (size_t bits = capacity; bits > 1; bits >>= 1) {
+    --shift_;
+  }
+  for (const Slot& entry : old) {
+    if (entry.id != 0) {
+      size_t slot = SlotFor(entry.id);
+      while (slots_[slot].id != 0) {
+        slot = (slot + 1) & mask_;
+      }
+      slots_[slot] = entry;
+    }
+  }
+}
+
+DocumentIndex::DocumentIndex(CgulDocument* doc) {
+  Reset(doc, nullptr);
+}
+
+bool DocumentIndex::Reset(CgulDocument* doc, std::string* outError) {
+  doc_ = doc;
+  return Rebuild(outError);
+}
+
+bool DocumentIndex::Rebuild(std::string* outError) {
+  if (outError != nullptr) {
+    outError->clear();
+  }
+  ids_.Clear();
+  widgetHashValid_ = false;
+  ++revision_;
+  headerRevision_ = revision_;
+  changesFloor_ = revision_;
+  changes_.clear();
+  widgetRevisions_.clear();
+  if (doc_ == nullptr) {
+    return true;
+  }
+
+  widgetRevisions_.assign(doc_->widgets.size(), revision_);
+
+  ids_.Reserve(doc_->widgets.size());
+  bool ok = true;
+  for (size_t i = 0; i < doc_->widgets.size(); ++i) {
+    const uint32_t id = doc_->widgets[i].id;
+    if (!ids_.Insert(id, i) && ok) {
+      ok = false;
+      if (outError != nullptr) {
+        *outError = id == 0 ? "widget id must be non-zero (index " + std::to_string(i) + ")"
+                            : "duplicate widget id: " + std::to_string(id);
+      }
+    }
+  }
+  return ok;
+}
+
+const Widget* DocumentIndex::Find(uint32_t id) const {
+  const size_t position = ids_.Find(id);
+  return position == kNotFound ? nullptr : &doc_->widgets[position];
+}
+
+bool DocumentIndex::Add(const Widget& widget, std::string* outError) {
+  return Insert(doc_ == nullptr ? 0 : doc_->widgets.size(), widget, outError);
+}
+
+bool DocumentIndex::Insert(size_t position, const Widget& widget, std::string* outError) {
+  if (outError != nullptr) {
+    outError->clear();
+  }
+  auto fail = [outError](const std::string& message) {
+    if (outError != nullptr) {
+      *outError = message;
+    }
+    return false;
+  };
+  if (doc_ == nullptr) {
+    return fail("index has no document");
+  }
+  if (widget.id == 0) {
+    return fail("widget id must be non-zero");
+  }
+
+  position = std::min(position, doc_->widgets.size());
+  if (!ids_.Insert(widget.id, position)) {
+    return fail("duplicate widget id: " + std::to_string(widget.id));
+  }
+  doc_->widgets.insert(doc_->widgets.begin() + static_cast<std::ptrdiff_t>(position), widget);
+  Reindex(position + 1, doc_->widgets.size());
+  RememberWidgetHash(widget);
+  widgetRevisions_.insert(widgetRevisions_.begin() + static_cast<std::ptrdiff_t>(position), 0);
+  RecordChange(position);
+  return true;
+}
+
+bool DocumentIndex::Remove(uint32_t id) {
+  const size_t position = ids_.Find(id);
+  if (position == kNotFound) {
+    return false;
+  }
+  ids_.Erase(id);
+  ForgetWidgetHash(doc_->widgets[position]);
+  doc_->widgets.erase(doc_->widgets.begin() + static_cast<std::ptrdiff_t>(position));
+  widgetRevisions_.erase(widgetRevisions_.begin() + static_cast<std::ptrdiff_t>(position));
+  Reindex(position, doc_->widgets.size());
+  RecordRemoval(id);
+  return true;
+}
+
+bool DocumentIndex::MoveTo(uint32_t id, size_t position) {
+  const size_t from = ids_.Find(id);
+  if (from == kNotFound) {
+    return false;
+  }
+  std::vector<Widget>& widgets = doc_->widgets;
+  const size_t to = std::min(position, widgets.size() - 1);
+  const auto fromIt = widgets.begin() + static_cast<std::ptrdiff_t>(from);
+  const auto toIt = widgets.begin() + static_cast<std::ptrdiff_t>(to);
+  const auto revisionsFrom = widgetRevisions_.begin() + static_cast<std::ptrdiff_t>(from);
+  const auto revisionsTo = widgetRevisions_.begin() + static_cast<std::ptrdiff_t>(to);
+  if (from < to) {
+    std::rotate(fromIt, std::next(fromIt), std::next(toIt));
+    std::rotate(revisionsFrom, std::next(revisionsFrom), std::next(revisionsTo));
+    Reindex(from, to + 1);
+  } else if (to < from) {
+    std::rotate(toIt, fromIt, std::next(fromIt));
+    std::rotate(revisionsTo, revisionsFrom, std::next(revisionsFrom));
+    Reindex(to, from + 1);
+  } else {
+    return true;
+  }
+  RecordChange(to);
+  return true;
+}
+
+bool DocumentIndex::SetBounds(uint32_t id, const RectI& boundsCells) {
+  const size_t position = ids_.Find(id);
+  if (position == kNotFound) {
+    return false;
+  }
+  Widget& widget = doc_->widgets[position];
+  ForgetWidgetHash(widget);
+  widget.boundsCells = boundsCells;
+  RememberWidgetHash(widget);
+  RecordChange(position);
+  return true;
+}
+
+bool DocumentIndex::SetTitle(uint32_t id, const std::string& title) {
+  const size_t position = ids_.Find(id);
+  if (position == kNotFound) {
+    return false;
+  }
+  Widget& widget = doc_->widgets[position];
+  ForgetWidgetHash(widget);
+  widget.title = title;
+  RememberWidgetHash(widget);
+  RecordChange(position);
+  return true;
+}
+
+bool DocumentIndex::SetKind(uint32_t id, WidgetKind kind) {
+  const size_t position = ids_.Find(id);
+  if (position == kNotFound) {
+    return false;
+  }
+  Widget& widget = doc_->widgets[position];
+  ForgetWidgetHash(widget);
+  widget.kind = kind;
+  RememberWidgetHash(widget);
+  RecordChange(position);
+  return true;
+}
+
+void DocumentIndex::SetGrid(int gridWCells, int gridHCells) {
+  if (doc_ == nullptr) {
+    return;
+  }
+  doc_->gridWCells = gridWCells;
+  doc_->gridHCells = gridHCells;
+  headerRevision_ = ++revision_;
+}
+
+void DocumentIndex::SetSeed(uint64_t seed) {
+  if (doc_ == nullptr) {
+    return;
+  }
+  doc_->seed = seed;
+  headerRevision_ = ++revision_;
+}
+
+void DocumentIndex::SetVersion(const std::string& cgulVersion) {
+  if (doc_ == nullptr) {
+    return;
+  }
+  doc_->cgulVersion = cgulVersion;
+  headerRevision_ = ++revision_;
+}
+
+void DocumentIndex::SetMeta(const std::string& key, const MetaValue& value) {
+  if (doc_ == nullptr) {
+    return;
+  }
+  doc_->meta[key] = value;
+  headerRevision_ = ++revision_;
+}
+
+bool DocumentIndex::EraseMeta(const std::string& key) {
+  if (doc_ == nullptr || doc_->meta.erase(key) == 0) {
+    return false;
+  }
+  headerRevision_ = ++revision_;
+  return true;
+}
+
+uint64_t DocumentIndex::ContentHash() const {
+  if (doc_ == nullptr) {
+    return HashDocument(CgulDocument{});
+  }
+  if (!widgetHashValid_) {
+    widgetHashSum_ = 0;
+    for (const Widget& widget : doc_->widgets) {
+      widgetHashSum_ += HashWidget(widget);
+    }
+    widgetHashValid_ = true;
+  }
+  return HashDocumentFromWidgetSum(*doc_, widgetHashSum_);
+}
+
+uint64_t DocumentIndex::WidgetRevision(uint32_t id) const {
+  const size_t position = ids_.Find(id);
+  return position == kNotFound ? 0 : widgetRevisions_[position];
+}
+
+bool DocumentIndex::ChangedSince(uint64_t revision, DocumentChanges* outChanges) const {
+  if (outChanges == nullptr) {
+    return false;
+  }
+  outChanges->changed.clear();
+  outChanges->removed.clear();
+  outChanges->headerChanged = false;
+  if (revision < changesFloor_) {
+    return false;
+  }
+
+  outChanges->headerChanged = headerRevision_ > revision;
+  const auto first = std::upper_bound(
+      changes_.begin(), changes_.end(), revision,
+      [](uint64_t value, const Change& change) { return value < change.revision; });
+  for (auto it = first; it != changes_.end(); ++it) {
+    (Contains(it->id) ? outChanges->changed : outChanges->removed).push_back(it->id);
+  }
+  for (std::vector<uint32_t>* ids : {&outChanges->changed, &outChanges->removed}) {
+    std::sort(ids->begin(), ids->end());
+    ids->erase(std::unique(ids->begin(), ids->end()), ids->end());
+  }
+  return true;
+}
+
+void DocumentIndex::Reindex(size_t first, size_t last) {
+  for (size_t i = first; i < last; ++i) {
+    ids_.Update(doc_->widgets[i].id, i);
+  }
+}
+
+// The document hash sums widget hashes, so an edit swaps one term without touching the rest.
+void DocumentIndex::ForgetWidgetHash(const Widget& widget) {
+  if (widgetHashValid_) {
+    widgetHashSum_ -= HashWidget(widget);
+  }
+}
+
+void DocumentIndex::RememberWidgetHash(const Widget& widget) {
+  if (widgetHashValid_) {
+    widgetHashSum_ += HashWidget(widget);
+  }
+}
+
+void DocumentIndex::RecordChange(size_t position) {
+  ++revision_;
+  widgetRevisions_[position] = revision_;
+  changes_.push_back(Change{revision_, doc_->widgets[position].id});
+  if (changes_.size() > 2 * (doc_->widgets.size() + kMinChangeLog)) {
+    CompactChanges();
+  }
+}
+
+void DocumentIndex::RecordRemoval(uint32_t id) {
+  ++revision_;
+  changes_.push_back(Change{revision_, id});
+  if (changes_.size() > 2 * (doc_->widgets.size() + kMinChangeLog)) {
+    CompactChanges();
+  }
+}
+
+void DocumentIndex::CompactChanges() {
+  // A query only needs each id's latest change, so keep one entry per id.
+  WidgetIdMap seen;
+  seen.Reserve(changes_.size());
+  std::vector<Change> kept;
+  size_t removedCount = 0;
+  for (auto it = changes_.rbegin(); it != changes_.rend(); ++it) {
+    if (seen.Insert(it->id, 0)) {
+      kept.push_back(*it);
+      removedCount += Contains(it->id) ? 0 : 1;
+    }
+  }
+  std::reverse(kept.begin(), kept.end());
+
+  // Under id churn removed ids would pile up forever: forget the older half of them and raise
+  // the floor to the newest one forgotten.
+  if (removedCount > doc_->widgets.size() + kMinChangeLog) {
+    size_t toForget = removedCount / 2;
+    std::vector<Change> trimmed;
+    trimmed.reserve(kept.size() - toForget);
+    for (const Change& change : kept) {
+      if (toForget > 0 && !Contains(change.id)) {
+        --toForget;
+        changesFloor_ = change.revision;
+        continue;
+      }
+      trimmed.push_back(change);
+    }
+    kept.swap(trimmed);
+  }
+  changes_.swap(kept);
+}
+
+}  // namespace cgul
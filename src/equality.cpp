@@ -1,8 +1,10 @@
 #include "cgul/core/equality.h"
 
-#include <algorithm>
 #include <vector>
 
+#include "cgul/core/content_hash.h"
+#include "cgul/core/document_index.h"
+
 namespace cgul {
 
 namespace {
@@ -11,9 +13,32 @@ const std::string& NormalizeTitle(const Widget& widget) {
   return widget.title;
 }
 
-bool CompareWidgetId(const Widget& lhs, const Widget& rhs) {
-  return lhs.id < rhs.id;
-}
+// WidgetIdMap cannot hold id 0, which Equal still has to compare for unvalidated documents.
+class WidgetPositions {
+ public:
+  explicit WidgetPositions(const std::vector<Widget>& widgets) {
+    ids_.Reserve(widgets.size());
+    for (size_t i = 0; i < widgets.size() && duplicateId_ == nullptr; ++i) {
+      const uint32_t id = widgets[i].id;
+      const bool inserted = id != 0 ? ids_.Insert(id, i) : zeroPosition_ == kNotFound;
+      if (!inserted) {
+        duplicateId_ = &widgets[i].id;
+      } else if (id == 0) {
+        zeroPosition_ = i;
+      }
+    }
+  }
+
+  const uint32_t* duplicateId() const { return duplicateId_; }
+  size_t Find(uint32_t id) const { return id != 0 ? ids_.Find(id) : zeroPosition_; }
+
+  static constexpr size_t kNotFound = WidgetIdMap::kNotFound;
+
+ private:
+  WidgetIdMap ids_;
+  size_t zeroPosition_ = kNotFound;
+  const uint32_t* duplicateId_ = nullptr;
+};
 
 std::string RectToString(const RectI& rect) {
   return "x=" + std::to_string(rect.x) + ",y=" + std::to_string(rect.y) +
@@ -66,8 +91,8 @@ bool Equal(const CgulDocument& a, const CgulDocument& b, std::string* outDiff) {
       return fail("meta key missing: " + entry.first);
     }
     if (entry.second != it->second) {
-      return fail("meta value mismatch for key \"" + entry.first + "\": expected \"" +
-                  entry.second + "\" got \"" + it->second + "\"");
+      return fail("meta value mismatch for key \"" + entry.first + "\": expected " +
+                  ToString(entry.second) + " got " + ToString(it->second));
     }
   }
   if (a.widgets.size() != b.widgets.size()) {
@@ -75,29 +100,25 @@ bool Equal(const CgulDocument& a, const CgulDocument& b, std::string* outDiff) {
                 std::to_string(b.widgets.size()));
   }
 
-  std::vector<Widget> aWidgets = a.widgets;
-  std::vector<Widget> bWidgets = b.widgets;
-  std::sort(aWidgets.begin(), aWidgets.end(), CompareWidgetId);
-  std::sort(bWidgets.begin(), bWidgets.end(), CompareWidgetId);
-
-  for (size_t i = 1; i < aWidgets.size(); ++i) {
-    if (aWidgets[i - 1].id == aWidgets[i].id) {
-      return fail("expected document has duplicate widget id " +
-                  std::to_string(aWidgets[i].id));
-    }
-    if (bWidgets[i - 1].id == bWidgets[i].id) {
-      return fail("got document has duplicate widget id " + std::to_string(bWidgets[i].id));
-    }
+  // Widgets are matched by id, not by position: order does not affect equality.
+  const WidgetPositions aPositions(a.widgets);
+  if (aPositions.duplicateId() != nullptr) {
+    return fail("expected document has duplicate widget id " +
+                std::to_string(*aPositions.duplicateId()));
+  }
+  const WidgetPositions bPositions(b.widgets);
+  if (bPositions.duplicateId() != nullptr) {
+    return fail("got document has duplicate widget id " +
+                std::to_string(*bPositions.duplicateId()));
   }
 
-  for (size_t i = 0; i < aWidgets.size(); ++i) {
-    const Widget& expected = aWidgets[i];
-    const Widget& got = bWidgets[i];
-
-    if (expected.id != got.id) {
+  for (const Widget& expected : a.widgets) {
+    const size_t gotIndex = bPositions.Find(expected.id);
+    if (gotIndex == WidgetPositions::kNotFound) {
       return fail("widget id set mismatch: expected id " + std::to_string(expected.id) +
-                  " got id " + std::to_string(got.id));
+                  " missing from got document");
     }
+    const Widget& got = b.widgets[gotIndex];
 
     if (expected.kind != got.kind) {
       return fail("Widget " + std::to_string(expected.id) + " kind mismatch: expected " +
@@ -110,8 +131,8 @@ bool Equal(const CgulDocument& a, const CgulDocument& b, std::string* outDiff) {
                   RectToString(got.boundsCells));
     }
 
-    const std::string expectedTitle = NormalizeTitle(expected);
-    const std::string gotTitle = NormalizeTitle(got);
+    const std::string& expectedTitle = NormalizeTitle(expected);
+    const std::string& gotTitle = NormalizeTitle(got);
     if (expectedTitle != gotTitle) {
       return fail("Widget " + std::to_string(expected.id) + " title mismatch: expected \"" +
                   expectedTitle + "\" got \"" + gotTitle + "\"");
@@ -121,4 +142,14 @@ bool Equal(const CgulDocument& a, const CgulDocument& b, std::string* outDiff) {
   return true;
 }
 
+bool Equal(const DocumentIndex& a, const DocumentIndex& b, std::string* outDiff) {
+  const CgulDocument empty;
+  const CgulDocument& docA = a.document() != nullptr ? *a.document() : empty;
+  const CgulDocument& docB = b.document() != nullptr ? *b.document() : empty;
+  if (outDiff == nullptr && a.ContentHash() != b.ContentHash()) {
+    return false;
+  }
+  return Equal(docA, docB, outDiff);
+}
+
 }  // namespace cgul
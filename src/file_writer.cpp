@@ -0,0 +1,189 @@
+#include "file_writer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace cgul {
+namespace detail {
+
+namespace {
+
+constexpr int kMaxTempNameAttempts = 16;
+
+bool Fail(const std::string& message, const std::string& path, std::string* outError) {
+  if (outError != nullptr) {
+    *outError = message + path;
+  }
+  return false;
+}
+
+std::string TempPathFor(const std::string& path, unsigned long processId) {
+  static std::atomic<uint32_t> counter{0};
+  return path + ".tmp." + std::to_string(processId) + "." + std::to_string(counter++);
+}
+
+}  // namespace
+
+#if defined(_WIN32)
+
+namespace {
+
+bool WriteAll(HANDLE file, std::string_view data) {
+  while (!data.empty()) {
+    const DWORD chunk = static_cast<DWORD>(std::min<size_t>(data.size(), 1u << 30));
+    DWORD written = 0;
+    if (!WriteFile(file, data.data(), chunk, &written, nullptr) || written == 0) {
+      return false;
+    }
+    data.remove_prefix(written);
+  }
+  return true;
+}
+
+}  // namespace
+
+bool WriteFileStreamed(const std::string& path,
+                       const std::function<bool(const FileChunkWriter& write)>& produce,
+                       const FileWriteOptions& options, std::string* outError) {
+  std::string target = path;
+  HANDLE file = INVALID_HANDLE_VALUE;
+  if (options.atomicReplace) {
+    for (int attempt = 0; attempt < kMaxTempNameAttempts && file == INVALID_HANDLE_VALUE;
+         ++attempt) {
+      target = TempPathFor(path, GetCurrentProcessId());
+      file = CreateFileA(target.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_NEW,
+                         FILE_ATTRIBUTE_NORMAL, nullptr);
+      if (file == INVALID_HANDLE_VALUE && GetLastError() != ERROR_FILE_EXISTS) {
+        break;
+      }
+    }
+  } else {
+    file = CreateFileA(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                       FILE_ATTRIBUTE_NORMAL, nullptr);
+  }
+  if (file == INVALID_HANDLE_VALUE) {
+    return Fail("Failed to open file for writing: ", path, outError);
+  }
+
+  const bool written =
+      produce([file](std::string_view chunk) { return WriteAll(file, chunk); }) &&
+      (!options.syncToDisk || FlushFileBuffers(file));
+  CloseHandle(file);
+  if (!written) {
+    if (options.atomicReplace) {
+      DeleteFileA(target.c_str());
+    }
+    return Fail("Failed to write file: ", path, outError);
+  }
+
+  if (options.atomicReplace) {
+    const DWORD flags =
+        MOVEFILE_REPLACE_EXISTING | (options.syncToDisk ? MOVEFILE_WRITE_THROUGH : 0);
+    if (!MoveFileExA(target.c_str(), path.c_str(), flags)) {
+      DeleteFileA(target.c_str());
+      return Fail("Failed to replace file: ", path, outError);
+    }
+  }
+  return true;
+}
+
+#else
+
+namespace {
+
+bool WriteAll(int fd, std::string_view data) {
+  while (!data.empty()) {
+    const ssize_t written = ::write(fd, data.data(), data.size());
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data.remove_prefix(static_cast<size_t>(written));
+  }
+  return true;
+}
+
+// Makes the rename itself durable; failures are ignored where directories cannot be synced.
+void SyncParentDirectory(const std::string& path) {
+  const size_t slash = path.find_last_of('/');
+  const std::string dir = slash == std::string::npos ? "." : path.substr(0, slash + 1);
+  const int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+  if (fd >= 0) {
+    ::fsync(fd);
+    ::close(fd);
+  }
+}
+
+}  // namespace
+
+bool WriteFileStreamed(const std::string& path,
+                       const std::function<bool(const FileChunkWriter& write)>& produce,
+                       const FileWriteOptions& options, std::string* outError) {
+  std::string target = path;
+  int fd = -1;
+  if (options.atomicReplace) {
+    for (int attempt = 0; attempt < kMaxTempNameAttempts && fd < 0; ++attempt) {
+      target = TempPathFor(path, static_cast<unsigned long>(::getpid()));
+      fd = ::open(target.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+      if (fd < 0 && errno != EEXIST) {
+        break;
+      }
+    }
+    struct stat existing {};
+    if (fd >= 0 && ::stat(path.c_str(), &existing) == 0) {
+      ::fchmod(fd, existing.st_mode & 07777);
+    }
+  } else {
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+  }
+  if (fd < 0) {
+    return Fail("Failed to open file for writing: ", path, outError);
+  }
+
+  const bool written = produce([fd](std::string_view chunk) { return WriteAll(fd, chunk); }) &&
+                       (!options.syncToDisk || ::fsync(fd) == 0);
+  const bool closed = ::close(fd) == 0;
+  if (!written || !closed) {
+    if (options.atomicReplace) {
+      ::unlink(target.c_str());
+    }
+    return Fail("Failed to write file: ", path, outError);
+  }
+
+  if (options.atomicReplace) {
+    if (::rename(target.c_str(), path.c_str()) != 0) {
+      ::unlink(target.c_str());
+      return Fail("Failed to replace file: ", path, outError);
+    }
+    if (options.syncToDisk) {
+      SyncParentDirectory(path);
+    }
+  }
+  return true;
+}
+
+#endif
+
+bool WriteFileContents(const std::string& path, std::string_view data,
+                       const FileWriteOptions& options, std::string* outError) {
+  return WriteFileStreamed(
+      path, [data](const FileChunkWriter& write) { return write(data); }, options, outError);
+}
+
+}  // namespace detail
+}  // namespace cgul
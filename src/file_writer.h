@@ -0,0 +1,33 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace cgul {
+namespace detail {
+
+struct FileWriteOptions {
+  // Write a temporary file in the destination directory and rename it over `path`.
+  bool atomicReplace = true;
+  // Flush the data (and, for atomic replace, the rename) to stable storage.
+  bool syncToDisk = false;
+};
+
+// Writes `data` as the full contents of `path`. With atomicReplace, readers see either the
+// old file or the new one, and an existing file keeps its permission bits.
+bool WriteFileContents(const std::string& path, std::string_view data,
+                       const FileWriteOptions& options, std::string* outError);
+
+// Receives the next piece of the file contents; returns false if the write failed.
+using FileChunkWriter = std::function<bool(std::string_view chunk)>;
+
+// Same guarantees as WriteFileContents, but `produce` emits the contents in pieces through the
+// writer it is given, so encoded output can be streamed to disk without buffering it whole.
+// Returning false from `produce` abandons the write and leaves any existing file untouched.
+bool WriteFileStreamed(const std::string& path,
+                       const std::function<bool(const FileChunkWriter& write)>& produce,
+                       const FileWriteOptions& options, std::string* outError);
+
+}  // namespace detail
+}  // namespace cgul
@@ -22,6 +22,12 @@ void Frame::clear(char32_t glyph) {
   }
 }
 
+void Frame::resize(int w, int h) {
+  width = w;
+  height = h;
+  cells.resize(static_cast<size_t>(w*h));
+}
+
 static bool in_bounds(const Frame& f, int x, int y) {
   return x >= 0 && y >= 0 && x < f.width && y < f.height;
 }
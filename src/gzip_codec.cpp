@@ -0,0 +1,177 @@
+#include "gzip_codec.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#if defined(CGUL_HAVE_ZLIB)
+#include <zlib.h>
+#endif
+
+#include "byte_order.h"
+
+namespace cgul {
+namespace detail {
+
+namespace {
+
+bool Fail(const std::string& message, std::string* outError) {
+  if (outError != nullptr) {
+    *outError = message;
+  }
+  return false;
+}
+
+}  // namespace
+
+bool IsGzipData(std::string_view bytes) {
+  return bytes.size() >= 2 && static_cast<unsigned char>(bytes[0]) == 0x1f &&
+         static_cast<unsigned char>(bytes[1]) == 0x8b;
+}
+
+#if defined(CGUL_HAVE_ZLIB)
+
+namespace {
+
+// zlib counts in uInt; larger inputs are fed in slices of this size.
+constexpr size_t kMaxZlibChunk = size_t{1} << 30;
+constexpr size_t kDeflateBufferSize = 256 * 1024;
+// windowBits 15 plus 16 selects the gzip wrapper.
+constexpr int kGzipWindowBits = 15 + 16;
+constexpr int kDeflateMemLevel = 8;
+
+// The trailer's ISIZE is the last member's size mod 2^32: exact for the single-member files we
+// write, and only a hint otherwise. It is capped by deflate's best-case ratio so a corrupt
+// trailer cannot force a huge reservation.
+size_t ExpectedInflatedSize(std::string_view compressed) {
+  if (compressed.size() < 18) {
+    return 0;
+  }
+  const size_t hinted = LoadU32(compressed.data() + compressed.size() - 4);
+  return std::min(hinted, compressed.size() * 1032);
+}
+
+}  // namespace
+
+bool GunzipToString(std::string_view compressed, std::string* outText, std::string* outError) {
+  outText->clear();
+  outText->reserve(ExpectedInflatedSize(compressed));
+
+  z_stream stream{};
+  if (inflateInit2(&stream, kGzipWindowBits) != Z_OK) {
+    return Fail("Failed to initialize gzip decompression", outError);
+  }
+
+  const auto* next = reinterpret_cast<const Bytef*>(compressed.data());
+  size_t remaining = compressed.size();
+  int status = Z_OK;
+  while (true) {
+    if (stream.avail_in == 0 && remaining > 0) {
+      const size_t slice = std::min(remaining, kMaxZlibChunk);
+      stream.next_in = const_cast<Bytef*>(next);
+      stream.avail_in = static_cast<uInt>(slice);
+      next += slice;
+      remaining -= slice;
+    }
+
+    if (outText->size() == outText->capacity()) {
+      outText->reserve(std::max<size_t>(outText->capacity() * 2, 64 * 1024));
+    }
+    const size_t used = outText->size();
+    const size_t room = std::min(outText->capacity() - used, kMaxZlibChunk);
+    outText->resize(used + room);
+    stream.next_out = reinterpret_cast<Bytef*>(&(*outText)[used]);
+    stream.avail_out = static_cast<uInt>(room);
+
+    status = inflate(&stream, Z_NO_FLUSH);
+    outText->resize(used + (room - stream.avail_out));
+
+    if (status == Z_STREAM_END) {
+      // Concatenated members (as `cat a.gz b.gz` produces) decode to concatenated text.
+      if (stream.avail_in == 0 && remaining == 0) {
+        break;
+      }
+      if (inflateReset(&stream) != Z_OK) {
+        break;
+      }
+      continue;
+    }
+    if (status == Z_BUF_ERROR && stream.avail_in == 0 && remaining == 0) {
+      break;
+    }
+    if (status != Z_OK && status != Z_BUF_ERROR) {
+      break;
+    }
+  }
+  inflateEnd(&stream);
+
+  if (status != Z_STREAM_END) {
+    outText->clear();
+    return Fail(status == Z_BUF_ERROR ? "Truncated gzip data" : "Corrupt gzip data", outError);
+  }
+  return true;
+}
+
+bool WriteGzipFile(const std::string& path, std::string_view data,
+                   const FileWriteOptions& options, std::string* outError) {
+  z_stream stream{};
+  if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, kGzipWindowBits,
+                   kDeflateMemLevel, Z_DEFAULT_STRATEGY) != Z_OK) {
+    return Fail("Failed to initialize gzip compression", outError);
+  }
+
+  std::string buffer(kDeflateBufferSize, '\0');
+  const bool written = WriteFileStreamed(
+      path,
+      [&](const FileChunkWriter& write) {
+        const auto* next = reinterpret_cast<const Bytef*>(data.data());
+        size_t remaining = data.size();
+        int status = Z_OK;
+        while (status != Z_STREAM_END) {
+          if (stream.avail_in == 0 && remaining > 0) {
+            const size_t slice = std::min(remaining, kMaxZlibChunk);
+            stream.next_in = const_cast<Bytef*>(next);
+            stream.avail_in = static_cast<uInt>(slice);
+            next += slice;
+            remaining -= slice;
+          }
+          stream.next_out = reinterpret_cast<Bytef*>(&buffer[0]);
+          stream.avail_out = static_cast<uInt>(buffer.size());
+          status = deflate(&stream, remaining == 0 ? Z_FINISH : Z_NO_FLUSH);
+          if (status == Z_STREAM_ERROR) {
+            return false;
+          }
+          const size_t produced = buffer.size() - stream.avail_out;
+          if (produced > 0 && !write(std::string_view(buffer.data(), produced))) {
+            return false;
+          }
+        }
+        return true;
+      },
+      options, outError);
+  deflateEnd(&stream);
+  return written;
+}
+
+#else
+
+namespace {
+
+constexpr const char* kNoZlibError =
+    "gzip-compressed .cgul requires zlib (configure with CGUL_WITH_ZLIB=ON)";
+
+}  // namespace
+
+bool GunzipToString(std::string_view, std::string* outText, std::string* outError) {
+  outText->clear();
+  return Fail(kNoZlibError, outError);
+}
+
+bool WriteGzipFile(const std::string&, std::string_view, const FileWriteOptions&,
+                   std::string* outError) {
+  return Fail(kNoZlibError, outError);
+}
+
+#endif
+
+}  // namespace detail
+}  // namespace cgul
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include "file_writer.h"
+
+namespace cgul {
+namespace detail {
+
+// True when the bytes start with the gzip member magic (1f 8b).
+bool IsGzipData(std::string_view bytes);
+
+// Inflates every gzip member in `compressed` into outText. The input is consumed in place
+// (callers pass a file mapping), so only the decompressed copy is allocated.
+bool GunzipToString(std::string_view compressed, std::string* outText, std::string* outError);
+
+// Deflates `data` as a single gzip member straight into the file at `path`, one bounded
+// output buffer at a time.
+bool WriteGzipFile(const std::string& path, std::string_view data,
+                   const FileWriteOptions& options, std::string* outError);
+
+}  // namespace detail
+}  // namespace cgul
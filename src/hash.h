@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace cgul {
+namespace detail {
+
+// FNV-1a over raw bytes: checksums and file fingerprints that must not change across builds
+// or platforms.
+inline uint64_t HashBytes64(std::string_view bytes) {
+  uint64_t hash = 1469598103934665603ULL;
+  for (const char ch : bytes) {
+    hash ^= static_cast<unsigned char>(ch);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+inline uint32_t HashBytes32(std::string_view bytes) {
+  uint32_t hash = 2166136261u;
+  for (const char ch : bytes) {
+    hash ^= static_cast<unsigned char>(ch);
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+// splitmix64 finalizer: a bijective mix, so distinct inputs stay distinct.
+inline uint64_t Mix64(uint64_t value) {
+  value ^= value >> 30;
+  value *= 0xBF58476D1CE4E5B9ULL;
+  value ^= value >> 27;
+  value *= 0x94D049BB133111EBULL;
+  value ^= value >> 31;
+  return value;
+}
+
+// Order-dependent accumulator for structured values.
+class Hasher {
+ public:
+  explicit Hasher(uint64_t domain) : state_(Mix64(domain)) {}
+
+  void Add(uint64_t value) { state_ = Mix64(state_ + 0x9E3779B97F4A7C15ULL + value); }
+  void AddString(std::string_view text) {
+    Add(text.size());
+    Add(HashBytes64(text));
+  }
+
+  uint64_t value() const { return state_; }
+
+ private:
+  uint64_t state_;
+};
+
+}  // namespace detail
+}  // namespace cgul
@@ -0,0 +1,111 @@
+#include "cgul/core/interned_document.h"
+
+#include <algorithm>
+
+#include "cgul/core/document_index.h"
+
+namespace cgul {
+
+namespace {
+
+bool SameWidget(const InternedWidget& a, const InternedWidget& b) {
+  return a.id == b.id && a.kind == b.kind && a.boundsCells.x == b.boundsCells.x &&
+         a.boundsCells.y == b.boundsCells.y && a.boundsCells.w == b.boundsCells.w &&
+         a.boundsCells.h == b.boundsCells.h && a.title == b.title;
+}
+
+// Maps ids to positions; false on a duplicate id. WidgetIdMap cannot hold id 0, which an
+// unvalidated document may still use, so its position is tracked separately.
+bool IndexWidgets(const std::vector<InternedWidget>& widgets, WidgetIdMap* ids,
+                  size_t* zeroPosition) {
+  ids->Reserve(widgets.size());
+  *zeroPosition = WidgetIdMap::kNotFound;
+  for (size_t i = 0; i < widgets.size(); ++i) {
+    if (widgets[i].id != 0) {
+      if (!ids->Insert(widgets[i].id, i)) {
+        return false;
+      }
+    } else if (*zeroPosition != WidgetIdMap::kNotFound) {
+      return false;
+    } else {
+      *zeroPosition = i;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+void InternDocument(const CgulDocument& doc, StringPool* pool, InternedDocument* outDoc) {
+  outDoc->cgulVersion = pool->Intern(doc.cgulVersion);
+  outDoc->gridWCells = doc.gridWCells;
+  outDoc->gridHCells = doc.gridHCells;
+  outDoc->seed = doc.seed;
+
+  outDoc->widgets.clear();
+  outDoc->widgets.reserve(doc.widgets.size());
+  for (const Widget& widget : doc.widgets) {
+    outDoc->widgets.push_back(
+        InternedWidget{widget.id, widget.kind, widget.boundsCells, pool->Intern(widget.title)});
+  }
+
+  outDoc->meta.clear();
+  outDoc->meta.reserve(doc.meta.size());
+  for (const auto& entry : doc.meta) {
+    outDoc->meta.emplace_back(pool->Intern(entry.first), entry.second);
+  }
+}
+
+void ExpandDocument(const InternedDocument& doc, const StringPool& pool, CgulDocument* outDoc) {
+  outDoc->cgulVersion = std::string(pool.View(doc.cgulVersion));
+  outDoc->gridWCells = doc.gridWCells;
+  outDoc->gridHCells = doc.gridHCells;
+  outDoc->seed = doc.seed;
+
+  outDoc->widgets.clear();
+  outDoc->widgets.reserve(doc.widgets.size());
+  for (const InternedWidget& widget : doc.widgets) {
+    outDoc->widgets.push_back(Widget{widget.id, widget.kind, widget.boundsCells,
+                                     std::string(pool.View(widget.title))});
+  }
+
+  std::vector<MetaMap::value_type> meta;
+  meta.reserve(doc.meta.size());
+  for (const auto& entry : doc.meta) {
+    meta.emplace_back(std::string(pool.View(entry.first)), entry.second);
+  }
+  outDoc->meta.Assign(std::move(meta));
+}
+
+bool Equal(const InternedDocument& a, const InternedDocument& b) {
+  if (a.cgulVersion != b.cgulVersion || a.gridWCells != b.gridWCells ||
+      a.gridHCells != b.gridHCells || a.seed != b.seed || a.meta != b.meta ||
+      a.widgets.size() != b.widgets.size()) {
+    return false;
+  }
+
+  WidgetIdMap aIds;
+  size_t aZero = 0;
+  if (!IndexWidgets(a.widgets, &aIds, &aZero)) {
+    return false;
+  }
+  // Documents loaded from the same source usually keep widget order.
+  if (std::equal(a.widgets.begin(), a.widgets.end(), b.widgets.begin(), SameWidget)) {
+    return true;
+  }
+
+  WidgetIdMap bIds;
+  size_t bZero = 0;
+  if (!IndexWidgets(b.widgets, &bIds, &bZero)) {
+    return false;
+  }
+  for (const InternedWidget& widget : a.widgets) {
+    const size_t position = widget.id != 0 ? bIds.Find(widget.id) : bZero;
+    if (position == WidgetIdMap::kNotFound || !SameWidget(widget, b.widgets[position])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace cgul
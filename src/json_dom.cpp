@@ -0,0 +1,230 @@
+#include "cgul/io/json_dom.h"
+
+#include <algorithm>
+
+#include "json_parser.h"
+
+namespace cgul {
+
+namespace {
+
+// Objects up to this many members check duplicates against earlier siblings as they go;
+// larger ones sort their keys once when the object closes.
+constexpr uint32_t kLinearKeyCheckMembers = 16;
+
+// Every value but the root follows a '[', '{' or ','; bytes inside strings only make the
+// bound looser.
+size_t CountNodesUpperBound(std::string_view text) {
+  size_t count = 1;
+  for (const char ch : text) {
+    if (ch == ',' || ch == '[' || ch == '{') {
+      ++count;
+    }
+  }
+  return count;
+}
+
+class DomBuilder {
+ public:
+  DomBuilder(std::string_view text, std::vector<JsonNode>* nodes, std::string* arena,
+             std::vector<std::string_view>* keyScratch)
+      : parser_(text), nodes_(*nodes), arena_(*arena), keyScratch_(*keyScratch) {}
+
+  bool Build(std::string* outError) {
+    parser_.SkipWhitespace();
+    if (!ParseValue(std::string_view(), 0, outError)) {
+      return false;
+    }
+    parser_.SkipWhitespace();
+    if (!parser_.AtEnd()) {
+      return parser_.Error("unexpected trailing characters", outError);
+    }
+    return true;
+  }
+
+ private:
+  bool ParseValue(std::string_view key, int depth, std::string* outError) {
+    const size_t index = nodes_.size();
+    nodes_.emplace_back();
+    nodes_[index].key = key;
+
+    bool ok = false;
+    switch (parser_.PeekType()) {
+      case detail::JsonType::Object:
+        nodes_[index].type = JsonNodeType::Object;
+        ok = ParseObject(index, depth, outError);
+        break;
+      case detail::JsonType::Array:
+        nodes_[index].type = JsonNodeType::Array;
+        ok = ParseArray(index, depth, outError);
+        break;
+      case detail::JsonType::String:
+        nodes_[index].type = JsonNodeType::String;
+        ok = parser_.ParseStringView(&nodes_[index].text, &arena_, outError);
+        break;
+      case detail::JsonType::Integer: {
+        bool isFloat = false;
+        ok = parser_.ParseNumber(&nodes_[index].intValue, &nodes_[index].floatValue, &isFloat,
+                                 outError);
+        nodes_[index].type = isFloat ? JsonNodeType::Float : JsonNodeType::Integer;
+        break;
+      }
+      case detail::JsonType::Bool:
+        nodes_[index].type = JsonNodeType::Bool;
+        ok = parser_.ParseBool(&nodes_[index].boolValue, outError);
+        break;
+      case detail::JsonType::Null:
+        ok = parser_.ParseNull(outError);
+        break;
+      case detail::JsonType::Invalid:
+        return parser_.Error(parser_.AtEnd() ? "unexpected end of input" : "unexpected token",
+                             outError);
+    }
+    nodes_[index].end = static_cast<uint32_t>(nodes_.size());
+    return ok;
+  }
+
+  bool EnterContainer(int depth, std::string* outError) {
+    if (depth >= detail::kMaxJsonNestingDepth) {
+      return parser_.Error("nesting too deep", outError);
+    }
+    return true;
+  }
+
+  bool ParseObject(size_t index, int depth, std::string* outError) {
+    if (!EnterContainer(depth, outError) || !parser_.Consume('{', outError)) {
+      return false;
+    }
+
+    parser_.SkipWhitespace();
+    if (parser_.TryConsume('}')) {
+      return true;
+    }
+
+    while (true) {
+      std::string_view key;
+      if (!parser_.ParseStringView(&key, &arena_, outError)) {
+        return false;
+      }
+
+      parser_.SkipWhitespace();
+      if (!parser_.Consume(':', outError)) {
+        return false;
+      }
+
+      parser_.SkipWhitespace();
+      const size_t member = nodes_.size();
+      if (!ParseValue(key, depth + 1, outError)) {
+        return false;
+      }
+      if (++nodes_[index].childCount <= kLinearKeyCheckMembers) {
+        for (size_t sibling = index + 1; sibling < member; sibling = nodes_[sibling].end) {
+          if (nodes_[sibling].key == key) {
+            return parser_.Error("duplicate object key: " + std::string(key), outError);
+          }
+        }
+      }
+
+      parser_.SkipWhitespace();
+      if (parser_.TryConsume('}')) {
+        break;
+      }
+      if (!parser_.Consume(',', outError)) {
+        return false;
+      }
+      parser_.SkipWhitespace();
+    }
+
+    if (nodes_[index].childCount <= kLinearKeyCheckMembers) {
+      return true;
+    }
+    return CheckKeysSorted(index, outError);
+  }
+
+  bool CheckKeysSorted(size_t index, std::string* outError) {
+    if (keyScratch_.capacity() < nodes_.capacity()) {
+      keyScratch_.reserve(nodes_.capacity());
+    }
+    keyScratch_.clear();
+    for (size_t child = index + 1; child < nodes_.size(); child = nodes_[child].end) {
+      keyScratch_.push_back(nodes_[child].key);
+    }
+    std::sort(keyScratch_.begin(), keyScratch_.end());
+    const auto duplicate = std::adjacent_find(keyScratch_.begin(), keyScratch_.end());
+    if (duplicate != keyScratch_.end()) {
+      return parser_.Error("duplicate object key: " + std::string(*duplicate), outError);
+    }
+    return true;
+  }
+
+  bool ParseArray(size_t index, int depth, std::string* outError) {
+    if (!EnterContainer(depth, outError) || !parser_.Consume('[', outError)) {
+      return false;
+    }
+
+    parser_.SkipWhitespace();
+    if (parser_.TryConsume(']')) {
+      return true;
+    }
+
+    while (true) {
+      if (!ParseValue(std::string_view(), depth + 1, outError)) {
+        return false;
+      }
+      ++nodes_[index].childCount;
+
+      parser_.SkipWhitespace();
+      if (parser_.TryConsume(']')) {
+        return true;
+      }
+      if (!parser_.Consume(',', outError)) {
+        return false;
+      }
+      parser_.SkipWhitespace();
+    }
+  }
+
+  detail::JsonParser parser_;
+  std::vector<JsonNode>& nodes_;
+  std::string& arena_;
+  std::vector<std::string_view>& keyScratch_;
+};
+
+}  // namespace
+
+bool JsonDocument::Parse(std::string_view text, std::string* outError) {
+  if (outError != nullptr) {
+    outError->clear();
+  }
+
+  Clear();
+  nodes_.reserve(CountNodesUpperBound(text));
+
+  DomBuilder builder(text, &nodes_, &arena_, &keyScratch_);
+  if (!builder.Build(outError)) {
+    Clear();
+    return false;
+  }
+  return true;
+}
+
+void JsonDocument::Clear() {
+  nodes_.clear();
+  arena_.clear();
+  keyScratch_.clear();
+}
+
+size_t JsonDocument::Find(size_t objectIndex, std::string_view key) const {
+  if (objectIndex >= nodes_.size() || nodes_[objectIndex].type != JsonNodeType::Object) {
+    return kNoNode;
+  }
+  const size_t end = nodes_[objectIndex].end;
+  for (size_t child = objectIndex + 1; child < end; child = nodes_[child].end) {
+    if (nodes_[child].key == key) {
+      return child;
+    }
+  }
+  return kNoNode;
+}
+
+}  // namespace cgul
@@ -0,0 +1,616 @@
+#pragma once
+
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_set>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CGUL_JSON_SSE2 1
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#define CGUL_JSON_AVX2 1
+#include <immintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace cgul {
+namespace detail {
+
+inline bool IsJsonWhitespace(unsigned char ch) {
+  return ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t';
+}
+
+inline bool IsStringSpecial(unsigned char ch) {
+  return ch == '"' || ch == '\\' || ch < 0x20;
+}
+
+#if defined(CGUL_JSON_SSE2)
+inline unsigned CountTrailingZeros(uint32_t mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  unsigned long index = 0;
+  _BitScanForward(&index, mask);
+  return static_cast<unsigned>(index);
+#else
+  return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+#endif
+
+// Returns the first index at or after `pos` that is not JSON whitespace, or `size`.
+inline size_t FindNonWhitespace(const char* data, size_t pos, size_t size) {
+  // Most calls sit on a token already; only runs of indentation take the vector path.
+  if (pos < size && !IsJsonWhitespace(static_cast<unsigned char>(data[pos]))) {
+    return pos;
+  }
+#if defined(CGUL_JSON_AVX2)
+  const __m256i space32 = _mm256_set1_epi8(' ');
+  const __m256i newline32 = _mm256_set1_epi8('\n');
+  const __m256i ret32 = _mm256_set1_epi8('\r');
+  const __m256i tab32 = _mm256_set1_epi8('\t');
+  while (pos + 32 <= size) {
+    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+    const __m256i ws = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, space32), _mm256_cmpeq_epi8(v, newline32)),
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, ret32), _mm256_cmpeq_epi8(v, tab32)));
+    const uint32_t other = ~static_cast<uint32_t>(_mm256_movemask_epi8(ws));
+    if (other != 0) {
+      return pos + CountTrailingZeros(other);
+    }
+    pos += 32;
+  }
+#endif
+#if defined(CGUL_JSON_SSE2)
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i newline = _mm_set1_epi8('\n');
+  const __m128i ret = _mm_set1_epi8('\r');
+  const __m128i tab = _mm_set1_epi8('\t');
+  while (pos + 16 <= size) {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+    const __m128i ws =
+        _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, newline)),
+                     _mm_or_si128(_mm_cmpeq_epi8(v, ret), _mm_cmpeq_epi8(v, tab)));
+    const uint32_t other = ~static_cast<uint32_t>(_mm_movemask_epi8(ws)) & 0xFFFFu;
+    if (other != 0) {
+      return pos + CountTrailingZeros(other);
+    }
+    pos += 16;
+  }
+#endif
+  while (pos < size && IsJsonWhitespace(static_cast<unsigned char>(data[pos]))) {
+    ++pos;
+  }
+  return pos;
+}
+
+// Returns the first index at or after `pos` holding a quote, backslash or control
+// character, or `size`.
+inline size_t FindStringSpecial(const char* data, size_t pos, size_t size) {
+#if defined(CGUL_JSON_AVX2)
+  const __m256i quote32 = _mm256_set1_epi8('"');
+  const __m256i backslash32 = _mm256_set1_epi8('\\');
+  const __m256i control32 = _mm256_set1_epi8(0x1F);
+  while (pos + 32 <= size) {
+    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+    // max(v, 0x1F) == 0x1F exactly when v <= 0x1F as an unsigned byte.
+    const __m256i special = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, quote32), _mm256_cmpeq_epi8(v, backslash32)),
+        _mm256_cmpeq_epi8(_mm256_max_epu8(v, control32), control32));
+    const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(special));
+    if (mask != 0) {
+      return pos + CountTrailingZeros(mask);
+    }
+    pos += 32;
+  }
+#endif
+#if defined(CGUL_JSON_SSE2)
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i control = _mm_set1_epi8(0x1F);
+  while (pos + 16 <= size) {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+    const __m128i special =
+        _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                     _mm_cmpeq_epi8(_mm_max_epu8(v, control), control));
+    const uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(special));
+    if (mask != 0) {
+      return pos + CountTrailingZeros(mask);
+    }
+    pos += 16;
+  }
+#endif
+  while (pos < size && !IsStringSpecial(static_cast<unsigned char>(data[pos]))) {
+    ++pos;
+  }
+  return pos;
+}
+
+// Deepest nesting of objects and arrays accepted, shared by the pull parser and the DOM.
+constexpr int kMaxJsonNestingDepth = 512;
+
+enum class JsonType {
+  Invalid,
+  Null,
+  Bool,
+  Integer,
+  String,
+  Object,
+  Array,
+};
+
+inline const char* DescribeType(JsonType type) {
+  switch (type) {
+    case JsonType::Object: return "an object";
+    case JsonType::Array: return "an array";
+    case JsonType::String: return "a string";
+    case JsonType::Integer: return "an integer";
+    case JsonType::Bool: return "a boolean";
+    case JsonType::Null:
+    case JsonType::Invalid: break;
+  }
+  return "null";
+}
+
+// Pull-style JSON reader: callers walk objects and arrays member by member and decide per
+// key whether to read the value or skip it, so nothing is materialized that the schema
+// does not need.
+class JsonParser {
+ public:
+  explicit JsonParser(std::string_view input) : input_(input) {}
+
+  bool AtEnd() const { return pos_ >= input_.size(); }
+  size_t pos() const { return pos_; }
+
+  JsonType PeekType() const {
+    if (pos_ >= input_.size()) {
+      return JsonType::Invalid;
+    }
+    const char ch = input_[pos_];
+    if (ch == '{') {
+      return JsonType::Object;
+    }
+    if (ch == '[') {
+      return JsonType::Array;
+    }
+    if (ch == '"') {
+      return JsonType::String;
+    }
+    if (ch == '-' || std::isdigit(static_cast<unsigned char>(ch)) != 0) {
+      return JsonType::Integer;
+    }
+    if (StartsWith("true") || StartsWith("false")) {
+      return JsonType::Bool;
+    }
+    if (StartsWith("null")) {
+      return JsonType::Null;
+    }
+    return JsonType::Invalid;
+  }
+
+  // Calls onMember(key, outError) for each member; onMember must consume the value.
+  template <typename OnMember>
+  bool ParseObject(OnMember&& onMember, std::string* outError) {
+    if (!EnterContainer(outError) || !Consume('{', outError)) {
+      return false;
+    }
+
+    SkipWhitespace();
+    if (TryConsume('}')) {
+      --depth_;
+      return true;
+    }
+
+    std::string key;
+    while (true) {
+      if (!ParseString(&key, outError)) {
+        return false;
+      }
+
+      SkipWhitespace();
+      if (!Consume(':', outError)) {
+        return false;
+      }
+
+      SkipWhitespace();
+      if (!onMember(static_cast<const std::string&>(key), outError)) {
+        return false;
+      }
+
+      SkipWhitespace();
+      if (TryConsume('}')) {
+        --depth_;
+        return true;
+      }
+      if (!Consume(',', outError)) {
+        return false;
+      }
+      SkipWhitespace();
+    }
+  }
+
+  // Calls onItem(index, outError) for each element; onItem must consume the value.
+  template <typename OnItem>
+  bool ParseArray(OnItem&& onItem, std::string* outError) {
+    if (!EnterContainer(outError) || !Consume('[', outError)) {
+      return false;
+    }
+
+    SkipWhitespace();
+    if (TryConsume(']')) {
+      --depth_;
+      return true;
+    }
+
+    for (size_t index = 0;; ++index) {
+      if (!onItem(index, outError)) {
+        return false;
+      }
+
+      SkipWhitespace();
+      if (TryConsume(']')) {
+        --depth_;
+        return true;
+      }
+      if (!Consume(',', outError)) {
+        return false;
+      }
+      SkipWhitespace();
+    }
+  }
+
+  // Validates and discards one value, including duplicate-key checks in nested objects.
+  bool SkipValue(std::string* outError);
+
+  bool ParseString(std::string* outString, std::string* outError) {
+    outString->clear();
+    return AppendString(outString, outError);
+  }
+
+  // Like ParseString, but appends the decoded text to `outString`.
+  bool AppendString(std::string* outString, std::string* outError) {
+    if (!Consume('"', outError)) {
+      return false;
+    }
+
+    while (pos_ < input_.size()) {
+      const size_t special = FindStringSpecial(input_.data(), pos_, input_.size());
+      outString->append(input_.data() + pos_, special - pos_);
+      pos_ = special;
+      if (pos_ >= input_.size()) {
+        break;
+      }
+
+      const char ch = input_[pos_++];
+      if (ch == '"') {
+        return true;
+      }
+      if (ch == '\\') {
+        if (pos_ >= input_.size()) {
+          return Error("unterminated escape sequence", outError);
+        }
+        const char esc = input_[pos_++];
+        switch (esc) {
+          case '"': outString->push_back('"'); break;
+          case '\\': outString->push_back('\\'); break;
+          case 'n': outString->push_back('\n'); break;
+          case 'r': outString->push_back('\r'); break;
+          case 't': outString->push_back('\t'); break;
+          default:
+            return Error(std::string("unsupported string escape: \\") + esc, outError);
+        }
+        continue;
+      }
+
+      return Error("control character in string", outError);
+    }
+
+    return Error("unterminated string literal", outError);
+  }
+
+  // Returns a view into the input when the string has no escapes. Escaped strings are
+  // decoded into `arena`; an empty arena is first reserved to the input size, so decoded
+  // text never outgrows it and earlier views into it stay valid.
+  bool ParseStringView(std::string_view* outView, std::string* arena, std::string* outError) {
+    if (pos_ >= input_.size() || input_[pos_] != '"') {
+      return Error("expected '\"'", outError);
+    }
+
+    const size_t start = pos_ + 1;
+    const size_t special = FindStringSpecial(input_.data(), start, input_.size());
+    if (special < input_.size() && input_[special] == '"') {
+      *outView = input_.substr(start, special - start);
+      pos_ = special + 1;
+      return true;
+    }
+
+    // Escapes, bad characters or a missing quote: decode (or report) the slow way.
+    if (arena->empty() && arena->capacity() < input_.size()) {
+      arena->reserve(input_.size());
+    }
+    const size_t offset = arena->size();
+    if (!AppendString(arena, outError)) {
+      arena->resize(offset);
+      return false;
+    }
+    *outView = std::string_view(arena->data() + offset, arena->size() - offset);
+    return true;
+  }
+
+  bool ParseBool(bool* outValue, std::string* outError) {
+    if (StartsWith("true")) {
+      pos_ += 4;
+      *outValue = true;
+      return true;
+    }
+    if (StartsWith("false")) {
+      pos_ += 5;
+      *outValue = false;
+      return true;
+    }
+    return Error("unexpected token", outError);
+  }
+
+  bool ParseNull(std::string* outError) {
+    if (!StartsWith("null")) {
+      return Error("unexpected token", outError);
+    }
+    pos_ += 4;
+    return true;
+  }
+
+  bool ParseInteger(int64_t* outInteger, std::string* outError) {
+    if (pos_ >= input_.size()) {
+      return Error("expected integer", outError);
+    }
+
+    bool negative = false;
+    if (input_[pos_] == '-') {
+      negative = true;
+      ++pos_;
+      if (pos_ >= input_.size()) {
+        return Error("expected digits after '-'", outError);
+      }
+    }
+
+    if (input_[pos_] == '0' && pos_ + 1 < input_.size() &&
+        std::isdigit(static_cast<unsigned char>(input_[pos_ + 1])) != 0) {
+      return Error("leading zeros are not allowed", outError);
+    }
+
+    if (std::isdigit(static_cast<unsigned char>(input_[pos_])) == 0) {
+      return Error("expected integer digits", outError);
+    }
+
+    uint64_t magnitude = 0;
+    while (pos_ < input_.size() && std::isdigit(static_cast<unsigned char>(input_[pos_])) != 0) {
+      const uint64_t digit = static_cast<uint64_t>(input_[pos_] - '0');
+      if (magnitude > (std::numeric_limits<uint64_t>::max() - digit) / 10ULL) {
+        return Error("integer out of range", outError);
+      }
+      magnitude = magnitude * 10ULL + digit;
+      ++pos_;
+    }
+
+    if (pos_ < input_.size() && (input_[pos_] == '.' || input_[pos_] == 'e' || input_[pos_] == 'E')) {
+      return Error("floating-point numbers are not supported", outError);
+    }
+
+    if (negative) {
+      const uint64_t maxNegative = static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) + 1ULL;
+      if (magnitude > maxNegative) {
+        return Error("integer out of int64 range", outError);
+      }
+      if (magnitude == maxNegative) {
+        *outInteger = std::numeric_limits<int64_t>::min();
+      } else {
+        *outInteger = -static_cast<int64_t>(magnitude);
+      }
+    } else {
+      if (magnitude > static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) {
+        return Error("integer out of int64 range", outError);
+      }
+      *outInteger = static_cast<int64_t>(magnitude);
+    }
+
+    return true;
+  }
+
+  // Like ParseInteger, but a number with a fraction or exponent is read into *outFloat and
+  // sets *outIsFloat. Only typed meta values accept fractions; ParseInteger rejects them.
+  bool ParseNumber(int64_t* outInteger, double* outFloat, bool* outIsFloat,
+                   std::string* outError) {
+    const auto isDigit = [this](size_t i) {
+      return i < input_.size() && std::isdigit(static_cast<unsigned char>(input_[i])) != 0;
+    };
+    size_t end = pos_;
+    if (end < input_.size() && input_[end] == '-') {
+      ++end;
+    }
+    const size_t intStart = end;
+    while (isDigit(end)) {
+      ++end;
+    }
+    bool isFloat = false;
+    if (end > intStart && !(input_[intStart] == '0' && end - intStart > 1)) {
+      if (end < input_.size() && input_[end] == '.') {
+        isFloat = true;
+        if (!isDigit(++end)) {
+          pos_ = end;
+          return Error("expected digits after '.'", outError);
+        }
+        while (isDigit(end)) {
+          ++end;
+        }
+      }
+      if (end < input_.size() && (input_[end] == 'e' || input_[end] == 'E')) {
+        isFloat = true;
+        ++end;
+        if (end < input_.size() && (input_[end] == '+' || input_[end] == '-')) {
+          ++end;
+        }
+        if (!isDigit(end)) {
+          pos_ = end;
+          return Error("expected exponent digits", outError);
+        }
+        while (isDigit(end)) {
+          ++end;
+        }
+      }
+    }
+    *outIsFloat = isFloat;
+    if (!isFloat) {
+      return ParseInteger(outInteger, outError);
+    }
+
+    const std::from_chars_result result =
+        std::from_chars(input_.data() + pos_, input_.data() + end, *outFloat);
+    pos_ = end;
+    if (result.ec != std::errc() || result.ptr != input_.data() + end) {
+      return Error("number out of range", outError);
+    }
+    return true;
+  }
+
+  bool Consume(char expected, std::string* outError) {
+    if (pos_ >= input_.size() || input_[pos_] != expected) {
+      return Error(std::string("expected '") + expected + "'", outError);
+    }
+    ++pos_;
+    return true;
+  }
+
+  bool TryConsume(char expected) {
+    if (pos_ < input_.size() && input_[pos_] == expected) {
+      ++pos_;
+      return true;
+    }
+    return false;
+  }
+
+  void SkipWhitespace() { pos_ = FindNonWhitespace(input_.data(), pos_, input_.size()); }
+
+  bool Error(const std::string& message, std::string* outError) const {
+    if (outError != nullptr) {
+      *outError = "Parse error at byte " + std::to_string(pos_) + ": " + message;
+    }
+    return false;
+  }
+
+ private:
+  // Bounds recursion on hostile input, e.g. SkipValue over deeply nested unknown keys. A
+  // failed parse is abandoned, so only successful exits undo the increment.
+  bool EnterContainer(std::string* outError) {
+    if (depth_ >= kMaxJsonNestingDepth) {
+      return Error("nesting too deep", outError);
+    }
+    ++depth_;
+    return true;
+  }
+
+  bool StartsWith(const char* token) const {
+    size_t i = 0;
+    while (token[i] != '\0') {
+      if (pos_ + i >= input_.size() || input_[pos_ + i] != token[i]) {
+        return false;
+      }
+      ++i;
+    }
+    return true;
+  }
+
+  std::string_view input_;
+  size_t pos_ = 0;
+  int depth_ = 0;  // open objects and arrays
+  std::string skipScratch_;
+};
+
+// Tracks the keys of one object so duplicates are rejected. Schema keys are a bitmask;
+// only unknown keys are copied, and only when an object actually has some. The first few
+// are compared linearly; past kLinearKeys they move to a hash set, so large meta or skipped
+// objects stay linear overall.
+class SeenKeys {
+ public:
+  // Call after the member value is consumed so the error offset matches the value end.
+  bool Mark(JsonParser& parser, int knownIndex, const std::string& key, std::string* outError) {
+    if (knownIndex >= 0) {
+      const uint32_t bit = 1u << knownIndex;
+      if ((known_ & bit) != 0) {
+        return parser.Error("duplicate object key: " + key, outError);
+      }
+      known_ |= bit;
+      return true;
+    }
+    if (!unknownSet_.empty()) {
+      if (!unknownSet_.insert(key).second) {
+        return parser.Error("duplicate object key: " + key, outError);
+      }
+      return true;
+    }
+    for (const std::string& seen : unknown_) {
+      if (seen == key) {
+        return parser.Error("duplicate object key: " + key, outError);
+      }
+    }
+    if (unknown_.size() < kLinearKeys) {
+      unknown_.push_back(key);
+      return true;
+    }
+    unknownSet_.reserve(unknown_.size() * 4);
+    for (std::string& seen : unknown_) {
+      unknownSet_.insert(std::move(seen));
+    }
+    unknown_.clear();
+    unknownSet_.insert(key);
+    return true;
+  }
+
+  bool Has(int knownIndex) const { return (known_ & (1u << knownIndex)) != 0; }
+
+ private:
+  static constexpr size_t kLinearKeys = 16;
+
+  uint32_t known_ = 0;
+  std::vector<std::string> unknown_;
+  std::unordered_set<std::string> unknownSet_;
+};
+
+inline bool JsonParser::SkipValue(std::string* outError) {
+  switch (PeekType()) {
+    case JsonType::Object: {
+      SeenKeys seen;
+      return ParseObject(
+          [&](const std::string& key, std::string* err) {
+            return SkipValue(err) && seen.Mark(*this, -1, key, err);
+          },
+          outError);
+    }
+    case JsonType::Array:
+      return ParseArray([&](size_t, std::string* err) { return SkipValue(err); }, outError);
+    case JsonType::String:
+      return ParseString(&skipScratch_, outError);
+    case JsonType::Integer: {
+      int64_t ignored = 0;
+      return ParseInteger(&ignored, outError);
+    }
+    case JsonType::Bool:
+      pos_ += StartsWith("true") ? 4 : 5;
+      return true;
+    case JsonType::Null:
+      pos_ += 4;
+      return true;
+    case JsonType::Invalid:
+      break;
+  }
+  return Error(AtEnd() ? "unexpected end of input" : "unexpected token", outError);
+}
+
+}  // namespace detail
+}  // namespace cgul
@@ -1,119 +1,158 @@
 #include "cgul/render/layout_composer.h"
 
 #include <algorithm>
-#include <string>
+#include <cstdint>
+#include <vector>
+
+#include "cgul/render/widget_painter.h"
 
 namespace cgul {
 
 namespace {
 
-std::u32string ToGlyphString(const std::string& text) {
-  std::u32string result;
-  result.reserve(text.size());
-  for (unsigned char ch : text) {
-    result.push_back(ch < 128 ? static_cast<char32_t>(ch) : U'?');
+constexpr int kOcclusionBucketCells = 16;
+
+bool ClipToFrame(const Frame& frame, const RectI& bounds, RectI* outClipped) {
+  const int64_t x0 = std::max<int64_t>(0, bounds.x);
+  const int64_t y0 = std::max<int64_t>(0, bounds.y);
+  const int64_t x1 = std::min<int64_t>(frame.width, static_cast<int64_t>(bounds.x) + bounds.w);
+  const int64_t y1 = std::min<int64_t>(frame.height, static_cast<int64_t>(bounds.y) + bounds.h);
+  if (x0 >= x1 || y0 >= y1) {
+    return false;
   }
-  return result;
+  *outClipped = RectI{static_cast<int>(x0), static_cast<int>(y0), static_cast<int>(x1 - x0),
+                      static_cast<int>(y1 - y0)};
+  return true;
 }
 
-bool InBounds(const Frame& frame, int x, int y) {
-  return x >= 0 && y >= 0 && x < frame.width && y < frame.height;
+bool Contains(const RectI& outer, const RectI& inner) {
+  return inner.x >= outer.x && inner.y >= outer.y && inner.x + inner.w <= outer.x + outer.w &&
+         inner.y + inner.h <= outer.y + outer.h;
 }
 
-void DrawBoxBorder(Frame& frame, int x0, int y0, int x1, int y1, uint32_t widgetId) {
-  for (int y = y0; y <= y1; ++y) {
-    for (int x = x0; x <= x1; ++x) {
-      if (!InBounds(frame, x, y)) {
-        continue;
-      }
+// Per-thread buffers so repeated composes on one thread do not reallocate.
+struct OcclusionScratch {
+  std::vector<uint8_t> hidden;
+  std::vector<RectI> clipped;
+  std::vector<uint8_t> opaque;
+  std::vector<uint32_t> bucketStart;
+  std::vector<uint32_t> entries;
+  std::vector<uint32_t> fill;
+};
+
+// Marks widgets that paint nothing visible: clipped away entirely, or fully covered by a
+// later opaque widget. Opaque rects are bucketed by cell so each widget only tests the
+// covers registered in the bucket of its top-left cell.
+const std::vector<uint8_t>& FindHiddenWidgets(const CgulDocument& doc, const Frame& frame,
+                                              OcclusionScratch* scratch) {
+  const size_t count = doc.widgets.size();
+  std::vector<uint8_t>& hidden = scratch->hidden;
+  std::vector<RectI>& clipped = scratch->clipped;
+  std::vector<uint8_t>& opaque = scratch->opaque;
+  hidden.assign(count, 0);
+  clipped.resize(count);
+  opaque.assign(count, 0);
+
+  size_t opaqueCount = 0;
+  for (size_t i = 0; i < count; ++i) {
+    const Widget& widget = doc.widgets[i];
+    if (!ClipToFrame(frame, widget.boundsCells, &clipped[i])) {
+      hidden[i] = 1;
+      continue;
+    }
+    if (GetWidgetPainter(widget.kind).opaque) {
+      opaque[i] = 1;
+      ++opaqueCount;
+    }
+  }
+  if (opaqueCount == 0 || count < 2) {
+    return hidden;
+  }
 
-      Cell& c = frame.at(x, y);
-      const bool left = (x == x0);
-      const bool right = (x == x1);
-      const bool top = (y == y0);
-      const bool bottom = (y == y1);
-
-      if (top) {
-        if (left || right) {
-          c.glyph = U'#';
-        } else {
-          c.glyph = U'=';
-        }
-      } else if (bottom || left || right) {
-        c.glyph = U'#';
-      } else {
-        c.glyph = U' ';
+  const int bucketsX = (frame.width + kOcclusionBucketCells - 1) / kOcclusionBucketCells;
+  const int bucketsY = (frame.height + kOcclusionBucketCells - 1) / kOcclusionBucketCells;
+  const size_t bucketCount = static_cast<size_t>(bucketsX) * static_cast<size_t>(bucketsY);
+
+  auto forEachBucket = [&](const RectI& rect, auto&& fn) {
+    const int bx0 = rect.x / kOcclusionBucketCells;
+    const int by0 = rect.y / kOcclusionBucketCells;
+    const int bx1 = (rect.x + rect.w - 1) / kOcclusionBucketCells;
+    const int by1 = (rect.y + rect.h - 1) / kOcclusionBucketCells;
+    for (int by = by0; by <= by1; ++by) {
+      for (int bx = bx0; bx <= bx1; ++bx) {
+        fn(static_cast<size_t>(by) * static_cast<size_t>(bucketsX) + static_cast<size_t>(bx));
       }
-
-      c.widgetId = widgetId;
+    }
+  };
+
+  // Flat bucket lists: count, prefix-sum, fill. Entries stay in document order.
+  std::vector<uint32_t>& bucketStart = scratch->bucketStart;
+  bucketStart.assign(bucketCount + 1, 0);
+  for (size_t i = 0; i < count; ++i) {
+    if (opaque[i] != 0) {
+      forEachBucket(clipped[i], [&](size_t bucket) { ++bucketStart[bucket + 1]; });
     }
   }
-}
-
-void DrawClippedText(Frame& frame, int x, int y, const std::string& text, int maxWidth,
-                     uint32_t widgetId) {
-  if (maxWidth <= 0 || text.empty() || y < 0 || y >= frame.height || x >= frame.width) {
-    return;
+  for (size_t b = 0; b < bucketCount; ++b) {
+    bucketStart[b + 1] += bucketStart[b];
   }
-
-  const int startX = std::max(0, x);
-  const int visibleWidth = std::min(maxWidth - (startX - x), frame.width - startX);
-  if (visibleWidth <= 0) {
-    return;
+  std::vector<uint32_t>& entries = scratch->entries;
+  std::vector<uint32_t>& fill = scratch->fill;
+  entries.resize(bucketStart[bucketCount]);
+  fill.assign(bucketStart.begin(), bucketStart.end() - 1);
+  for (size_t i = 0; i < count; ++i) {
+    if (opaque[i] != 0) {
+      forEachBucket(clipped[i],
+                    [&](size_t bucket) { entries[fill[bucket]++] = static_cast<uint32_t>(i); });
+    }
   }
 
-  std::u32string glyphs = ToGlyphString(text);
-  if (static_cast<int>(glyphs.size()) > visibleWidth) {
-    glyphs.resize(static_cast<size_t>(visibleWidth));
+  for (size_t i = 0; i + 1 < count; ++i) {
+    if (hidden[i] != 0) {
+      continue;
+    }
+    const RectI& rect = clipped[i];
+    const size_t bucket =
+        static_cast<size_t>(rect.y / kOcclusionBucketCells) * static_cast<size_t>(bucketsX) +
+        static_cast<size_t>(rect.x / kOcclusionBucketCells);
+    for (uint32_t e = bucketStart[bucket + 1]; e > bucketStart[bucket]; --e) {
+      const uint32_t cover = entries[e - 1];
+      if (cover <= i) {
+        break;
+      }
+      if (Contains(clipped[cover], rect)) {
+        hidden[i] = 1;
+        break;
+      }
+    }
   }
 
-  draw_text(frame, startX, y, glyphs, widgetId);
+  return hidden;
 }
 
 }  // namespace
 
 Frame ComposeLayoutToFrame(const CgulDocument& doc) {
-  Frame frame(doc.gridWCells, doc.gridHCells);
-  frame.clear(U' ');
-
-  for (const Widget& widget : doc.widgets) {
-    const int x0 = widget.boundsCells.x;
-    const int y0 = widget.boundsCells.y;
-    const int x1 = widget.boundsCells.x + widget.boundsCells.w - 1;
-    const int y1 = widget.boundsCells.y + widget.boundsCells.h - 1;
-
-    DrawBoxBorder(frame, x0, y0, x1, y1, widget.id);
-
-    if (widget.kind == WidgetKind::Window) {
-      const std::string title =
-          widget.title.empty() ? ("Window " + std::to_string(widget.id)) : widget.title;
-      DrawClippedText(frame, x0 + 2, y0, title, std::max(0, widget.boundsCells.w - 4), widget.id);
-
-      const int interiorWidth = widget.boundsCells.w - 2;
-      const int interiorHeight = widget.boundsCells.h - 2;
-      if (interiorWidth > 0 && interiorHeight > 0) {
-        const std::string line1 = "W x H: " + std::to_string(widget.boundsCells.w) + " x " +
-                                  std::to_string(widget.boundsCells.h);
-        DrawClippedText(frame, x0 + 1, y0 + 1, line1, interiorWidth, widget.id);
-
-        if (interiorHeight > 1) {
-          const std::string line2 = "pos: " + std::to_string(widget.boundsCells.x) + "," +
-                                    std::to_string(widget.boundsCells.y);
-          DrawClippedText(frame, x0 + 1, y0 + 2, line2, interiorWidth, widget.id);
-        }
-      }
+  Frame frame;
+  ComposeLayoutIntoFrame(doc, &frame);
+  return frame;
+}
 
-      continue;
-    }
+void ComposeLayoutIntoFrame(const CgulDocument& doc, Frame* outFrame) {
+  if (outFrame == nullptr) {
+    return;
+  }
+  Frame& frame = *outFrame;
+  frame.resize(doc.gridWCells, doc.gridHCells);
+  frame.clear(U' ');
 
-    if (!widget.title.empty()) {
-      const int textY = std::clamp(y0 + 1, y0, y1);
-      DrawClippedText(frame, x0 + 1, textY, widget.title, std::max(0, widget.boundsCells.w - 2),
-                      widget.id);
+  thread_local OcclusionScratch scratch;
+  const std::vector<uint8_t>& hidden = FindHiddenWidgets(doc, frame, &scratch);
+  for (size_t i = 0; i < doc.widgets.size(); ++i) {
+    if (hidden[i] == 0) {
+      PaintWidget(frame, doc.widgets[i]);
     }
   }
-
-  return frame;
 }
 
 }  // namespace cgul
@@ -0,0 +1,193 @@
+#include "mapped_file.h"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace cgul {
+namespace detail {
+
+namespace {
+
+bool OpenFailed(const std::string& path, std::string* outError) {
+  if (outError != nullptr) {
+    *outError = "Failed to open file for reading: " + path;
+  }
+  return false;
+}
+
+constexpr size_t kReadChunkBytes = size_t{1} << 16;
+
+}  // namespace
+
+MappedFile::~MappedFile() {
+  Close();
+}
+
+#if defined(_WIN32)
+
+bool MappedFile::Open(const std::string& path, std::string* outError) {
+  Close();
+
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return OpenFailed(path, outError);
+  }
+  file_ = file;
+  if (GetFileType(file) != FILE_TYPE_DISK) {
+    return ReadAll(path, outError);
+  }
+
+  LARGE_INTEGER size{};
+  if (!GetFileSizeEx(file, &size)) {
+    Close();
+    return OpenFailed(path, outError);
+  }
+  size_ = static_cast<size_t>(size.QuadPart);
+  if (size_ == 0) {
+    return true;
+  }
+
+  HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping == nullptr) {
+    Close();
+    return OpenFailed(path, outError);
+  }
+  mapping_ = mapping;
+
+  data_ = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+  if (data_ == nullptr) {
+    Close();
+    return OpenFailed(path, outError);
+  }
+  return true;
+}
+
+bool MappedFile::ReadAll(const std::string& path, std::string* outError) {
+  for (;;) {
+    const size_t used = buffer_.size();
+    buffer_.resize(used + kReadChunkBytes);
+    DWORD bytes = 0;
+    if (!ReadFile(static_cast<HANDLE>(file_), &buffer_[used], static_cast<DWORD>(kReadChunkBytes),
+                  &bytes, nullptr)) {
+      // The writer closing its end of a pipe ends the data rather than failing the read.
+      if (GetLastError() != ERROR_BROKEN_PIPE) {
+        Close();
+        return OpenFailed(path, outError);
+      }
+      bytes = 0;
+    }
+    buffer_.resize(used + bytes);
+    if (bytes == 0) {
+      break;
+    }
+  }
+  // Left null when empty, like an empty mapped file.
+  data_ = buffer_.empty() ? nullptr : buffer_.data();
+  size_ = buffer_.size();
+  return true;
+}
+
+void MappedFile::Close() {
+  if (data_ != nullptr && mapping_ != nullptr) {
+    UnmapViewOfFile(data_);
+  }
+  if (mapping_ != nullptr) {
+    CloseHandle(static_cast<HANDLE>(mapping_));
+  }
+  if (file_ != nullptr) {
+    CloseHandle(static_cast<HANDLE>(file_));
+  }
+  data_ = nullptr;
+  size_ = 0;
+  buffer_.clear();
+  buffer_.shrink_to_fit();
+  mapping_ = nullptr;
+  file_ = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& path, std::string* outError) {
+  Close();
+
+  fd_ = ::open(path.c_str(), O_RDONLY);
+  if (fd_ < 0) {
+    return OpenFailed(path, outError);
+  }
+
+  struct stat info {};
+  if (::fstat(fd_, &info) != 0) {
+    Close();
+    return OpenFailed(path, outError);
+  }
+  if (!S_ISREG(info.st_mode)) {
+    return ReadAll(path, outError);
+  }
+  size_ = static_cast<size_t>(info.st_size);
+  if (size_ == 0) {
+    return true;
+  }
+
+  void* mapped = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+  if (mapped == MAP_FAILED) {
+    Close();
+    return OpenFailed(path, outError);
+  }
+  ::madvise(mapped, size_, MADV_SEQUENTIAL);
+  data_ = static_cast<const char*>(mapped);
+  return true;
+}
+
+bool MappedFile::ReadAll(const std::string& path, std::string* outError) {
+  for (;;) {
+    const size_t used = buffer_.size();
+    buffer_.resize(used + kReadChunkBytes);
+    const ssize_t bytes = ::read(fd_, &buffer_[used], kReadChunkBytes);
+    if (bytes < 0 && errno == EINTR) {
+      buffer_.resize(used);
+      continue;
+    }
+    if (bytes < 0) {
+      Close();
+      return OpenFailed(path, outError);
+    }
+    buffer_.resize(used + static_cast<size_t>(bytes));
+    if (bytes == 0) {
+      break;
+    }
+  }
+  // Left null when empty, like an empty mapped file.
+  data_ = buffer_.empty() ? nullptr : buffer_.data();
+  size_ = buffer_.size();
+  return true;
+}
+
+void MappedFile::Close() {
+  if (data_ != nullptr && buffer_.empty()) {
+    ::munmap(const_cast<char*>(data_), size_);
+  }
+  if (fd_ >= 0) {
+    ::close(fd_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+  buffer_.clear();
+  buffer_.shrink_to_fit();
+  fd_ = -1;
+}
+
+#endif
+
+}  // namespace detail
+}  // namespace cgul
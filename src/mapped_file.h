@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace cgul {
+namespace detail {
+
+// Read-only view of a whole file. Regular files are memory-mapped; an empty file yields an
+// empty view without a mapping. Pipes, FIFOs and character devices (/dev/stdin, process
+// substitution) cannot be mapped, so they are read into an owned buffer instead.
+class MappedFile {
+ public:
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  bool Open(const std::string& path, std::string* outError);
+  void Close();
+
+  std::string_view view() const { return std::string_view(data_, size_); }
+
+ private:
+  // Reads the open file to its end into buffer_ and points the view at it.
+  bool ReadAll(const std::string& path, std::string* outError);
+
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+  std::string buffer_;  // holds the contents when the file is not mapped
+#if defined(_WIN32)
+  void* file_ = nullptr;
+  void* mapping_ = nullptr;
+#else
+  int fd_ = -1;
+#endif
+};
+
+}  // namespace detail
+}  // namespace cgul
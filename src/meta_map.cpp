@@ -0,0 +1,168 @@
+#include "cgul/core/meta_map.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <utility>
+
+namespace cgul {
+
+namespace {
+
+bool KeyLess(const MetaMap::value_type& entry, std::string_view key) {
+  return std::string_view(entry.first) < key;
+}
+
+}  // namespace
+
+const char* ToString(MetaType type) {
+  switch (type) {
+    case MetaType::String: return "string";
+    case MetaType::Int: return "int";
+    case MetaType::Bool: return "bool";
+    case MetaType::Float: return "float";
+  }
+  return "string";
+}
+
+MetaValue MetaValue::FromInt(int64_t value) {
+  return FromScalarBits(MetaType::Int, static_cast<uint64_t>(value));
+}
+
+MetaValue MetaValue::FromBool(bool value) {
+  return FromScalarBits(MetaType::Bool, value ? 1 : 0);
+}
+
+MetaValue MetaValue::FromFloat(double value) {
+  uint64_t bits = 0;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return FromScalarBits(MetaType::Float, bits);
+}
+
+MetaValue MetaValue::FromScalarBits(MetaType type, uint64_t bits) {
+  MetaValue value;
+  if (type != MetaType::String) {
+    value.type_ = type;
+    value.bits_ = type == MetaType::Bool ? (bits != 0 ? 1 : 0) : bits;
+  }
+  return value;
+}
+
+int64_t MetaValue::intValue() const {
+  return type_ == MetaType::Int ? static_cast<int64_t>(bits_) : 0;
+}
+
+bool MetaValue::boolValue() const { return type_ == MetaType::Bool && bits_ != 0; }
+
+double MetaValue::floatValue() const {
+  if (type_ != MetaType::Float) {
+    return 0.0;
+  }
+  double value = 0.0;
+  std::memcpy(&value, &bits_, sizeof(value));
+  return value;
+}
+
+std::string ToString(const MetaValue& value) {
+  char digits[32];
+  switch (value.type()) {
+    case MetaType::String:
+      return "\"" + value.text() + "\"";
+    case MetaType::Int: {
+      const auto result = std::to_chars(digits, digits + sizeof(digits), value.intValue());
+      return std::string(digits, result.ptr);
+    }
+    case MetaType::Bool:
+      return value.boolValue() ? "true" : "false";
+    case MetaType::Float: {
+      const auto result = std::to_chars(digits, digits + sizeof(digits), value.floatValue());
+      std::string text(digits, result.ptr);
+      if (text.find_first_of(".en") == std::string::npos) {
+        text.append(".0");
+      }
+      return text;
+    }
+  }
+  return std::string();
+}
+
+MetaMap::const_iterator MetaMap::find(std::string_view key) const {
+  const auto it = std::lower_bound(entries_.begin(), entries_.end(), key, KeyLess);
+  return it != entries_.end() && it->first == key ? it : entries_.end();
+}
+
+MetaValue& MetaMap::operator[](std::string_view key) {
+  auto it = LowerBound(key);
+  if (it == entries_.end() || it->first != key) {
+    it = entries_.emplace(it, std::string(key), MetaValue());
+  }
+  return it->second;
+}
+
+size_t MetaMap::erase(std::string_view key) {
+  const auto it = LowerBound(key);
+  if (it == entries_.end() || it->first != key) {
+    return 0;
+  }
+  entries_.erase(it);
+  return 1;
+}
+
+void MetaMap::Assign(std::vector<value_type> entries) {
+  entries_ = std::move(entries);
+  std::sort(entries_.begin(), entries_.end(),
+            [](const value_type& a, const value_type& b) { return a.first < b.first; });
+}
+
+const MetaValue* MetaMap::Find(std::string_view key) const {
+  const auto it = find(key);
+  return it != end() ? &it->second : nullptr;
+}
+
+bool MetaMap::GetString(std::string_view key, std::string* out) const {
+  const MetaValue* value = Find(key);
+  if (value == nullptr || !value->isString()) {
+    return false;
+  }
+  *out = value->text();
+  return true;
+}
+
+bool MetaMap::GetInt(std::string_view key, int64_t* out) const {
+  const MetaValue* value = Find(key);
+  if (value == nullptr || value->type() != MetaType::Int) {
+    return false;
+  }
+  *out = value->intValue();
+  return true;
+}
+
+bool MetaMap::GetBool(std::string_view key, bool* out) const {
+  const MetaValue* value = Find(key);
+  if (value == nullptr || value->type() != MetaType::Bool) {
+    return false;
+  }
+  *out = value->boolValue();
+  return true;
+}
+
+bool MetaMap::GetFloat(std::string_view key, double* out) const {
+  const MetaValue* value = Find(key);
+  if (value == nullptr) {
+    return false;
+  }
+  if (value->type() == MetaType::Float) {
+    *out = value->floatValue();
+  } else if (value->type() == MetaType::Int) {
+    *out = static_cast<double>(value->intValue());
+  } else {
+    return false;
+  }
+  return true;
+}
+
+std::vector<MetaMap::value_type>::iterator MetaMap::LowerBound(std::string_view key) {
+  return std::lower_bound(entries_.begin(), entries_.end(), key, KeyLess);
+}
+
+}  // namespace cgul
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cgul {
+namespace detail {
+
+// Resolves a requested worker count (0 = hardware concurrency) against the amount of work.
+inline unsigned ResolveWorkerCount(unsigned requested, size_t itemCount) {
+  unsigned workers = requested;
+  if (workers == 0) {
+    workers = std::max(1u, std::thread::hardware_concurrency());
+  }
+  if (itemCount < workers) {
+    workers = static_cast<unsigned>(std::max<size_t>(1, itemCount));
+  }
+  return workers;
+}
+
+// Calls fn(index, worker) for every index in [0, count), handing indices out dynamically to
+// `workerCount` workers. Worker 0 is the calling thread. If fn throws, no further indices are
+// handed out and the first exception is rethrown on the calling thread once every worker has
+// stopped.
+template <typename Fn>
+void ParallelFor(size_t count, unsigned workerCount, Fn&& fn) {
+  if (count == 0) {
+    return;
+  }
+  workerCount = std::max(1u, workerCount);
+
+  std::atomic<size_t> next{0};
+  std::mutex errorMutex;
+  std::exception_ptr firstError;
+  auto run = [&](unsigned worker) {
+    try {
+      while (true) {
+        const size_t index = next.fetch_add(1, std::memory_order_relaxed);
+        if (index >= count) {
+          return;
+        }
+        fn(index, worker);
+      }
+    } catch (...) {
+      next.store(count, std::memory_order_relaxed);
+      std::lock_guard<std::mutex> lock(errorMutex);
+      if (!firstError) {
+        firstError = std::current_exception();
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(workerCount - 1);
+  for (unsigned worker = 1; worker < workerCount; ++worker) {
+    threads.emplace_back(run, worker);
+  }
+  run(0);
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  if (firstError) {
+    std::rethrow_exception(firstError);
+  }
+}
+
+}  // namespace detail
+}  // namespace cgul
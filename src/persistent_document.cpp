@@ -0,0 +1,225 @@
+#include "cgul/core/persistent_document.h"
+
+#include <algorithm>
+#include <iterator>
+#include <unordered_set>
+#include <utility>
+
+namespace cgul {
+
+PersistentDocument::PersistentDocument() : header_(std::make_shared<const Header>()) {}
+
+PersistentDocument PersistentDocument::FromDocument(const CgulDocument& doc) {
+  PersistentDocument result;
+  Header* header = result.MutableHeader();
+  header->cgulVersion = doc.cgulVersion;
+  header->gridWCells = doc.gridWCells;
+  header->gridHCells = doc.gridHCells;
+  header->seed = doc.seed;
+  header->meta = doc.meta;
+
+  result.chunks_.reserve((doc.widgets.size() + kChunkWidgets - 1) / kChunkWidgets);
+  for (size_t first = 0; first < doc.widgets.size(); first += kChunkWidgets) {
+    const size_t last = std::min(first + kChunkWidgets, doc.widgets.size());
+    const auto begin = doc.widgets.begin();
+    result.chunks_.push_back(ChunkRef{
+        std::make_shared<const Chunk>(begin + static_cast<std::ptrdiff_t>(first),
+                                      begin + static_cast<std::ptrdiff_t>(last)),
+        last});
+  }
+  return result;
+}
+
+CgulDocument PersistentDocument::ToDocument() const {
+  CgulDocument doc;
+  doc.cgulVersion = header_->cgulVersion;
+  doc.gridWCells = header_->gridWCells;
+  doc.gridHCells = header_->gridHCells;
+  doc.seed = header_->seed;
+  doc.meta = header_->meta;
+  doc.widgets.reserve(widgetCount());
+  for (const ChunkRef& chunk : chunks_) {
+    doc.widgets.insert(doc.widgets.end(), chunk.widgets->begin(), chunk.widgets->end());
+  }
+  return doc;
+}
+
+const Widget& PersistentDocument::widget(size_t position) const {
+  const size_t chunk = ChunkFor(position);
+  const size_t first = chunk == 0 ? 0 : chunks_[chunk - 1].end;
+  return (*chunks_[chunk].widgets)[position - first];
+}
+
+size_t PersistentDocument::PositionOf(uint32_t id) const {
+  size_t position = 0;
+  for (const ChunkRef& chunk : chunks_) {
+    for (const Widget& widget : *chunk.widgets) {
+      if (widget.id == id) {
+        return position;
+      }
+      ++position;
+    }
+  }
+  return kNotFound;
+}
+
+PersistentDocument PersistentDocument::WithWidget(size_t position, const Widget& widget) const {
+  PersistentDocument result = *this;
+  if (position >= widgetCount()) {
+    return result;
+  }
+  const size_t chunk = ChunkFor(position);
+  const size_t first = chunk == 0 ? 0 : chunks_[chunk - 1].end;
+  auto copy = std::make_shared<Chunk>(*chunks_[chunk].widgets);
+  (*copy)[position - first] = widget;
+  result.chunks_[chunk].widgets = std::move(copy);
+  return result;
+}
+
+PersistentDocument PersistentDocument::WithWidgetInserted(size_t position,
+                                                          const Widget& widget) const {
+  PersistentDocument result = *this;
+  if (chunks_.empty()) {
+    result.chunks_.push_back(ChunkRef{std::make_shared<const Chunk>(1, widget), 1});
+    return result;
+  }
+
+  position = std::min(position, widgetCount());
+  // Appends go to the last chunk; other positions to the chunk holding that position.
+  const size_t chunk = position == widgetCount() ? chunks_.size() - 1 : ChunkFor(position);
+  const size_t first = chunk == 0 ? 0 : chunks_[chunk - 1].end;
+  auto copy = std::make_shared<Chunk>(*chunks_[chunk].widgets);
+  copy->insert(copy->begin() + static_cast<std::ptrdiff_t>(position - first), widget);
+  for (size_t i = chunk; i < result.chunks_.size(); ++i) {
+    ++result.chunks_[i].end;
+  }
+
+  if (copy->size() <= kChunkWidgets) {
+    result.chunks_[chunk].widgets = std::move(copy);
+    return result;
+  }
+  // Split a full chunk in half so later inserts nearby stay cheap.
+  const size_t half = copy->size() / 2;
+  auto tail = std::make_shared<const Chunk>(copy->begin() + static_cast<std::ptrdiff_t>(half),
+                                            copy->end());
+  copy->resize(half);
+  result.chunks_[chunk].widgets = std::move(copy);
+  result.chunks_.insert(result.chunks_.begin() + static_cast<std::ptrdiff_t>(chunk) + 1,
+                        ChunkRef{std::move(tail), result.chunks_[chunk].end});
+  result.chunks_[chunk].end = first + half;
+  return result;
+}
+
+PersistentDocument PersistentDocument::WithWidgetRemoved(size_t position) const {
+  PersistentDocument result = *this;
+  if (position >= widgetCount()) {
+    return result;
+  }
+  const size_t chunk = ChunkFor(position);
+  const size_t first = chunk == 0 ? 0 : chunks_[chunk - 1].end;
+  for (size_t i = chunk; i < result.chunks_.size(); ++i) {
+    --result.chunks_[i].end;
+  }
+  if (chunks_[chunk].widgets->size() == 1) {
+    result.chunks_.erase(result.chunks_.begin() + static_cast<std::ptrdiff_t>(chunk));
+    return result;
+  }
+  auto copy = std::make_shared<Chunk>(*chunks_[chunk].widgets);
+  copy->erase(copy->begin() + static_cast<std::ptrdiff_t>(position - first));
+  result.chunks_[chunk].widgets = std::move(copy);
+  return result;
+}
+
+PersistentDocument PersistentDocument::WithWidgetMoved(size_t from, size_t to) const {
+  if (from >= widgetCount() || from == to) {
+    return *this;
+  }
+  const Widget moved = widget(from);
+  return WithWidgetRemoved(from).WithWidgetInserted(to, moved);
+}
+
+PersistentDocument PersistentDocument::WithGrid(int gridWCells, int gridHCells) const {
+  PersistentDocument result = *this;
+  Header* header = result.MutableHeader();
+  header->gridWCells = gridWCells;
+  header->gridHCells = gridHCells;
+  return result;
+}
+
+PersistentDocument PersistentDocument::WithSeed(uint64_t seed) const {
+  PersistentDocument result = *this;
+  result.MutableHeader()->seed = seed;
+  return result;
+}
+
+PersistentDocument PersistentDocument::WithMeta(const std::string& key,
+                                                const MetaValue& value) const {
+  PersistentDocument result = *this;
+  result.MutableHeader()->meta[key] = value;
+  return result;
+}
+
+PersistentDocument PersistentDocument::WithoutMeta(const std::string& key) const {
+  PersistentDocument result = *this;
+  result.MutableHeader()->meta.erase(key);
+  return result;
+}
+
+size_t PersistentDocument::MemoryBytes() const {
+  size_t bytes = chunks_.capacity() * sizeof(ChunkRef) + HeaderBytes(*header_);
+  for (const ChunkRef& chunk : chunks_) {
+    bytes += ChunkBytes(*chunk.widgets);
+  }
+  return bytes;
+}
+
+size_t PersistentDocument::BytesNotSharedWith(const PersistentDocument& base) const {
+  // The chunk list itself is never shared; chunks and the header are shared by pointer.
+  size_t bytes = chunks_.capacity() * sizeof(ChunkRef);
+  if (header_ != base.header_) {
+    bytes += HeaderBytes(*header_);
+  }
+  std::unordered_set<const Chunk*> shared;
+  shared.reserve(base.chunks_.size());
+  for (const ChunkRef& chunk : base.chunks_) {
+    shared.insert(chunk.widgets.get());
+  }
+  for (const ChunkRef& chunk : chunks_) {
+    if (shared.count(chunk.widgets.get()) == 0) {
+      bytes += ChunkBytes(*chunk.widgets);
+    }
+  }
+  return bytes;
+}
+
+size_t PersistentDocument::ChunkFor(size_t position) const {
+  const auto it = std::upper_bound(
+      chunks_.begin(), chunks_.end(), position,
+      [](size_t value, const ChunkRef& chunk) { return value < chunk.end; });
+  return static_cast<size_t>(std::distance(chunks_.begin(), it));
+}
+
+size_t PersistentDocument::ChunkBytes(const Chunk& chunk) {
+  size_t bytes = sizeof(Chunk) + (chunk.capacity() - chunk.size()) * sizeof(Widget);
+  for (const Widget& widget : chunk) {
+    bytes += sizeof(Widget) + widget.title.size();
+  }
+  return bytes;
+}
+
+size_t PersistentDocument::HeaderBytes(const Header& header) {
+  size_t bytes = sizeof(Header) + header.cgulVersion.size();
+  for (const auto& entry : header.meta) {
+    bytes += sizeof(MetaMap::value_type) + entry.first.size() + entry.second.text().size();
+  }
+  return bytes;
+}
+
+PersistentDocument::Header* PersistentDocument::MutableHeader() {
+  auto header = std::make_shared<Header>(*header_);
+  Header* raw = header.get();
+  header_ = std::move(header);
+  return raw;
+}
+
+}  // namespace cgul
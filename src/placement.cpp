@@ -0,0 +1,183 @@
+#include "cgul/core/placement.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+#include "cgul/core/cell_occupancy.h"
+
+namespace cgul {
+
+namespace {
+
+bool Fail(const std::string& message, std::string* outError) {
+  if (outError != nullptr) {
+    *outError = message;
+  }
+  return false;
+}
+
+// Half-size of the first window of origins searched, in cells.
+constexpr int64_t kInitialSearchRadius = 64;
+
+// Origins [x0, x1) x [y0, y1), a sub-range of the grid's valid origins.
+struct SearchWindow {
+  int x0 = 0;
+  int y0 = 0;
+  int x1 = 0;
+  int y1 = 0;
+};
+
+// Smallest squared distance from the desired origin to any origin beyond an edge of the
+// window that is not also an edge of the grid; infinity when the window is the whole grid.
+double OutsideDistanceSquared(const SearchWindow& window, int originsW, int originsH,
+                              int64_t wantX, int64_t wantY) {
+  double margin = std::numeric_limits<double>::infinity();
+  if (window.x0 > 0) {
+    margin = std::min(margin, static_cast<double>(wantX - window.x0 + 1));
+  }
+  if (window.y0 > 0) {
+    margin = std::min(margin, static_cast<double>(wantY - window.y0 + 1));
+  }
+  if (window.x1 < originsW) {
+    margin = std::min(margin, static_cast<double>(window.x1 - wantX));
+  }
+  if (window.y1 < originsH) {
+    margin = std::min(margin, static_cast<double>(window.y1 - wantY));
+  }
+  return margin * margin;
+}
+
+// Nearest origin inside the window at which a w x h window overlaps no other window.
+bool SearchNearest(const CgulDocument& doc, const Widget& self, int w, int h,
+                   const SearchWindow& window, int64_t wantX, int64_t wantY, int startX,
+                   int startY, RectI* outRect, double* outDistance) {
+  // A window at r blocks origins (r.x - w, r.x + r.w) x (r.y - h, r.y + r.h); bit (x, y) of
+  // blocked is origin (window.x0 + x, window.y0 + y).
+  const int windowW = window.x1 - window.x0;
+  const int windowH = window.y1 - window.y0;
+  CellOccupancy blocked(windowW, windowH);
+  for (const Widget& widget : doc.widgets) {
+    const RectI& r = widget.boundsCells;
+    if (&widget == &self || widget.kind != WidgetKind::Window || r.w <= 0 || r.h <= 0) {
+      continue;
+    }
+    const int64_t x0 = static_cast<int64_t>(r.x) - w + 1 - window.x0;
+    const int64_t y0 = static_cast<int64_t>(r.y) - h + 1 - window.y0;
+    const int64_t x1 = static_cast<int64_t>(r.x) + r.w - window.x0;
+    const int64_t y1 = static_cast<int64_t>(r.y) + r.h - window.y0;
+    if (x1 <= 0 || y1 <= 0 || x0 >= windowW || y0 >= windowH) {
+      continue;
+    }
+    const int cx0 = static_cast<int>(std::max<int64_t>(x0, 0));
+    const int cy0 = static_cast<int>(std::max<int64_t>(y0, 0));
+    blocked.Fill(RectI{cx0, cy0, static_cast<int>(std::min<int64_t>(x1, windowW)) - cx0,
+                       static_cast<int>(std::min<int64_t>(y1, windowH)) - cy0});
+  }
+
+  // Rows in order of distance from the desired row; in each, the free origins nearest to the
+  // desired column on either side. Vertical distance only grows away from the start row, so once
+  // a row is outside the window or farther than the best so far, so is every row beyond it.
+  // Squared distances as doubles: desired origins far outside the grid would overflow int64.
+  bool found = false;
+  double bestDistance = 0.0;
+  const int localStartX = startX - window.x0;
+  const auto searchRow = [&](int y) {
+    const double dy = static_cast<double>(y - wantY);
+    if (y < window.y0 || y >= window.y1 || (found && dy * dy > bestDistance)) {
+      return false;
+    }
+    const int row = y - window.y0;
+    for (const int localX : {blocked.FindFreeSpan(row, localStartX, 1),
+                             blocked.FindLastFreeCell(row, localStartX)}) {
+      const int x = window.x0 + localX;
+      const double dx = static_cast<double>(x - wantX);
+      if (localX >= 0 && (!found || dx * dx + dy * dy < bestDistance)) {
+        found = true;
+        bestDistance = dx * dx + dy * dy;
+        *outRect = RectI{x, y, w, h};
+      }
+    }
+    return true;
+  };
+  searchRow(startY);
+  bool searchAbove = true;
+  bool searchBelow = true;
+  for (int step = 1; searchAbove || searchBelow; ++step) {
+    searchAbove = searchAbove && searchRow(startY - step);
+    searchBelow = searchBelow && searchRow(startY + step);
+  }
+  *outDistance = bestDistance;
+  return found;
+}
+
+}  // namespace
+
+bool FindNearestFreePlacement(const CgulDocument& doc, uint32_t widgetId,
+                              const RectI& desiredRect, RectI* outRect, std::string* outError) {
+  if (outError != nullptr) {
+    outError->clear();
+  }
+
+  const Widget* self = nullptr;
+  for (const Widget& widget : doc.widgets) {
+    if (widget.id == widgetId) {
+      self = &widget;
+      break;
+    }
+  }
+  if (self == nullptr) {
+    return Fail("unknown widget id " + std::to_string(widgetId), outError);
+  }
+  const int w = desiredRect.w;
+  const int h = desiredRect.h;
+  if (w <= 0 || h <= 0 || w > doc.gridWCells || h > doc.gridHCells) {
+    return Fail("widget " + std::to_string(widgetId) + " size does not fit the grid", outError);
+  }
+
+  // Origin (x, y) puts the widget at [x, x + w) x [y, y + h).
+  const int originsW = doc.gridWCells - w + 1;
+  const int originsH = doc.gridHCells - h + 1;
+  const int64_t wantX = desiredRect.x;
+  const int64_t wantY = desiredRect.y;
+  const int startX = static_cast<int>(std::clamp<int64_t>(wantX, 0, originsW - 1));
+  const int startY = static_cast<int>(std::clamp<int64_t>(wantY, 0, originsH - 1));
+  if (self->kind != WidgetKind::Window) {
+    *outRect = RectI{startX, startY, w, h};
+    return true;
+  }
+
+  // Search a window of origins around the start first and widen it only when the best
+  // position found might be beaten by one outside, so a drag step near free space never
+  // touches the whole grid.
+  bool found = false;
+  RectI best;
+  for (int64_t radius = kInitialSearchRadius;; radius *= 4) {
+    SearchWindow window;
+    window.x0 = static_cast<int>(std::max<int64_t>(0, startX - radius));
+    window.y0 = static_cast<int>(std::max<int64_t>(0, startY - radius));
+    window.x1 = static_cast<int>(std::min<int64_t>(originsW, startX + radius + 1));
+    window.y1 = static_cast<int>(std::min<int64_t>(originsH, startY + radius + 1));
+    // A window that is most of the grid costs about as much as the grid; skip a pass.
+    if (2 * static_cast<int64_t>(window.x1 - window.x0) * (window.y1 - window.y0) >=
+        static_cast<int64_t>(originsW) * originsH) {
+      window = SearchWindow{0, 0, originsW, originsH};
+    }
+    double bestDistance = 0.0;
+    found = SearchNearest(doc, *self, w, h, window, wantX, wantY, startX, startY, &best,
+                          &bestDistance);
+    const bool wholeGrid =
+        window.x0 == 0 && window.y0 == 0 && window.x1 == originsW && window.y1 == originsH;
+    if (wholeGrid || (found && bestDistance < OutsideDistanceSquared(window, originsW, originsH,
+                                                                     wantX, wantY))) {
+      break;
+    }
+  }
+  if (!found) {
+    return Fail("no free position for widget " + std::to_string(widgetId), outError);
+  }
+  *outRect = best;
+  return true;
+}
+
+}  // namespace cgul
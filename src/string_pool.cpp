@@ -0,0 +1,64 @@
+#include "cgul/core/string_pool.h"
+
+#include <cstring>
+
+namespace cgul {
+
+namespace {
+
+constexpr size_t kBlockSize = 64 * 1024;
+// Longer strings get a block of their own so they do not strand the rest of a shared block.
+constexpr size_t kMaxSharedLength = kBlockSize / 8;
+
+}  // namespace
+
+StringPool::StringPool() {
+  strings_.emplace_back();
+  handles_.emplace(std::string_view(), 0);
+}
+
+StringHandle StringPool::Intern(std::string_view text) {
+  const auto it = handles_.find(text);
+  if (it != handles_.end()) {
+    return StringHandle{it->second};
+  }
+
+  const std::string_view stored(Store(text), text.size());
+  const uint32_t value = static_cast<uint32_t>(strings_.size());
+  strings_.push_back(stored);
+  handles_.emplace(stored, value);
+  return StringHandle{value};
+}
+
+bool StringPool::Find(std::string_view text, StringHandle* outHandle) const {
+  const auto it = handles_.find(text);
+  if (it == handles_.end()) {
+    return false;
+  }
+  if (outHandle != nullptr) {
+    *outHandle = StringHandle{it->second};
+  }
+  return true;
+}
+
+const char* StringPool::Store(std::string_view text) {
+  bytes_ += text.size();
+  if (text.size() > kMaxSharedLength) {
+    blocks_.push_back(std::make_unique<char[]>(text.size()));
+    std::memcpy(blocks_.back().get(), text.data(), text.size());
+    return blocks_.back().get();
+  }
+
+  if (remaining_ < text.size()) {
+    blocks_.push_back(std::make_unique<char[]>(kBlockSize));
+    cursor_ = blocks_.back().get();
+    remaining_ = kBlockSize;
+  }
+  char* dest = cursor_;
+  std::memcpy(dest, text.data(), text.size());
+  cursor_ += text.size();
+  remaining_ -= text.size();
+  return dest;
+}
+
+}  // namespace cgul
@@ -1,13 +1,48 @@
 #include "cgul/validate/validate.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <iterator>
+#include <set>
 #include <string>
-#include <unordered_set>
+#include <vector>
+
+#include "cgul/core/document_index.h"
+#include "parallel_for.h"
 
 namespace cgul {
 
 namespace {
 
+bool Fail(const std::string& message, std::string* outError) {
+  if (outError != nullptr) {
+    *outError = message;
+  }
+  return false;
+}
+
+// Per-widget bounds rules shared by Validate and ValidateEdit; empty when the bounds are valid.
+std::string BoundsError(uint32_t id, const RectI& bounds, int gridWCells, int gridHCells) {
+  if (bounds.w <= 0 || bounds.h <= 0) {
+    return "widget " + std::to_string(id) + " has non-positive bounds dimensions";
+  }
+  if (bounds.x < 0 || bounds.y < 0) {
+    return "widget " + std::to_string(id) + " has negative bounds origin";
+  }
+  const int64_t right = static_cast<int64_t>(bounds.x) + static_cast<int64_t>(bounds.w);
+  const int64_t bottom = static_cast<int64_t>(bounds.y) + static_cast<int64_t>(bounds.h);
+  if (right > gridWCells || bottom > gridHCells) {
+    return "widget " + std::to_string(id) + " bounds exceed grid limits";
+  }
+  return std::string();
+}
+
+// Ids in document order.
+std::string OverlapError(uint32_t firstId, uint32_t secondId) {
+  return "window overlap is not allowed in v0.1 (ids " + std::to_string(firstId) + " and " +
+         std::to_string(secondId) + ")";
+}
+
 bool RectsOverlap(const RectI& a, const RectI& b) {
   const int64_t aRight = static_cast<int64_t>(a.x) + static_cast<int64_t>(a.w);
   const int64_t bRight = static_cast<int64_t>(b.x) + static_cast<int64_t>(b.w);
@@ -17,6 +52,99 @@ bool RectsOverlap(const RectI& a, const RectI& b) {
   return a.x < bRight && b.x < aRight && a.y < bBottom && b.y < aBottom;
 }
 
+// Active windows on the sweep line, ordered by top edge. While no overlap has been found they
+// are disjoint in y, so a new window can only overlap its neighbours in this order.
+struct ActiveSpan {
+  int64_t top = 0;
+  int64_t bottom = 0;
+  size_t index = 0;
+
+  bool operator<(const ActiveSpan& other) const {
+    return top != other.top ? top < other.top : index < other.index;
+  }
+};
+
+// Sweeps window x-intervals left to right in O(n log n) and reports whether any two windows
+// overlap; *outIndex is the smaller document index of the first overlapping pair found.
+bool FindAnyOverlap(const std::vector<const Widget*>& windows, size_t* outIndex) {
+  std::vector<size_t> byLeft(windows.size());
+  for (size_t i = 0; i < byLeft.size(); ++i) {
+    byLeft[i] = i;
+  }
+  std::vector<size_t> byRight = byLeft;
+  const auto right = [&windows](size_t i) {
+    return static_cast<int64_t>(windows[i]->boundsCells.x) + windows[i]->boundsCells.w;
+  };
+  std::sort(byLeft.begin(), byLeft.end(), [&windows](size_t a, size_t b) {
+    return windows[a]->boundsCells.x < windows[b]->boundsCells.x;
+  });
+  std::sort(byRight.begin(), byRight.end(),
+            [&right](size_t a, size_t b) { return right(a) < right(b); });
+
+  std::set<ActiveSpan> active;
+  size_t expired = 0;
+  for (const size_t i : byLeft) {
+    const RectI& bounds = windows[i]->boundsCells;
+    // Edges that only touch do not overlap, so windows ending here leave first.
+    for (; expired < byRight.size() && right(byRight[expired]) <= bounds.x; ++expired) {
+      const RectI& old = windows[byRight[expired]]->boundsCells;
+      active.erase(ActiveSpan{old.y, 0, byRight[expired]});
+    }
+
+    const ActiveSpan span{bounds.y, static_cast<int64_t>(bounds.y) + bounds.h, i};
+    const auto next = active.lower_bound(span);
+    size_t other = SIZE_MAX;
+    if (next != active.end() && next->top < span.bottom) {
+      other = next->index;
+    } else if (next != active.begin() && std::prev(next)->bottom > span.top) {
+      other = std::prev(next)->index;
+    }
+    if (other != SIZE_MAX) {
+      *outIndex = std::min(i, other);
+      return true;
+    }
+    active.insert(next, span);
+  }
+  return false;
+}
+
+// Edge length of the square buckets of a uniform grid over windows. Buckets about as large as
+// an average window keep each one to a few entries; their count is capped so huge grids with
+// few windows stay small.
+int64_t ChooseBucketCells(int64_t gridW, int64_t gridH, size_t windowCount, int64_t extentSum) {
+  const int64_t maxBuckets = std::max<int64_t>(1024, 4 * static_cast<int64_t>(windowCount));
+  int64_t bucketCells = windowCount == 0
+                            ? gridW
+                            : std::max<int64_t>(1, extentSum / static_cast<int64_t>(windowCount));
+  while (((gridW + bucketCells - 1) / bucketCells) * ((gridH + bucketCells - 1) / bucketCells) >
+         maxBuckets) {
+    bucketCells *= 2;
+  }
+  return bucketCells;
+}
+
+// Bucket of a cell coordinate. Cells outside the grid land in the edge buckets, so every
+// overlap is still seen.
+int BucketOf(int64_t cell, int64_t bucketCells, int bucketCount) {
+  return static_cast<int>(std::clamp<int64_t>(cell / bucketCells, 0, bucketCount - 1));
+}
+
+// The first pair in document order, as a pairwise scan would report it. Windows before the
+// first one that overlaps a later window cannot overlap anything, so the scan stops there; a
+// known overlapping window `limit` bounds it.
+void FindFirstOverlap(const std::vector<const Widget*>& windows, size_t limit,
+                      size_t* outFirst, size_t* outSecond) {
+  for (size_t i = 0; i <= limit; ++i) {
+    for (size_t j = i + 1; j < windows.size(); ++j) {
+      if (RectsOverlap(windows[i]->boundsCells, windows[j]->boundsCells)) {
+        *outFirst = i;
+        *outSecond = j;
+        return;
+      }
+    }
+  }
+}
+
 }  // namespace
 
 bool Validate(const CgulDocument& doc, std::string* outError) {
@@ -39,8 +167,8 @@ bool Validate(const CgulDocument& doc, std::string* outError) {
     return fail("grid width and height must be > 0");
   }
 
-  std::unordered_set<uint32_t> seenIds;
-  seenIds.reserve(doc.widgets.size());
+  WidgetIdMap seenIds;
+  seenIds.Reserve(doc.widgets.size());
 
   for (size_t i = 0; i < doc.widgets.size(); ++i) {
     const Widget& widget = doc.widgets[i];
@@ -48,45 +176,398 @@ bool Validate(const CgulDocument& doc, std::string* outError) {
     if (widget.id == 0) {
       return fail("widget id must be non-zero (index " + std::to_string(i) + ")");
     }
-    if (!seenIds.insert(widget.id).second) {
+    if (!seenIds.Insert(widget.id, i)) {
       return fail("duplicate widget id: " + std::to_string(widget.id));
     }
 
-    if (widget.boundsCells.w <= 0 || widget.boundsCells.h <= 0) {
-      return fail("widget " + std::to_string(widget.id) + " has non-positive bounds dimensions");
+    const std::string boundsError =
+        BoundsError(widget.id, widget.boundsCells, doc.gridWCells, doc.gridHCells);
+    if (!boundsError.empty()) {
+      return fail(boundsError);
     }
-    if (widget.boundsCells.x < 0 || widget.boundsCells.y < 0) {
-      return fail("widget " + std::to_string(widget.id) + " has negative bounds origin");
+  }
+
+  std::vector<const Widget*> windows;
+  for (const Widget& widget : doc.widgets) {
+    if (widget.kind == WidgetKind::Window) {
+      windows.push_back(&widget);
     }
+  }
+  size_t limit = 0;
+  if (FindAnyOverlap(windows, &limit)) {
+    size_t first = 0;
+    size_t second = 0;
+    FindFirstOverlap(windows, limit, &first, &second);
+    return fail(OverlapError(windows[first]->id, windows[second]->id));
+  }
+
+  return true;
+}
 
-    const int64_t right = static_cast<int64_t>(widget.boundsCells.x) +
-                          static_cast<int64_t>(widget.boundsCells.w);
-    const int64_t bottom = static_cast<int64_t>(widget.boundsCells.y) +
-                           static_cast<int64_t>(widget.boundsCells.h);
+const char* ToString(ValidationRule rule) {
+  switch (rule) {
+    case ValidationRule::Version: return "version";
+    case ValidationRule::Grid: return "grid";
+    case ValidationRule::WidgetId: return "widget-id";
+    case ValidationRule::DuplicateId: return "duplicate-id";
+    case ValidationRule::Bounds: return "bounds";
+    case ValidationRule::WindowOverlap: return "window-overlap";
+  }
+  return "version";
+}
 
-    if (right > doc.gridWCells || bottom > doc.gridHCells) {
-      return fail("widget " + std::to_string(widget.id) + " bounds exceed grid limits");
-    }
+bool ValidateAll(const CgulDocument& doc, const ValidateAllOptions& options,
+                 ValidationReport* outReport) {
+  // Widgets or windows per task. Each task keeps its issues in document order and stops once it
+  // has more than the cap, so concatenating the tasks in order yields the first issues overall.
+  constexpr size_t kChunkSize = 2048;
+  const size_t cap = options.maxIssues == 0 ? SIZE_MAX : options.maxIssues;
+  const auto full = [cap](const std::vector<ValidationIssue>& issues) {
+    return issues.size() > cap;
+  };
+
+  std::vector<ValidationIssue> issues;
+  if (doc.cgulVersion != "0.1") {
+    issues.push_back(ValidationIssue{ValidationRule::Version, ValidationIssue::kNoWidget, 0,
+                                     ValidationIssue::kNoWidget, 0,
+                                     "cgulVersion must be \"0.1\""});
+  }
+  const bool gridValid = doc.gridWCells > 0 && doc.gridHCells > 0;
+  if (!gridValid) {
+    issues.push_back(ValidationIssue{ValidationRule::Grid, ValidationIssue::kNoWidget, 0,
+                                     ValidationIssue::kNoWidget, 0,
+                                     "grid width and height must be > 0"});
   }
 
+  // The first position of each id; the duplicate checks below run in parallel against it.
+  WidgetIdMap firstIds;
+  firstIds.Reserve(doc.widgets.size());
+  std::vector<size_t> windows;
+  int64_t extentSum = 0;
   for (size_t i = 0; i < doc.widgets.size(); ++i) {
-    const Widget& a = doc.widgets[i];
-    if (a.kind != WidgetKind::Window) {
-      continue;
-    }
-    for (size_t j = i + 1; j < doc.widgets.size(); ++j) {
-      const Widget& b = doc.widgets[j];
-      if (b.kind != WidgetKind::Window) {
-        continue;
+    const Widget& widget = doc.widgets[i];
+    firstIds.Insert(widget.id, i);
+    if (widget.kind == WidgetKind::Window) {
+      windows.push_back(i);
+      extentSum += std::max(widget.boundsCells.w, widget.boundsCells.h);
+    }
+  }
+
+  const size_t widgetChunks = (doc.widgets.size() + kChunkSize - 1) / kChunkSize;
+  const size_t windowChunks = (windows.size() + kChunkSize - 1) / kChunkSize;
+  const unsigned workers =
+      detail::ResolveWorkerCount(options.threadCount, std::max(widgetChunks, windowChunks));
+
+  std::vector<std::vector<ValidationIssue>> widgetIssues(widgetChunks);
+  detail::ParallelFor(widgetChunks, workers, [&](size_t chunk, unsigned) {
+    std::vector<ValidationIssue>& out = widgetIssues[chunk];
+    const size_t end = std::min(doc.widgets.size(), (chunk + 1) * kChunkSize);
+    for (size_t i = chunk * kChunkSize; i < end && !full(out); ++i) {
+      const Widget& widget = doc.widgets[i];
+      if (widget.id == 0) {
+        out.push_back(ValidationIssue{ValidationRule::WidgetId, i, 0, ValidationIssue::kNoWidget,
+                                      0, "widget id must be non-zero (index " +
+                                             std::to_string(i) + ")"});
+      } else {
+        const size_t first = firstIds.Find(widget.id);
+        if (first != i) {
+          out.push_back(ValidationIssue{ValidationRule::DuplicateId, i, widget.id, first,
+                                        widget.id,
+                                        "duplicate widget id: " + std::to_string(widget.id)});
+        }
       }
-      if (RectsOverlap(a.boundsCells, b.boundsCells)) {
-        return fail("window overlap is not allowed in v0.1 (ids " +
-                    std::to_string(a.id) + " and " + std::to_string(b.id) + ")");
+      if (gridValid) {
+        std::string boundsError =
+            BoundsError(widget.id, widget.boundsCells, doc.gridWCells, doc.gridHCells);
+        if (!boundsError.empty()) {
+          out.push_back(ValidationIssue{ValidationRule::Bounds, i, widget.id,
+                                        ValidationIssue::kNoWidget, 0, std::move(boundsError)});
+        }
       }
     }
+  });
+  for (std::vector<ValidationIssue>& chunk : widgetIssues) {
+    for (size_t i = 0; i < chunk.size() && !full(issues); ++i) {
+      issues.push_back(std::move(chunk[i]));
+    }
   }
 
+  // Overlapping window pairs, found through a uniform bucket grid stored as one flat array per
+  // bucket range. A pair sharing several buckets is reported only from the bucket holding the
+  // top-left cell of its intersection.
+  std::vector<std::vector<ValidationIssue>> overlapIssues(full(issues) ? 0 : windowChunks);
+  if (!overlapIssues.empty()) {
+    const int64_t gridW = std::max(doc.gridWCells, 1);
+    const int64_t gridH = std::max(doc.gridHCells, 1);
+    const int64_t bucketCells = ChooseBucketCells(gridW, gridH, windows.size(), extentSum);
+    const int bucketsX = static_cast<int>((gridW + bucketCells - 1) / bucketCells);
+    const int bucketsY = static_cast<int>((gridH + bucketCells - 1) / bucketCells);
+    const auto forEachBucket = [&](const RectI& bounds, auto&& visit) {
+      if (bounds.w <= 0 || bounds.h <= 0) {
+        return;
+      }
+      const int x0 = BucketOf(bounds.x, bucketCells, bucketsX);
+      const int x1 = BucketOf(static_cast<int64_t>(bounds.x) + bounds.w - 1, bucketCells, bucketsX);
+      const int y0 = BucketOf(bounds.y, bucketCells, bucketsY);
+      const int y1 = BucketOf(static_cast<int64_t>(bounds.y) + bounds.h - 1, bucketCells, bucketsY);
+      for (int y = y0; y <= y1; ++y) {
+        for (int x = x0; x <= x1; ++x) {
+          visit(static_cast<size_t>(y) * static_cast<size_t>(bucketsX) + static_cast<size_t>(x));
+        }
+      }
+    };
+
+    // Buckets list window ordinals in increasing order.
+    std::vector<size_t> offsets(static_cast<size_t>(bucketsX) * static_cast<size_t>(bucketsY) + 1);
+    for (const size_t index : windows) {
+      forEachBucket(doc.widgets[index].boundsCells, [&](size_t bucket) { ++offsets[bucket + 1]; });
+    }
+    for (size_t bucket = 1; bucket < offsets.size(); ++bucket) {
+      offsets[bucket] += offsets[bucket - 1];
+    }
+    std::vector<size_t> entries(offsets.back());
+    std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t ordinal = 0; ordinal < windows.size(); ++ordinal) {
+      forEachBucket(doc.widgets[windows[ordinal]].boundsCells,
+                    [&](size_t bucket) { entries[fill[bucket]++] = ordinal; });
+    }
+
+    detail::ParallelFor(windowChunks, workers, [&](size_t chunk, unsigned) {
+      std::vector<ValidationIssue>& out = overlapIssues[chunk];
+      const size_t end = std::min(windows.size(), (chunk + 1) * kChunkSize);
+      for (size_t ordinal = chunk * kChunkSize; ordinal < end && !full(out); ++ordinal) {
+        const size_t firstEntry = out.size();
+        const Widget& window = doc.widgets[windows[ordinal]];
+        const RectI& bounds = window.boundsCells;
+        forEachBucket(bounds, [&](size_t bucket) {
+          const auto begin = entries.begin() + static_cast<std::ptrdiff_t>(offsets[bucket]);
+          const auto last = entries.begin() + static_cast<std::ptrdiff_t>(offsets[bucket + 1]);
+          for (auto it = std::upper_bound(begin, last, ordinal); it != last; ++it) {
+            const size_t otherIndex = windows[*it];
+            const RectI& other = doc.widgets[otherIndex].boundsCells;
+            if (!RectsOverlap(bounds, other)) {
+              continue;
+            }
+            const int cornerX = BucketOf(std::max(bounds.x, other.x), bucketCells, bucketsX);
+            const int cornerY = BucketOf(std::max(bounds.y, other.y), bucketCells, bucketsY);
+            if (static_cast<size_t>(cornerY) * static_cast<size_t>(bucketsX) +
+                    static_cast<size_t>(cornerX) !=
+                bucket) {
+              continue;
+            }
+            const uint32_t otherId = doc.widgets[otherIndex].id;
+            out.push_back(ValidationIssue{ValidationRule::WindowOverlap, windows[ordinal],
+                                          window.id, otherIndex, otherId,
+                                          OverlapError(window.id, otherId)});
+          }
+        });
+        std::sort(out.begin() + static_cast<std::ptrdiff_t>(firstEntry), out.end(),
+                  [](const ValidationIssue& a, const ValidationIssue& b) {
+                    return a.otherIndex < b.otherIndex;
+                  });
+      }
+    });
+  }
+  for (std::vector<ValidationIssue>& chunk : overlapIssues) {
+    for (size_t i = 0; i < chunk.size() && !full(issues); ++i) {
+      issues.push_back(std::move(chunk[i]));
+    }
+  }
+
+  const bool valid = issues.empty();
+  if (outReport != nullptr) {
+    outReport->threadCount = workers;
+    outReport->truncated = full(issues);
+    if (outReport->truncated) {
+      issues.resize(cap);
+    }
+    outReport->issues = std::move(issues);
+  }
+  return valid;
+}
+
+bool ValidateEdit(const CgulDocument& doc, uint32_t widgetId, const RectI& newBounds,
+                  std::string* outError) {
+  if (outError != nullptr) {
+    outError->clear();
+  }
+
+  size_t self = doc.widgets.size();
+  for (size_t i = 0; i < doc.widgets.size() && self == doc.widgets.size(); ++i) {
+    if (doc.widgets[i].id == widgetId) {
+      self = i;
+    }
+  }
+  if (self == doc.widgets.size()) {
+    return Fail("unknown widget id " + std::to_string(widgetId), outError);
+  }
+  const std::string boundsError =
+      BoundsError(widgetId, newBounds, doc.gridWCells, doc.gridHCells);
+  if (!boundsError.empty()) {
+    return Fail(boundsError, outError);
+  }
+  if (doc.widgets[self].kind != WidgetKind::Window) {
+    return true;
+  }
+
+  for (size_t i = 0; i < doc.widgets.size(); ++i) {
+    const Widget& other = doc.widgets[i];
+    if (i != self && other.kind == WidgetKind::Window &&
+        RectsOverlap(newBounds, other.boundsCells)) {
+      return Fail(i < self ? OverlapError(other.id, widgetId) : OverlapError(widgetId, other.id),
+                  outError);
+    }
+  }
+  return true;
+}
+
+EditValidator::EditValidator(const DocumentIndex* index) { Reset(index); }
+
+void EditValidator::Reset(const DocumentIndex* index) {
+  index_ = index;
+  built_ = false;
+}
+
+bool EditValidator::ValidateEdit(uint32_t widgetId, const RectI& newBounds,
+                                 std::string* outError) {
+  if (outError != nullptr) {
+    outError->clear();
+  }
+  const Widget* widget = index_ != nullptr ? index_->Find(widgetId) : nullptr;
+  if (widget == nullptr) {
+    return Fail("unknown widget id " + std::to_string(widgetId), outError);
+  }
+  const CgulDocument& doc = *index_->document();
+  const std::string boundsError =
+      BoundsError(widgetId, newBounds, doc.gridWCells, doc.gridHCells);
+  if (!boundsError.empty()) {
+    return Fail(boundsError, outError);
+  }
+  if (widget->kind != WidgetKind::Window) {
+    return true;
+  }
+
+  Refresh();
+  // Report the overlapping window earliest in draw order, as Validate would for the edited
+  // document.
+  size_t first = DocumentIndex::kNotFound;
+  uint32_t firstId = 0;
+  ForEachBucket(newBounds, [&](const std::vector<Bucketed>& bucket) {
+    for (const Bucketed& other : bucket) {
+      if (other.id != widgetId && RectsOverlap(newBounds, other.bounds)) {
+        const size_t position = index_->IndexOf(other.id);
+        if (position < first) {
+          first = position;
+          firstId = other.id;
+        }
+      }
+    }
+  });
+  if (first != DocumentIndex::kNotFound) {
+    return Fail(first < index_->IndexOf(widgetId) ? OverlapError(firstId, widgetId)
+                                                  : OverlapError(widgetId, firstId),
+                outError);
+  }
   return true;
 }
 
+void EditValidator::Refresh() {
+  const CgulDocument& doc = *index_->document();
+  if (built_ && revision_ == index_->revision()) {
+    return;
+  }
+  DocumentChanges changes;
+  // Past a point, re-bucketing everything is cheaper than patching.
+  if (!built_ || doc.gridWCells != gridWCells_ || doc.gridHCells != gridHCells_ ||
+      !index_->ChangedSince(revision_, &changes) ||
+      changes.changed.size() > doc.widgets.size() / 2) {
+    Rebuild();
+    return;
+  }
+
+  for (const uint32_t id : changes.removed) {
+    RemoveWindow(id);
+  }
+  for (const uint32_t id : changes.changed) {
+    RemoveWindow(id);
+    const Widget* widget = index_->Find(id);
+    if (widget != nullptr && widget->kind == WidgetKind::Window) {
+      AddWindow(id, widget->boundsCells);
+    }
+  }
+  revision_ = index_->revision();
+}
+
+void EditValidator::Rebuild() {
+  const CgulDocument& doc = *index_->document();
+  gridWCells_ = doc.gridWCells;
+  gridHCells_ = doc.gridHCells;
+  revision_ = index_->revision();
+  built_ = true;
+  windows_.clear();
+
+  size_t windowCount = 0;
+  int64_t extentSum = 0;
+  for (const Widget& widget : doc.widgets) {
+    if (widget.kind == WidgetKind::Window) {
+      ++windowCount;
+      extentSum += std::max(widget.boundsCells.w, widget.boundsCells.h);
+    }
+  }
+  const int64_t gridW = std::max(gridWCells_, 1);
+  const int64_t gridH = std::max(gridHCells_, 1);
+  const int64_t bucketCells = ChooseBucketCells(gridW, gridH, windowCount, extentSum);
+  bucketCells_ = bucketCells;
+  bucketsX_ = static_cast<int>((gridW + bucketCells - 1) / bucketCells);
+  bucketsY_ = static_cast<int>((gridH + bucketCells - 1) / bucketCells);
+  buckets_.assign(static_cast<size_t>(bucketsX_) * static_cast<size_t>(bucketsY_), {});
+
+  for (const Widget& widget : doc.widgets) {
+    if (widget.kind == WidgetKind::Window) {
+      AddWindow(widget.id, widget.boundsCells);
+    }
+  }
+}
+
+void EditValidator::AddWindow(uint32_t id, const RectI& bounds) {
+  if (!windows_.emplace(id, bounds).second) {
+    return;
+  }
+  ForEachBucket(bounds, [&](std::vector<Bucketed>& bucket) { bucket.push_back({id, bounds}); });
+}
+
+void EditValidator::RemoveWindow(uint32_t id) {
+  const auto it = windows_.find(id);
+  if (it == windows_.end()) {
+    return;
+  }
+  ForEachBucket(it->second, [id](std::vector<Bucketed>& bucket) {
+    for (size_t i = 0; i < bucket.size(); ++i) {
+      if (bucket[i].id == id) {
+        bucket[i] = bucket.back();
+        bucket.pop_back();
+        break;
+      }
+    }
+  });
+  windows_.erase(it);
+}
+
+template <typename Visit>
+void EditValidator::ForEachBucket(const RectI& bounds, Visit&& visit) {
+  if (bounds.w <= 0 || bounds.h <= 0) {
+    return;
+  }
+  const int x0 = BucketOf(bounds.x, bucketCells_, bucketsX_);
+  const int x1 = BucketOf(static_cast<int64_t>(bounds.x) + bounds.w - 1, bucketCells_, bucketsX_);
+  const int y0 = BucketOf(bounds.y, bucketCells_, bucketsY_);
+  const int y1 = BucketOf(static_cast<int64_t>(bounds.y) + bounds.h - 1, bucketCells_, bucketsY_);
+  for (int y = y0; y <= y1; ++y) {
+    for (int x = x0; x <= x1; ++x) {
+      visit(buckets_[static_cast<size_t>(y) * static_cast<size_t>(bucketsX_) +
+                     static_cast<size_t>(x)]);
+    }
+  }
+}
+
 }  // namespace cgul
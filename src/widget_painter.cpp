@@ -0,0 +1,198 @@
+#include "cgul/render/widget_painter.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cgul {
+
+namespace {
+
+std::u32string ToGlyphString(const std::string& text) {
+  std::u32string result;
+  result.reserve(text.size());
+  for (unsigned char ch : text) {
+    result.push_back(ch < 128 ? static_cast<char32_t>(ch) : U'?');
+  }
+  return result;
+}
+
+bool InBounds(const Frame& frame, int x, int y) {
+  return x >= 0 && y >= 0 && x < frame.width && y < frame.height;
+}
+
+void DrawBoxBorder(Frame& frame, int x0, int y0, int x1, int y1, uint32_t widgetId) {
+  for (int y = y0; y <= y1; ++y) {
+    for (int x = x0; x <= x1; ++x) {
+      if (!InBounds(frame, x, y)) {
+        continue;
+      }
+
+      Cell& c = frame.at(x, y);
+      const bool left = (x == x0);
+      const bool right = (x == x1);
+      const bool top = (y == y0);
+      const bool bottom = (y == y1);
+
+      if (top) {
+        if (left || right) {
+          c.glyph = U'#';
+        } else {
+          c.glyph = U'=';
+        }
+      } else if (bottom || left || right) {
+        c.glyph = U'#';
+      } else {
+        c.glyph = U' ';
+      }
+
+      c.widgetId = widgetId;
+    }
+  }
+}
+
+void DrawClippedText(Frame& frame, int x, int y, const std::string& text, int maxWidth,
+                     uint32_t widgetId) {
+  if (maxWidth <= 0 || text.empty() || y < 0 || y >= frame.height || x >= frame.width) {
+    return;
+  }
+
+  const int startX = std::max(0, x);
+  const int visibleWidth = std::min(maxWidth - (startX - x), frame.width - startX);
+  if (visibleWidth <= 0) {
+    return;
+  }
+
+  std::u32string glyphs = ToGlyphString(text);
+  if (static_cast<int>(glyphs.size()) > visibleWidth) {
+    glyphs.resize(static_cast<size_t>(visibleWidth));
+  }
+
+  draw_text(frame, startX, y, glyphs, widgetId);
+}
+
+void PaintWindow(Frame& frame, const Widget& widget, void*) {
+  const int x0 = widget.boundsCells.x;
+  const int y0 = widget.boundsCells.y;
+  const int x1 = widget.boundsCells.x + widget.boundsCells.w - 1;
+  const int y1 = widget.boundsCells.y + widget.boundsCells.h - 1;
+
+  DrawBoxBorder(frame, x0, y0, x1, y1, widget.id);
+
+  const std::string title =
+      widget.title.empty() ? ("Window " + std::to_string(widget.id)) : widget.title;
+  DrawClippedText(frame, x0 + 2, y0, title, std::max(0, widget.boundsCells.w - 4), widget.id);
+
+  const int interiorWidth = widget.boundsCells.w - 2;
+  const int interiorHeight = widget.boundsCells.h - 2;
+  if (interiorWidth > 0 && interiorHeight > 0) {
+    const std::string line1 = "W x H: " + std::to_string(widget.boundsCells.w) + " x " +
+                              std::to_string(widget.boundsCells.h);
+    DrawClippedText(frame, x0 + 1, y0 + 1, line1, interiorWidth, widget.id);
+
+    if (interiorHeight > 1) {
+      const std::string line2 = "pos: " + std::to_string(widget.boundsCells.x) + "," +
+                                std::to_string(widget.boundsCells.y);
+      DrawClippedText(frame, x0 + 1, y0 + 2, line2, interiorWidth, widget.id);
+    }
+  }
+}
+
+void PaintBoxedTitle(Frame& frame, const Widget& widget, void*) {
+  const int x0 = widget.boundsCells.x;
+  const int y0 = widget.boundsCells.y;
+  const int x1 = widget.boundsCells.x + widget.boundsCells.w - 1;
+  const int y1 = widget.boundsCells.y + widget.boundsCells.h - 1;
+
+  DrawBoxBorder(frame, x0, y0, x1, y1, widget.id);
+
+  if (!widget.title.empty()) {
+    const int textY = std::clamp(y0 + 1, y0, y1);
+    DrawClippedText(frame, x0 + 1, textY, widget.title, std::max(0, widget.boundsCells.w - 2),
+                    widget.id);
+  }
+}
+
+// Indexed by WidgetKind; kept in enum order.
+constexpr WidgetPainter kBuiltinPainters[] = {
+    {&PaintWindow, nullptr, true},
+    {&PaintBoxedTitle, nullptr, true},
+    {&PaintBoxedTitle, nullptr, true},
+    {&PaintBoxedTitle, nullptr, true},
+};
+static_assert(sizeof(kBuiltinPainters) / sizeof(kBuiltinPainters[0]) ==
+                  static_cast<size_t>(WidgetKind::Button) + 1,
+              "kBuiltinPainters must cover every built-in WidgetKind");
+
+std::vector<WidgetPainter>& CustomPainters() {
+  static std::vector<WidgetPainter> painters;
+  return painters;
+}
+
+const WidgetPainter* FindCustomPainter(WidgetKind kind) {
+  const std::vector<WidgetPainter>& painters = CustomPainters();
+  const size_t index = static_cast<size_t>(static_cast<uint16_t>(kind) - kFirstCustomWidgetKind);
+  if (index >= painters.size() || painters[index].paint == nullptr) {
+    return nullptr;
+  }
+  return &painters[index];
+}
+
+}  // namespace
+
+bool RegisterWidgetPainter(WidgetKind kind, const WidgetPainter& painter, std::string* outError) {
+  if (outError != nullptr) {
+    outError->clear();
+  }
+  if (static_cast<uint16_t>(kind) < kFirstCustomWidgetKind) {
+    if (outError != nullptr) {
+      *outError = std::string("cannot replace built-in painter for kind: ") + ToString(kind);
+    }
+    return false;
+  }
+  if (painter.paint == nullptr) {
+    if (outError != nullptr) {
+      *outError = "painter.paint must not be null";
+    }
+    return false;
+  }
+
+  std::vector<WidgetPainter>& painters = CustomPainters();
+  const size_t index = static_cast<size_t>(static_cast<uint16_t>(kind) - kFirstCustomWidgetKind);
+  if (index >= painters.size()) {
+    painters.resize(index + 1);
+  }
+  painters[index] = painter;
+  return true;
+}
+
+WidgetPainter GetWidgetPainter(WidgetKind kind) {
+  if (IsBuiltinWidgetKind(kind)) {
+    return kBuiltinPainters[static_cast<size_t>(kind)];
+  }
+  const WidgetPainter* custom = FindCustomPainter(kind);
+  return custom != nullptr ? *custom : kBuiltinPainters[static_cast<size_t>(WidgetKind::Panel)];
+}
+
+void PaintWidget(Frame& frame, const Widget& widget) {
+  switch (widget.kind) {
+    case WidgetKind::Window:
+      PaintWindow(frame, widget, nullptr);
+      return;
+    case WidgetKind::Panel:
+    case WidgetKind::Label:
+    case WidgetKind::Button:
+      PaintBoxedTitle(frame, widget, nullptr);
+      return;
+  }
+
+  const WidgetPainter* custom = FindCustomPainter(widget.kind);
+  if (custom != nullptr) {
+    custom->paint(frame, widget, custom->userData);
+    return;
+  }
+  PaintBoxedTitle(frame, widget, nullptr);
+}
+
+}  // namespace cgul
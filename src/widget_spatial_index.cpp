@@ -0,0 +1,244 @@
+#include "cgul/core/widget_spatial_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+
+namespace cgul {
+
+namespace {
+
+constexpr size_t kNodeSize = 16;
+
+// Orders items for Sort-Tile-Recursive packing: vertical slices of about sqrt(groups) groups
+// by x center, each sorted by y center, so every run of kNodeSize items is a compact tile.
+template <typename Item, typename GetBox>
+void SortTileRecursive(Item* items, size_t count, GetBox getBox) {
+  const size_t groups = (count + kNodeSize - 1) / kNodeSize;
+  const size_t slices = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(groups))));
+  if (slices <= 1) {
+    return;
+  }
+  const size_t sliceItems = (groups + slices - 1) / slices * kNodeSize;
+  std::sort(items, items + count, [&getBox](const Item& a, const Item& b) {
+    return getBox(a).x0 + getBox(a).x1 < getBox(b).x0 + getBox(b).x1;
+  });
+  for (size_t first = 0; first < count; first += sliceItems) {
+    std::sort(items + first, items + std::min(count, first + sliceItems),
+              [&getBox](const Item& a, const Item& b) {
+                return getBox(a).y0 + getBox(a).y1 < getBox(b).y0 + getBox(b).y1;
+              });
+  }
+}
+
+}  // namespace
+
+WidgetSpatialIndex::WidgetSpatialIndex(const DocumentIndex* index) { Reset(index); }
+
+void WidgetSpatialIndex::Reset(const DocumentIndex* index) {
+  index_ = index;
+  built_ = false;
+}
+
+uint32_t WidgetSpatialIndex::TopWidgetAt(int cellX, int cellY) {
+  return TopAt(cellX, cellY, nullptr);
+}
+
+uint32_t WidgetSpatialIndex::TopWidgetAt(int cellX, int cellY, WidgetKind kind) {
+  return TopAt(cellX, cellY, &kind);
+}
+
+void WidgetSpatialIndex::WidgetsInRect(const RectI& rect, std::vector<uint32_t>* outIds) {
+  outIds->clear();
+  if (index_ == nullptr) {
+    return;
+  }
+  Refresh();
+  std::vector<std::pair<size_t, uint32_t>> hits;
+  ForEachOverlapping(BoxOf(rect), [this, &hits](const Entry& entry) {
+    hits.emplace_back(index_->IndexOf(entry.id), entry.id);
+  });
+  std::sort(hits.begin(), hits.end());
+  outIds->reserve(hits.size());
+  for (const auto& hit : hits) {
+    outIds->push_back(hit.second);
+  }
+}
+
+WidgetSpatialIndex::Box WidgetSpatialIndex::BoxOf(const RectI& rect) {
+  if (rect.w <= 0 || rect.h <= 0) {
+    // Inverted, so it overlaps nothing and leaves node boxes unchanged.
+    return Box{INT64_MAX, INT64_MAX, INT64_MIN, INT64_MIN};
+  }
+  return Box{rect.x, rect.y, static_cast<int64_t>(rect.x) + rect.w,
+             static_cast<int64_t>(rect.y) + rect.h};
+}
+
+uint32_t WidgetSpatialIndex::TopAt(int cellX, int cellY, const WidgetKind* kind) {
+  if (index_ == nullptr) {
+    return 0;
+  }
+  Refresh();
+  const Box cell{cellX, cellY, static_cast<int64_t>(cellX) + 1, static_cast<int64_t>(cellY) + 1};
+  size_t topPosition = 0;
+  uint32_t topId = 0;
+  ForEachOverlapping(cell, [&](const Entry& entry) {
+    if (kind != nullptr && entry.kind != *kind) {
+      return;
+    }
+    const size_t position = index_->IndexOf(entry.id);
+    if (topId == 0 || position > topPosition) {
+      topPosition = position;
+      topId = entry.id;
+    }
+  });
+  return topId;
+}
+
+template <typename Visit>
+void WidgetSpatialIndex::ForEachOverlapping(const Box& query, Visit&& visit) {
+  if (!nodes_.empty()) {
+    stack_.clear();
+    stack_.push_back(static_cast<uint32_t>(nodes_.size() - 1));
+    while (!stack_.empty()) {
+      const Node& node = nodes_[stack_.back()];
+      stack_.pop_back();
+      if (!Overlaps(node.box, query)) {
+        continue;
+      }
+      for (uint32_t child = node.first; child < node.first + node.count; ++child) {
+        if (!node.leaf) {
+          stack_.push_back(child);
+        } else if (entries_[child].id != 0 && Overlaps(entries_[child].box, query)) {
+          visit(entries_[child]);
+        }
+      }
+    }
+  }
+  for (size_t i = treeEntries_; i < entries_.size(); ++i) {
+    if (Overlaps(entries_[i].box, query)) {
+      visit(entries_[i]);
+    }
+  }
+}
+
+void WidgetSpatialIndex::Refresh() {
+  if (built_ && revision_ == index_->revision()) {
+    return;
+  }
+  const CgulDocument& doc = *index_->document();
+  DocumentChanges changes;
+  if (!built_ || !index_->ChangedSince(revision_, &changes) ||
+      changes.changed.size() > doc.widgets.size() / 2) {
+    Rebuild();
+    return;
+  }
+
+  for (const uint32_t id : changes.removed) {
+    RemoveEntry(id);
+  }
+  for (const uint32_t id : changes.changed) {
+    RemoveEntry(id);
+    const Widget* widget = index_->Find(id);
+    if (widget != nullptr) {
+      AddPending(*widget);
+    }
+  }
+  revision_ = index_->revision();
+
+  // The overflow list is scanned by every query and tombstones still cost a visit, so repack
+  // before either outgrows a fraction of the tree.
+  const size_t live = entries_.size() - tombstones_;
+  if (entries_.size() - treeEntries_ > std::max<size_t>(64, live / 8) ||
+      tombstones_ > std::max<size_t>(64, live / 4)) {
+    Rebuild();
+  }
+}
+
+void WidgetSpatialIndex::Rebuild() {
+  const CgulDocument& doc = *index_->document();
+  revision_ = index_->revision();
+  built_ = true;
+  tombstones_ = 0;
+  entries_.clear();
+  nodes_.clear();
+  slots_.Clear();
+
+  entries_.reserve(doc.widgets.size());
+  for (size_t i = 0; i < doc.widgets.size(); ++i) {
+    const Widget& widget = doc.widgets[i];
+    // Widgets the DocumentIndex left unindexed (zero or duplicate ids) cannot be queried.
+    if (index_->IndexOf(widget.id) == i) {
+      entries_.push_back(Entry{BoxOf(widget.boundsCells), widget.id, widget.kind});
+    }
+  }
+  treeEntries_ = entries_.size();
+  SortTileRecursive(entries_.data(), entries_.size(),
+                    [](const Entry& entry) -> const Box& { return entry.box; });
+  slots_.Reserve(entries_.size());
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    slots_.Insert(entries_[i].id, i);
+  }
+
+  // Each level groups runs of kNodeSize items of the level below, which is STR-sorted first.
+  const auto unite = [](const Box& a, const Box& b) {
+    return Box{std::min(a.x0, b.x0), std::min(a.y0, b.y0), std::max(a.x1, b.x1),
+               std::max(a.y1, b.y1)};
+  };
+  size_t levelBegin = 0;
+  size_t levelCount = (entries_.size() + kNodeSize - 1) / kNodeSize;
+  for (size_t first = 0; first < entries_.size(); first += kNodeSize) {
+    Node leaf;
+    leaf.first = static_cast<uint32_t>(first);
+    leaf.count = static_cast<uint32_t>(std::min(kNodeSize, entries_.size() - first));
+    leaf.leaf = true;
+    leaf.box = entries_[first].box;
+    for (size_t i = first + 1; i < first + leaf.count; ++i) {
+      leaf.box = unite(leaf.box, entries_[i].box);
+    }
+    nodes_.push_back(leaf);
+  }
+  while (levelCount > 1) {
+    SortTileRecursive(nodes_.data() + levelBegin, levelCount,
+                      [](const Node& node) -> const Box& { return node.box; });
+    const size_t nextBegin = nodes_.size();
+    for (size_t first = levelBegin; first < levelBegin + levelCount; first += kNodeSize) {
+      Node parent;
+      parent.first = static_cast<uint32_t>(first);
+      parent.count = static_cast<uint32_t>(std::min(kNodeSize, levelBegin + levelCount - first));
+      parent.box = nodes_[first].box;
+      for (size_t i = first + 1; i < first + parent.count; ++i) {
+        parent.box = unite(parent.box, nodes_[i].box);
+      }
+      nodes_.push_back(parent);
+    }
+    levelBegin = nextBegin;
+    levelCount = nodes_.size() - nextBegin;
+  }
+}
+
+void WidgetSpatialIndex::AddPending(const Widget& widget) {
+  entries_.push_back(Entry{BoxOf(widget.boundsCells), widget.id, widget.kind});
+  slots_.Insert(widget.id, entries_.size() - 1);
+}
+
+void WidgetSpatialIndex::RemoveEntry(uint32_t id) {
+  const size_t slot = slots_.Find(id);
+  if (slot == WidgetIdMap::kNotFound) {
+    return;
+  }
+  slots_.Erase(id);
+  if (slot < treeEntries_) {
+    entries_[slot].id = 0;
+    ++tombstones_;
+    return;
+  }
+  if (slot + 1 != entries_.size()) {
+    entries_[slot] = entries_.back();
+    slots_.Update(entries_[slot].id, slot);
+  }
+  entries_.pop_back();
+}
+
+}  // namespace cgul